@@ -0,0 +1,279 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Commandlets/MBCG_AmbushAvaisionSoakCommandlet.h"
+#include "MBCG/AI/Commandlets/MBCG_CommandletHelpers.h"
+#include "MBCG/AI/Subsystems/MBCG_NPCAmbushAvaisionSubsystem.h"
+#include "MBCG/AI/Subsystems/MBCG_AttackClusteringSubsystem.h"
+#include "MBCG/AI/Subsystems/MBCG_NavSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Math/RandomStream.h"
+#include "Logging/StructuredLog.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogUMBCG_AmbushAvaisionSoakCommandlet, All, All);
+
+
+namespace MBCG_AmbushAvaisionSoak
+{
+    // Parameters of a soak run, parsed from the command line
+    struct FSoakSettings
+    {
+        int32 EventCount = 100000;
+        int32 Seed = 1337;
+        int32 HotspotCount = 8;
+        // how many events are registered between two samples
+        int32 SampleInterval = 5000;
+        // how many events are registered between two hotspot moves
+        int32 HotspotMoveInterval = 500;
+        // share of events which are not related to any hotspot
+        float NoiseEventsShare = 0.1f;
+        // half size of the square area where hotspots and noise events are placed
+        float WorldHalfSize = 20000.f;
+        // spread of deaths around a hotspot
+        float HotspotSpread = 250.f;
+        // maximum hotspot displacement per move
+        float HotspotStep = 400.f;
+
+        // Regression thresholds (<= 0 means not checked)
+        float MaxP50Ms = 0.f;
+        float MaxP99Ms = 0.f;
+        float MaxMs = 0.f;
+        float MaxMemoryGrowthMB = 0.f;
+
+        // optional CSV output of samples
+        FString CsvFilePath;
+
+        // use EAttackClusteringMode::Grid instead of the exact clustering
+        bool bGridClustering = false;
+
+        void Parse(const FString& Params)
+        {
+            FParse::Value(*Params, TEXT("Events="), EventCount);
+            FParse::Value(*Params, TEXT("Seed="), Seed);
+            FParse::Value(*Params, TEXT("Hotspots="), HotspotCount);
+            FParse::Value(*Params, TEXT("SampleInterval="), SampleInterval);
+            FParse::Value(*Params, TEXT("HotspotMoveInterval="), HotspotMoveInterval);
+            FParse::Value(*Params, TEXT("MaxP50Ms="), MaxP50Ms);
+            FParse::Value(*Params, TEXT("MaxP99Ms="), MaxP99Ms);
+            FParse::Value(*Params, TEXT("MaxMs="), MaxMs);
+            FParse::Value(*Params, TEXT("MaxMemoryGrowthMB="), MaxMemoryGrowthMB);
+            FParse::Value(*Params, TEXT("Csv="), CsvFilePath);
+            bGridClustering = FParse::Param(*Params, TEXT("Grid"));
+
+            EventCount = FMath::Max(1, EventCount);
+            HotspotCount = FMath::Max(1, HotspotCount);
+            SampleInterval = FMath::Max(1, SampleInterval);
+            HotspotMoveInterval = FMath::Max(1, HotspotMoveInterval);
+        }
+    };
+
+    // Seeded generator of deaths around moving hotspots
+    class FSyntheticDeathStream
+    {
+    public:
+
+        explicit FSyntheticDeathStream(const FSoakSettings& InSettings)
+            : Settings(InSettings)
+            , RandomStream(InSettings.Seed)
+        {
+            for (int32 idx = 0; idx < Settings.HotspotCount; ++idx)
+            {
+                Hotspots.Add(RandomPointInWorld());
+            }
+        }
+
+        // Generates the next attack (victim's and instigator's data)
+        void Next(int32 EventIdx, FVector& OutInstigatorLocation, FVector& OutInstigatorDirection, FVector& OutVictimLocation)
+        {
+            // hotspots drift over time
+            if (EventIdx > 0 && EventIdx % Settings.HotspotMoveInterval == 0)
+            {
+                for (FVector& Hotspot : Hotspots)
+                {
+                    Hotspot += FVector(RandomStream.FRandRange(-1.f, 1.f), RandomStream.FRandRange(-1.f, 1.f), 0.f) * Settings.HotspotStep;
+                    Hotspot.X = FMath::Clamp(Hotspot.X, -Settings.WorldHalfSize, Settings.WorldHalfSize);
+                    Hotspot.Y = FMath::Clamp(Hotspot.Y, -Settings.WorldHalfSize, Settings.WorldHalfSize);
+                }
+            }
+
+            if (RandomStream.FRand() < Settings.NoiseEventsShare)
+            {
+                OutVictimLocation = RandomPointInWorld();
+            }
+            else
+            {
+                const FVector& Hotspot = Hotspots[RandomStream.RandRange(0, Hotspots.Num() - 1)];
+                OutVictimLocation = Hotspot + FVector(RandomStream.FRandRange(-1.f, 1.f), RandomStream.FRandRange(-1.f, 1.f), 0.f) * Settings.HotspotSpread;
+            }
+
+            // an instigator shoots from some distance
+            const float Angle = RandomStream.FRandRange(0.f, 2.f * UE_PI);
+            const FVector ToInstigator(FMath::Cos(Angle), FMath::Sin(Angle), 0.f);
+            OutInstigatorLocation = OutVictimLocation + ToInstigator * RandomStream.FRandRange(500.f, 2000.f);
+            OutInstigatorDirection = (OutVictimLocation - OutInstigatorLocation).GetSafeNormal();
+        }
+
+    private:
+
+        const FSoakSettings& Settings;
+        FRandomStream RandomStream;
+        TArray<FVector> Hotspots;
+
+        FVector RandomPointInWorld()
+        {
+            return FVector(RandomStream.FRandRange(-Settings.WorldHalfSize, Settings.WorldHalfSize), RandomStream.FRandRange(-Settings.WorldHalfSize, Settings.WorldHalfSize), 0.f);
+        }
+    };
+
+    static int32 CountValidClusters(const TArray<FAttackCluster>& Clusters)
+    {
+        int32 ValidClusters = 0;
+        for (const FAttackCluster& Cluster : Clusters)
+        {
+            if (Cluster.IsValid) ++ValidClusters;
+        }
+        return ValidClusters;
+    }
+
+    static int32 CountValidVolumes(const TArray<ANavModifierVolume*>& Volumes)
+    {
+        int32 ValidVolumes = 0;
+        for (const ANavModifierVolume* Volume : Volumes)
+        {
+            if (IsValid(Volume)) ++ValidVolumes;
+        }
+        return ValidVolumes;
+    }
+
+    static double GetResidentMemoryMB()
+    {
+        return static_cast<double>(FPlatformMemory::GetStats().UsedPhysical) / (1024.0 * 1024.0);
+    }
+}  // namespace MBCG_AmbushAvaisionSoak
+
+
+UMBCG_AmbushAvaisionSoakCommandlet::UMBCG_AmbushAvaisionSoakCommandlet()
+{
+    IsClient = false;
+    IsServer = true;
+    IsEditor = false;
+    LogToConsole = true;
+}
+
+
+int32 UMBCG_AmbushAvaisionSoakCommandlet::Main(const FString& Params)
+{
+    using namespace MBCG_AmbushAvaisionSoak;
+    using namespace MBCG_CommandletHelpers;
+
+    FSoakSettings Settings;
+    Settings.Parse(Params);
+
+    UE_LOGFMT(LogUMBCG_AmbushAvaisionSoakCommandlet, Display, "Soak started: Events = {0}, Seed = {1}, Hotspots = {2}, SampleInterval = {3}",  //
+        Settings.EventCount, Settings.Seed, Settings.HotspotCount, Settings.SampleInterval);
+
+    UWorld* World = CreateStandaloneGameWorld(TEXT("MBCG_AmbushAvaisionSoakWorld"));
+    if (!World)
+    {
+        UE_LOGFMT(LogUMBCG_AmbushAvaisionSoakCommandlet, Error, "Failed to create a world.");
+        return 1;
+    }
+
+    UMBCG_NPCAmbushAvaisionSubsystem* NPCAmbushAvaisionSubsystem = World->GetSubsystem<UMBCG_NPCAmbushAvaisionSubsystem>();
+    UMBCG_AttackClusteringSubsystem* AttackClusteringSubsystem = World->GetSubsystem<UMBCG_AttackClusteringSubsystem>();
+    UMBCG_NavSubsystem* NavSubsystem = World->GetSubsystem<UMBCG_NavSubsystem>();
+    if (!NPCAmbushAvaisionSubsystem || !AttackClusteringSubsystem || !NavSubsystem)
+    {
+        UE_LOGFMT(LogUMBCG_AmbushAvaisionSoakCommandlet, Error, "MBCG subsystems are not available in the soak world.");
+        DestroyStandaloneGameWorld(World);
+        return 1;
+    }
+
+    // the soak world doesn't tick, so death placements are applied right away and their nav work is measured per event
+    NavSubsystem->SetDeathPlacementsFlushInterval(0.f);
+
+    if (Settings.bGridClustering)
+    {
+        AttackClusteringSubsystem->SetClusteringMode(EAttackClusteringMode::Grid);
+    }
+
+    FSyntheticDeathStream DeathStream(Settings);
+
+    TArray<double> AllLatenciesMs;
+    AllLatenciesMs.Reserve(Settings.EventCount);
+    TArray<double> SampleLatenciesMs;
+    SampleLatenciesMs.Reserve(Settings.SampleInterval);
+
+    TArray<FString> CsvLines;
+    CsvLines.Add(TEXT("Events,P50Ms,P99Ms,MaxMs,InstigatorEntries,InstigatorClusters,VictimEntries,VictimClusters,NavVolumes,ResidentMemoryMB"));
+
+    const double StartMemoryMB = GetResidentMemoryMB();
+    double PeakMemoryGrowthMB = 0.0;
+
+    for (int32 EventIdx = 0; EventIdx < Settings.EventCount; ++EventIdx)
+    {
+        FVector InstigatorLocation, InstigatorDirection, VictimLocation;
+        DeathStream.Next(EventIdx, InstigatorLocation, InstigatorDirection, VictimLocation);
+
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        NPCAmbushAvaisionSubsystem->RegisterNewAttack(InstigatorLocation, InstigatorDirection, EAttackRegistrationType::InstigatorAndVictim, VictimLocation);
+        const double LatencyMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+        AllLatenciesMs.Add(LatencyMs);
+        SampleLatenciesMs.Add(LatencyMs);
+
+        // sample the state over time
+        if ((EventIdx + 1) % Settings.SampleInterval == 0 || EventIdx + 1 == Settings.EventCount)
+        {
+            const FLatencyStats SampleStats = FLatencyStats::Calculate(SampleLatenciesMs);
+            SampleLatenciesMs.Reset();
+
+            const double MemoryMB = GetResidentMemoryMB();
+            PeakMemoryGrowthMB = FMath::Max(PeakMemoryGrowthMB, MemoryMB - StartMemoryMB);
+
+            const int32 InstigatorEntries = AttackClusteringSubsystem->GetClusterEntries(EEntryType::Instigator).Num();
+            const int32 InstigatorClusters = CountValidClusters(AttackClusteringSubsystem->GetClusters(EEntryType::Instigator));
+            const int32 VictimEntries = AttackClusteringSubsystem->GetClusterEntries(EEntryType::Victim).Num();
+            const int32 VictimClusters = CountValidClusters(AttackClusteringSubsystem->GetClusters(EEntryType::Victim));
+            const int32 NavVolumes = CountValidVolumes(NavSubsystem->GetDeathNavModifierVolumes());
+
+            UE_LOGFMT(LogUMBCG_AmbushAvaisionSoakCommandlet, Display,
+                "- Events = {0}: P50 = {1} ms, P99 = {2} ms, Max = {3} ms, Instigator entries/clusters = {4}/{5}, Victim entries/clusters = {6}/{7}, NavVolumes = {8}, Memory = {9} MB",  //
+                EventIdx + 1, SampleStats.P50, SampleStats.P99, SampleStats.Max, InstigatorEntries, InstigatorClusters, VictimEntries, VictimClusters, NavVolumes, MemoryMB);
+
+            CsvLines.Add(FString::Printf(TEXT("%d,%.4f,%.4f,%.4f,%d,%d,%d,%d,%d,%.1f"),  //
+                EventIdx + 1, SampleStats.P50, SampleStats.P99, SampleStats.Max, InstigatorEntries, InstigatorClusters, VictimEntries, VictimClusters, NavVolumes, MemoryMB));
+        }
+    }
+
+    const FLatencyStats TotalStats = FLatencyStats::Calculate(AllLatenciesMs);
+    UE_LOGFMT(LogUMBCG_AmbushAvaisionSoakCommandlet, Display, "Soak finished: P50 = {0} ms, P99 = {1} ms, Max = {2} ms, Peak memory growth = {3} MB",  //
+        TotalStats.P50, TotalStats.P99, TotalStats.Max, PeakMemoryGrowthMB);
+
+    if (!Settings.CsvFilePath.IsEmpty() && !FFileHelper::SaveStringArrayToFile(CsvLines, *Settings.CsvFilePath))
+    {
+        UE_LOGFMT(LogUMBCG_AmbushAvaisionSoakCommandlet, Warning, "Failed to write samples to {0}.", Settings.CsvFilePath);
+    }
+
+    DestroyStandaloneGameWorld(World);
+
+    // check regression thresholds
+    bool bThresholdExceeded = false;
+    auto CheckThreshold = [&bThresholdExceeded](const TCHAR* Name, double Value, double Threshold)
+    {
+        if (Threshold > 0.0 && Value > Threshold)
+        {
+            UE_LOGFMT(LogUMBCG_AmbushAvaisionSoakCommandlet, Error, "Regression threshold exceeded: {0} = {1} > {2}.", Name, Value, Threshold);
+            bThresholdExceeded = true;
+        }
+    };
+    CheckThreshold(TEXT("P50Ms"), TotalStats.P50, Settings.MaxP50Ms);
+    CheckThreshold(TEXT("P99Ms"), TotalStats.P99, Settings.MaxP99Ms);
+    CheckThreshold(TEXT("MaxMs"), TotalStats.Max, Settings.MaxMs);
+    CheckThreshold(TEXT("MemoryGrowthMB"), PeakMemoryGrowthMB, Settings.MaxMemoryGrowthMB);
+
+    return bThresholdExceeded ? 1 : 0;
+}
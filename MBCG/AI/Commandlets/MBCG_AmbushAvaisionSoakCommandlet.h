@@ -0,0 +1,34 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MBCG_AmbushAvaisionSoakCommandlet.generated.h"
+
+
+/**
+ * Long-running soak harness for MBCG_NPCAmbushAvaisionSubsystem.
+ * It creates a standalone game world, drives UMBCG_NPCAmbushAvaisionSubsystem::RegisterNewAttack with a seeded synthetic death stream (moving hotspots plus uniform noise)
+ * and periodically records registration latency percentiles, cluster and entry counts, death nav volume counts and resident memory.
+ * The commandlet returns non-zero exit code if any of the regression thresholds is exceeded.
+ *
+ * Usage (headless):
+ *   UnrealEditor-Cmd <Project>.uproject -run=MBCG_AmbushAvaisionSoak -nullrhi -unattended [-Events=100000] [-Seed=1337] [-Hotspots=8] [-SampleInterval=5000]
+ *       [-MaxP50Ms=<Ms>] [-MaxP99Ms=<Ms>] [-MaxMs=<Ms>] [-MaxMemoryGrowthMB=<MB>] [-Csv=<FilePath>] [-Grid]
+ *
+ * Thresholds are not checked unless passed (a threshold <= 0 is not checked either), e.g. -MaxP50Ms=1.0 -MaxP99Ms=20.0 -MaxMs=250.0 -MaxMemoryGrowthMB=512 for CI.
+ */
+UCLASS()
+class LYRAGAME_API UMBCG_AmbushAvaisionSoakCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+public:
+
+    UMBCG_AmbushAvaisionSoakCommandlet();
+
+    //~UCommandlet interface
+    virtual int32 Main(const FString& Params) override;
+    //~End of UCommandlet interface
+};
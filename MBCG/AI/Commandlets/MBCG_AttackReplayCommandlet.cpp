@@ -0,0 +1,132 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Commandlets/MBCG_AttackReplayCommandlet.h"
+#include "MBCG/AI/Commandlets/MBCG_CommandletHelpers.h"
+#include "MBCG/AI/Data/MBCG_AttackRecorder.h"
+#include "MBCG/AI/Subsystems/MBCG_NPCAmbushAvaisionSubsystem.h"
+#include "MBCG/AI/Subsystems/MBCG_AttackClusteringSubsystem.h"
+#include "MBCG/AI/Subsystems/MBCG_NavSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+#include "Logging/StructuredLog.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogUMBCG_AttackReplayCommandlet, All, All);
+
+
+UMBCG_AttackReplayCommandlet::UMBCG_AttackReplayCommandlet()
+{
+    IsClient = false;
+    IsServer = true;
+    IsEditor = false;
+    LogToConsole = true;
+}
+
+
+int32 UMBCG_AttackReplayCommandlet::Main(const FString& Params)
+{
+    using namespace MBCG_CommandletHelpers;
+
+    FString RecordingFilePath;
+    int32 WorstFrameCount = 10;
+    float MaxP99Ms = 0.f;
+    float MaxFrameMs = 0.f;
+    FParse::Value(*Params, TEXT("Recording="), RecordingFilePath);
+    FParse::Value(*Params, TEXT("WorstFrames="), WorstFrameCount);
+    FParse::Value(*Params, TEXT("MaxP99Ms="), MaxP99Ms);
+    FParse::Value(*Params, TEXT("MaxFrameMs="), MaxFrameMs);
+    const bool bGridClustering = FParse::Param(*Params, TEXT("Grid"));
+
+    TArray<FAttackRecord> Records;
+    if (RecordingFilePath.IsEmpty() || !FAttackRecorder::LoadRecording(RecordingFilePath, Records))
+    {
+        UE_LOGFMT(LogUMBCG_AttackReplayCommandlet, Error, "A valid recording must be specified with -Recording=<FilePath>.");
+        return 1;
+    }
+
+    UE_LOGFMT(LogUMBCG_AttackReplayCommandlet, Display, "Replay started: Recording = {0}, Records = {1}", RecordingFilePath, Records.Num());
+
+    UWorld* World = CreateStandaloneGameWorld(TEXT("MBCG_AttackReplayWorld"));
+    if (!World)
+    {
+        UE_LOGFMT(LogUMBCG_AttackReplayCommandlet, Error, "Failed to create a world.");
+        return 1;
+    }
+
+    UMBCG_NPCAmbushAvaisionSubsystem* NPCAmbushAvaisionSubsystem = World->GetSubsystem<UMBCG_NPCAmbushAvaisionSubsystem>();
+    UMBCG_AttackClusteringSubsystem* AttackClusteringSubsystem = World->GetSubsystem<UMBCG_AttackClusteringSubsystem>();
+    UMBCG_NavSubsystem* NavSubsystem = World->GetSubsystem<UMBCG_NavSubsystem>();
+    if (!NPCAmbushAvaisionSubsystem || !AttackClusteringSubsystem || !NavSubsystem)
+    {
+        UE_LOGFMT(LogUMBCG_AttackReplayCommandlet, Error, "MBCG subsystems are not available in the replay world.");
+        DestroyStandaloneGameWorld(World);
+        return 1;
+    }
+
+    // the replay world doesn't tick, so death placements are applied right away and their nav work is part of the measured latencies
+    NavSubsystem->SetDeathPlacementsFlushInterval(0.f);
+
+    if (bGridClustering)
+    {
+        AttackClusteringSubsystem->SetClusteringMode(EAttackClusteringMode::Grid);
+    }
+
+    // the recorded clustering contexts (e.g. per team) are recreated, so attacks are replayed into the contexts they were registered in
+    TArray<FName> ClusteringContexts;
+    for (const FAttackRecord& Record : Records)
+    {
+        ClusteringContexts.AddUnique(Record.Context);
+    }
+    AttackClusteringSubsystem->SetClusteringContexts(ClusteringContexts);
+
+    TArray<double> LatenciesMs;
+    LatenciesMs.Reserve(Records.Num());
+
+    // total registration time of each recorded frame
+    TMap<uint32, double> FrameTimesMs;
+
+    const uint64 ReplayStartCycles = FPlatformTime::Cycles64();
+    for (const FAttackRecord& Record : Records)
+    {
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        NPCAmbushAvaisionSubsystem->RegisterNewWeightedAttack(Record.InstigatorLocation, Record.InstigatorDirection, Record.AttackRegistrationType, Record.VictimLocation, Record.VictimDirection, Record.Weight, Record.Context);
+        const double LatencyMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+        LatenciesMs.Add(LatencyMs);
+        FrameTimesMs.FindOrAdd(Record.FrameNumber) += LatencyMs;
+    }
+    const double ReplayMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - ReplayStartCycles);
+
+    const FLatencyStats Stats = FLatencyStats::Calculate(LatenciesMs);
+    UE_LOGFMT(LogUMBCG_AttackReplayCommandlet, Display, "Replay finished: Records = {0}, Frames = {1}, Total = {2} ms, P50 = {3} ms, P99 = {4} ms, Max = {5} ms",  //
+        Records.Num(), FrameTimesMs.Num(), ReplayMs, Stats.P50, Stats.P99, Stats.Max);
+
+    // the frames which cost the most are the candidates for the reproduced hitch
+    FrameTimesMs.ValueSort(TGreater<double>());
+    double MaxFrameTimeMs = 0.0;
+    int32 FrameIdx = 0;
+    for (const TPair<uint32, double>& FrameTime : FrameTimesMs)
+    {
+        if (FrameIdx++ >= WorstFrameCount) break;
+
+        MaxFrameTimeMs = FMath::Max(MaxFrameTimeMs, FrameTime.Value);
+        UE_LOGFMT(LogUMBCG_AttackReplayCommandlet, Display, "- Frame {0}: {1} ms", FrameTime.Key, FrameTime.Value);
+    }
+
+    DestroyStandaloneGameWorld(World);
+
+    // check regression thresholds
+    bool bThresholdExceeded = false;
+    auto CheckThreshold = [&bThresholdExceeded](const TCHAR* Name, double Value, double Threshold)
+    {
+        if (Threshold > 0.0 && Value > Threshold)
+        {
+            UE_LOGFMT(LogUMBCG_AttackReplayCommandlet, Error, "Regression threshold exceeded: {0} = {1} > {2}.", Name, Value, Threshold);
+            bThresholdExceeded = true;
+        }
+    };
+    CheckThreshold(TEXT("P99Ms"), Stats.P99, MaxP99Ms);
+    CheckThreshold(TEXT("FrameMs"), MaxFrameTimeMs, MaxFrameMs);
+
+    return bThresholdExceeded ? 1 : 0;
+}
@@ -0,0 +1,34 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MBCG_AttackReplayCommandlet.generated.h"
+
+
+/**
+ * Replays an attack recording (see FAttackRecorder) through MBCG_NPCAmbushAvaisionSubsystem at full speed and reports timings.
+ * It creates a standalone game world, calls UMBCG_NPCAmbushAvaisionSubsystem::RegisterNewAttack for each record in order and measures
+ * registration latency percentiles as well as the total registration time of each recorded frame, so that a production hitch can be reproduced and profiled.
+ * The commandlet returns non-zero exit code if the recording can't be loaded or any of the regression thresholds is exceeded.
+ *
+ * Usage (headless):
+ *   UnrealEditor-Cmd <Project>.uproject -run=MBCG_AttackReplay -nullrhi -unattended -Recording=<FilePath> [-WorstFrames=10] [-MaxP99Ms=<Ms>] [-MaxFrameMs=<Ms>] [-Grid]
+ *
+ * Clustering contexts of the recorded attacks are set in the replay world before replaying.
+ * Thresholds are not checked unless passed (a threshold <= 0 is not checked either), e.g. -MaxP99Ms=20.0 -MaxFrameMs=33.0 for CI.
+ */
+UCLASS()
+class LYRAGAME_API UMBCG_AttackReplayCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+public:
+
+    UMBCG_AttackReplayCommandlet();
+
+    //~UCommandlet interface
+    virtual int32 Main(const FString& Params) override;
+    //~End of UCommandlet interface
+};
@@ -0,0 +1,44 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Commandlets/MBCG_CommandletHelpers.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+
+namespace MBCG_CommandletHelpers
+{
+    FLatencyStats FLatencyStats::Calculate(TArray<double>& LatenciesMs)
+    {
+        FLatencyStats Stats;
+        if (LatenciesMs.Num() == 0) return Stats;
+
+        LatenciesMs.Sort();
+        Stats.P50 = LatenciesMs[FMath::Clamp(FMath::FloorToInt32(LatenciesMs.Num() * 0.50), 0, LatenciesMs.Num() - 1)];
+        Stats.P99 = LatenciesMs[FMath::Clamp(FMath::FloorToInt32(LatenciesMs.Num() * 0.99), 0, LatenciesMs.Num() - 1)];
+        Stats.Max = LatenciesMs.Last();
+        return Stats;
+    }
+
+
+    UWorld* CreateStandaloneGameWorld(FName WorldName)
+    {
+        UWorld* World = UWorld::CreateWorld(EWorldType::Game, false /* bInformEngineOfWorld */, WorldName);
+        if (!World) return nullptr;
+
+        FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+        WorldContext.SetCurrentWorld(World);
+        World->InitializeActorsForPlay(FURL());
+        World->BeginPlay();
+
+        return World;
+    }
+
+
+    void DestroyStandaloneGameWorld(UWorld* World)
+    {
+        if (!World) return;
+
+        GEngine->DestroyWorldContext(World);
+        World->DestroyWorld(false);
+    }
+}  // namespace MBCG_CommandletHelpers
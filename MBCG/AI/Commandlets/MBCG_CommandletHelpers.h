@@ -0,0 +1,31 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+
+/**
+ * Helpers shared by MBCG headless commandlets (soak, replay etc.)
+ */
+namespace MBCG_CommandletHelpers
+{
+    // Latency statistics over a set of measurements, in milliseconds
+    struct FLatencyStats
+    {
+        double P50 = 0.0;
+        double P99 = 0.0;
+        double Max = 0.0;
+
+        // Note: sorts the input array
+        static FLatencyStats Calculate(TArray<double>& LatenciesMs);
+    };
+
+    // Create a standalone game world with its world context, ready for play. All MBCG subsystems are world subsystems, so such a world is enough to drive them.
+    // Returns nullptr on failure
+    UWorld* CreateStandaloneGameWorld(FName WorldName);
+
+    // Destroy the world created with CreateStandaloneGameWorld()
+    void DestroyStandaloneGameWorld(UWorld* World);
+}  // namespace MBCG_CommandletHelpers
@@ -0,0 +1,248 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Commandlets/MBCG_DeathHeatmapBakeCommandlet.h"
+#include "MBCG/AI/Data/MBCG_AttackRecorder.h"
+#include "MBCG/AI/Data/MBCG_DeathHeatmapDataAsset.h"
+#include "MBCG/AI/Subsystems/MBCG_AttackClusteringSubsystem.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+#include "Logging/StructuredLog.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogUMBCG_DeathHeatmapBakeCommandlet, All, All);
+
+
+namespace MBCG_DeathHeatmapBake
+{
+    // Number of NavArea_Obstacle_TierXX_MBCG classes (see GetNavAreaObstacleTierClass())
+    static constexpr int32 NavAreaObstacleTierCount = 8;
+
+    // Parameters of a bake, parsed from the command line
+    struct FBakeSettings
+    {
+        FString RecordingsDirectory;
+        // bake only this map if specified
+        FString MapName;
+        // clustering context whose deaths are baked, the default one if not specified
+        FName Context = NAME_None;
+        int32 MinDeaths = 2;
+        float ClusterRadius = 175.f;
+        bool bGridClustering = false;
+        bool bDryRun = false;
+
+        void Parse(const FString& Params)
+        {
+            FParse::Value(*Params, TEXT("Recordings="), RecordingsDirectory);
+            FParse::Value(*Params, TEXT("Map="), MapName);
+            FParse::Value(*Params, TEXT("Context="), Context);
+            FParse::Value(*Params, TEXT("MinDeaths="), MinDeaths);
+            FParse::Value(*Params, TEXT("ClusterRadius="), ClusterRadius);
+            bGridClustering = FParse::Param(*Params, TEXT("Grid"));
+            bDryRun = FParse::Param(*Params, TEXT("DryRun"));
+
+            MinDeaths = FMath::Max(1, MinDeaths);
+        }
+    };
+
+    // Heatmap of one map, ready to be saved
+    struct FBakeResult
+    {
+        FString MapName;
+        TArray<FDeathPlacement> DeathPlacements;
+        int32 RecordingCount = 0;
+        int32 DeathCount = 0;
+    };
+
+    // <MapName>_<Timestamp>.mbcgattacks -> <MapName>
+    static FString GetMapNameFromRecordingFileName(const FString& FileName)
+    {
+        const FString BaseFileName = FPaths::GetBaseFilename(FileName);
+
+        int32 SeparatorIdx = INDEX_NONE;
+        return BaseFileName.FindLastChar(TEXT('_'), SeparatorIdx) ? BaseFileName.Left(SeparatorIdx) : BaseFileName;
+    }
+
+    // Cluster victims' locations of all the recordings of one map
+    static FBakeResult BakeMap(const FBakeSettings& Settings, const FString& MapName, const TArray<const TArray<FAttackRecord>*>& Recordings)
+    {
+        FBakeResult Result;
+        Result.MapName = MapName;
+        Result.RecordingCount = Recordings.Num();
+
+        TArray<FClusterEntryRegistration> Registrations;
+        for (const TArray<FAttackRecord>* Records : Recordings)
+        {
+            for (const FAttackRecord& Record : *Records)
+            {
+                // deaths of other contexts (e.g. other teams) would mark places which are not dangerous for this one
+                if (!Record.HasVictim() || Record.Context != Settings.Context) continue;
+
+                FClusterEntryRegistration& Registration = Registrations.AddDefaulted_GetRef();
+                Registration.EntryLocation = Record.VictimLocation;
+                Registration.EntryDirection = Record.VictimDirection;
+                Registration.EntryType = EEntryType::Victim;
+                Registration.Weight = Record.Weight;
+            }
+        }
+        Result.DeathCount = Registrations.Num();
+
+        // the same clustering as in a live match, without a world
+        FAttackClusteringPartition Partition(EEntryType::Victim);
+        Partition.SetMaxClusterRadius(Settings.ClusterRadius);
+        Partition.SetClusteringMode(Settings.bGridClustering ? EAttackClusteringMode::Grid : EAttackClusteringMode::Exact);
+        Partition.RegisterNewClusterEntries(Registrations);
+
+        int32 MaxWeight = 0;
+        for (const FAttackCluster& Cluster : Partition.GetClusters())
+        {
+            if (Cluster.IsValid && Cluster.Weight >= Settings.MinDeaths)
+            {
+                MaxWeight = FMath::Max(MaxWeight, Cluster.Weight);
+            }
+        }
+
+        for (const FAttackCluster& Cluster : Partition.GetClusters())
+        {
+            if (!Cluster.IsValid || Cluster.Weight < Settings.MinDeaths) continue;
+
+            // counts accumulated over many matches are normalized to the obstacle tiers relative to the deadliest place
+            FDeathPlacement& DeathPlacement = Result.DeathPlacements.AddDefaulted_GetRef();
+            DeathPlacement.DeathPlacementID = Result.DeathPlacements.Num() - 1;
+            DeathPlacement.DeathQuantity = FMath::Clamp(FMath::CeilToInt32(static_cast<float>(NavAreaObstacleTierCount) * Cluster.Weight / MaxWeight), 1, NavAreaObstacleTierCount);
+            DeathPlacement.Location = Cluster.CentroidLocation;
+            DeathPlacement.IsValid = true;
+        }
+
+        return Result;
+    }
+
+    // Create or overwrite the heatmap asset of the map
+    static bool SaveBakeResult(const FBakeSettings& Settings, const FBakeResult& Result)
+    {
+#if WITH_EDITOR
+        const FString AssetName = UMBCG_DeathHeatmapDataAsset::GetAssetNameForMap(Result.MapName);
+        const FString PackageName = FString::Printf(TEXT("%s/%s"), UMBCG_DeathHeatmapDataAsset::HeatmapsPackagePath, *AssetName);
+
+        UPackage* Package = CreatePackage(*PackageName);
+        Package->FullyLoad();
+
+        UMBCG_DeathHeatmapDataAsset* DeathHeatmap = FindObject<UMBCG_DeathHeatmapDataAsset>(Package, *AssetName);
+        if (!DeathHeatmap)
+        {
+            DeathHeatmap = NewObject<UMBCG_DeathHeatmapDataAsset>(Package, *AssetName, RF_Public | RF_Standalone);
+        }
+
+        DeathHeatmap->MapName = Result.MapName;
+        DeathHeatmap->DeathPlacements = Result.DeathPlacements;
+        DeathHeatmap->MaxClusterRadius = Settings.ClusterRadius;
+        DeathHeatmap->Context = Settings.Context;
+        DeathHeatmap->SourceRecordingCount = Result.RecordingCount;
+        DeathHeatmap->SourceDeathCount = Result.DeathCount;
+        Package->MarkPackageDirty();
+
+        const FString PackageFileName = FPackageName::LongPackageNameToFilename(PackageName, FPackageName::GetAssetPackageExtension());
+        FSavePackageArgs SaveArgs;
+        SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+        if (!UPackage::SavePackage(Package, DeathHeatmap, *PackageFileName, SaveArgs))
+        {
+            UE_LOGFMT(LogUMBCG_DeathHeatmapBakeCommandlet, Error, "Failed to save {0}.", PackageFileName);
+            return false;
+        }
+
+        UE_LOGFMT(LogUMBCG_DeathHeatmapBakeCommandlet, Display, "Saved {0}.", PackageFileName);
+        return true;
+#else
+        UE_LOGFMT(LogUMBCG_DeathHeatmapBakeCommandlet, Error, "Saving heatmaps requires an editor build.");
+        return false;
+#endif
+    }
+}  // namespace MBCG_DeathHeatmapBake
+
+
+UMBCG_DeathHeatmapBakeCommandlet::UMBCG_DeathHeatmapBakeCommandlet()
+{
+    IsClient = false;
+    IsServer = false;
+    IsEditor = true;
+    LogToConsole = true;
+}
+
+
+int32 UMBCG_DeathHeatmapBakeCommandlet::Main(const FString& Params)
+{
+    using namespace MBCG_DeathHeatmapBake;
+
+    FBakeSettings Settings;
+    Settings.Parse(Params);
+
+    if (Settings.RecordingsDirectory.IsEmpty())
+    {
+        UE_LOGFMT(LogUMBCG_DeathHeatmapBakeCommandlet, Error, "A directory with recordings must be specified with -Recordings=<Directory>.");
+        return 1;
+    }
+
+    TArray<FString> RecordingFileNames;
+    IFileManager::Get().FindFiles(RecordingFileNames, *FPaths::Combine(Settings.RecordingsDirectory, FString(TEXT("*")) + FAttackRecorder::FileExtension), true, false);
+    if (!Settings.MapName.IsEmpty())
+    {
+        RecordingFileNames.RemoveAll([&Settings](const FString& FileName) { return GetMapNameFromRecordingFileName(FileName) != Settings.MapName; });
+    }
+    if (RecordingFileNames.Num() == 0)
+    {
+        UE_LOGFMT(LogUMBCG_DeathHeatmapBakeCommandlet, Error, "No recordings found in {0}.", Settings.RecordingsDirectory);
+        return 1;
+    }
+
+    UE_LOGFMT(LogUMBCG_DeathHeatmapBakeCommandlet, Display, "Bake started: Recordings = {0}, Context = {1}, MinDeaths = {2}, ClusterRadius = {3}",  //
+        RecordingFileNames.Num(), Settings.Context, Settings.MinDeaths, Settings.ClusterRadius);
+
+    // load all recordings in parallel
+    TArray<TArray<FAttackRecord>> Recordings;
+    Recordings.SetNum(RecordingFileNames.Num());
+    TArray<bool> RecordingLoaded;
+    RecordingLoaded.SetNumZeroed(RecordingFileNames.Num());
+    ParallelFor(RecordingFileNames.Num(),
+        [&](int32 FileIdx)
+        {
+            RecordingLoaded[FileIdx] = FAttackRecorder::LoadRecording(FPaths::Combine(Settings.RecordingsDirectory, RecordingFileNames[FileIdx]), Recordings[FileIdx]);
+        });
+
+    // group by map
+    TMap<FString, TArray<const TArray<FAttackRecord>*>> RecordingsByMap;
+    for (int32 FileIdx = 0; FileIdx < RecordingFileNames.Num(); ++FileIdx)
+    {
+        if (!RecordingLoaded[FileIdx]) continue;
+
+        RecordingsByMap.FindOrAdd(GetMapNameFromRecordingFileName(RecordingFileNames[FileIdx])).Add(&Recordings[FileIdx]);
+    }
+
+    // maps never interact, so they are clustered in parallel
+    TArray<FString> MapNames;
+    RecordingsByMap.GenerateKeyArray(MapNames);
+    TArray<FBakeResult> BakeResults;
+    BakeResults.SetNum(MapNames.Num());
+    ParallelFor(MapNames.Num(),
+        [&](int32 MapIdx)
+        {
+            BakeResults[MapIdx] = BakeMap(Settings, MapNames[MapIdx], RecordingsByMap[MapNames[MapIdx]]);
+        });
+
+    // assets are saved on the game thread
+    bool bFailed = false;
+    for (const FBakeResult& BakeResult : BakeResults)
+    {
+        UE_LOGFMT(LogUMBCG_DeathHeatmapBakeCommandlet, Display, "- Map {0}: Recordings = {1}, Deaths = {2}, DeathPlacements = {3}",  //
+            BakeResult.MapName, BakeResult.RecordingCount, BakeResult.DeathCount, BakeResult.DeathPlacements.Num());
+
+        if (!Settings.bDryRun && !SaveBakeResult(Settings, BakeResult))
+        {
+            bFailed = true;
+        }
+    }
+
+    return bFailed ? 1 : 0;
+}
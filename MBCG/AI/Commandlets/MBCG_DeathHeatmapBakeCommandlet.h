@@ -0,0 +1,33 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MBCG_DeathHeatmapBakeCommandlet.generated.h"
+
+
+/**
+ * Bakes death heatmaps (UMBCG_DeathHeatmapDataAsset) from attack recordings (see FAttackRecorder) of many matches.
+ * Recordings are loaded in parallel and grouped by map (file names start with <MapName>_, as written with -MBCGRecordAttacks),
+ * then victims' locations of each map are clustered in bulk (maps in parallel) and the valid clusters are saved as the map's heatmap asset.
+ *
+ * Usage (headless, e.g. on a Linux build machine):
+ *   UnrealEditor-Cmd <Project>.uproject -run=MBCG_DeathHeatmapBake -nullrhi -unattended -Recordings=<Directory> [-Map=<MapName>] [-Context=<ClusteringContext>] [-MinDeaths=2] [-ClusterRadius=175] [-Grid] [-DryRun]
+ *
+ * -Context bakes only deaths of the clustering context (e.g. Team1 with deaths routed by team), the default context if not specified.
+ * -MinDeaths drops clusters with fewer deaths (noise), -DryRun only logs the results without saving assets.
+ */
+UCLASS()
+class LYRAGAME_API UMBCG_DeathHeatmapBakeCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+public:
+
+    UMBCG_DeathHeatmapBakeCommandlet();
+
+    //~UCommandlet interface
+    virtual int32 Main(const FString& Params) override;
+    //~End of UCommandlet interface
+};
@@ -0,0 +1,179 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Components/MBCG_DeathPlacesNavModifierComponent.h"
+#include "NavigationSystem.h"
+#include "AI/Navigation/NavAreaBase.h"
+#include "AI/NavigationModifier.h"
+#include "Logging/StructuredLog.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogUMBCG_DeathPlacesNavModifierComponent, All, All);
+
+
+UMBCG_DeathPlacesNavModifierComponent::UMBCG_DeathPlacesNavModifierComponent(const FObjectInitializer& ObjectInitializer)
+    : Super(ObjectInitializer)
+{
+    // bounds are the death places' ones, not the owner's
+    bAttachToOwnersRoot = false;
+}
+
+
+void UMBCG_DeathPlacesNavModifierComponent::OnRegister()
+{
+    Super::OnRegister();
+
+    // registered once before any death place is set: without modifiers the registration dirties nothing
+    UpdateRegisteredBounds();
+}
+
+
+bool UMBCG_DeathPlacesNavModifierComponent::UpdateRegisteredBounds()
+{
+    const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+    if (!NavSys) return false;
+
+    FBox NewBounds = NavSys->GetWorldBounds();
+    if (!NewBounds.IsValid)
+    {
+        // no navigable bounds (e.g. no nav bounds volume yet): the bounds cover the death places instead,
+        // so a death place outside of them re-registers the component, which dirties the whole bounds
+        NewBounds = RegisteredBounds;
+        for (const TPair<int32, FDeathPlaceModifier>& DeathPlace : DeathPlaces)
+        {
+            NewBounds += DeathPlace.Value.Box;
+        }
+        if (!NewBounds.IsValid) return false;
+
+        if (!RegisteredBounds.IsValid)
+        {
+            UE_LOGFMT(LogUMBCG_DeathPlacesNavModifierComponent, Warning, "UpdateRegisteredBounds(): navigable world bounds are not valid, the bounds follow the death places.");
+        }
+    }
+    if (NewBounds == RegisteredBounds) return false;
+
+    RegisteredBounds = NewBounds;
+    RefreshNavigationModifiers();
+
+    UE_LOGFMT(LogUMBCG_DeathPlacesNavModifierComponent, Verbose, "UpdateRegisteredBounds(): registered with bounds {0}, {1} death places.", RegisteredBounds.ToString(), DeathPlaces.Num());
+    return true;
+}
+
+
+void UMBCG_DeathPlacesNavModifierComponent::GetNavigationData(FNavigationRelevantData& Data) const
+{
+    for (const TPair<int32, FDeathPlaceModifier>& DeathPlace : DeathPlaces)
+    {
+        Data.Modifiers.Add(FAreaNavModifier(DeathPlace.Value.Box, FTransform::Identity, DeathPlace.Value.AreaClass));
+    }
+}
+
+
+void UMBCG_DeathPlacesNavModifierComponent::CalcAndCacheBounds() const
+{
+    Bounds = RegisteredBounds;
+}
+
+
+void UMBCG_DeathPlacesNavModifierComponent::SetDeathPlace(int32 DeathPlaceID, const FBox& Box, TSubclassOf<UNavArea> AreaClass)
+{
+    if (!Box.IsValid || !AreaClass) return;
+
+    RememberFlushedDeathPlace(DeathPlaceID);
+
+    FDeathPlaceModifier& DeathPlace = DeathPlaces.FindOrAdd(DeathPlaceID);
+    DeathPlace.Box = Box;
+    DeathPlace.AreaClass = AreaClass;
+}
+
+
+void UMBCG_DeathPlacesNavModifierComponent::RemoveDeathPlace(int32 DeathPlaceID)
+{
+    if (!DeathPlaces.Contains(DeathPlaceID)) return;
+
+    RememberFlushedDeathPlace(DeathPlaceID);
+    DeathPlaces.Remove(DeathPlaceID);
+}
+
+
+bool UMBCG_DeathPlacesNavModifierComponent::GetDeathPlace(int32 DeathPlaceID, FBox& OutBox, TSubclassOf<UNavArea>& OutAreaClass) const
+{
+    const FDeathPlaceModifier* DeathPlace = DeathPlaces.Find(DeathPlaceID);
+    if (!DeathPlace) return false;
+
+    OutBox = DeathPlace->Box;
+    OutAreaClass = DeathPlace->AreaClass;
+    return true;
+}
+
+
+void UMBCG_DeathPlacesNavModifierComponent::RememberFlushedDeathPlace(int32 DeathPlaceID)
+{
+    if (FlushedDeathPlaces.Contains(DeathPlaceID)) return;
+
+    FlushedDeathPlaces.Add(DeathPlaceID, DeathPlaces.FindRef(DeathPlaceID));
+}
+
+
+void UMBCG_DeathPlacesNavModifierComponent::RemoveContainedDirtyAreas(TArray<FBox>& DirtyAreas)
+{
+    for (int32 idx = DirtyAreas.Num() - 1; idx >= 0; --idx)
+    {
+        for (int32 OtherIdx = 0; OtherIdx < DirtyAreas.Num(); ++OtherIdx)
+        {
+            if (OtherIdx != idx && DirtyAreas[OtherIdx].IsInsideOrOn(DirtyAreas[idx].Min) && DirtyAreas[OtherIdx].IsInsideOrOn(DirtyAreas[idx].Max))
+            {
+                DirtyAreas.RemoveAtSwap(idx);
+                break;
+            }
+        }
+    }
+}
+
+
+void UMBCG_DeathPlacesNavModifierComponent::FlushDeathPlaces()
+{
+    // only the death places which differ from their flushed state are dirtied, both where they were and where they are
+    TArray<FBox> DirtyAreas;
+    for (const TPair<int32, FDeathPlaceModifier>& FlushedDeathPlace : FlushedDeathPlaces)
+    {
+        const FDeathPlaceModifier* DeathPlace = DeathPlaces.Find(FlushedDeathPlace.Key);
+        if (DeathPlace && DeathPlace->Box == FlushedDeathPlace.Value.Box && DeathPlace->AreaClass == FlushedDeathPlace.Value.AreaClass) continue;
+
+        if (FlushedDeathPlace.Value.Box.IsValid)
+        {
+            DirtyAreas.Add(FlushedDeathPlace.Value.Box);
+        }
+        if (DeathPlace)
+        {
+            DirtyAreas.Add(DeathPlace->Box);
+        }
+    }
+    FlushedDeathPlaces.Reset();
+
+    if (DirtyAreas.Num() == 0) return;
+
+    RemoveContainedDirtyAreas(DirtyAreas);
+
+    UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+    if (!NavSys)
+    {
+        UE_LOGFMT(LogUMBCG_DeathPlacesNavModifierComponent, Warning, "FlushDeathPlaces(): Navigation System not found.");
+        return;
+    }
+
+    // the navigable bounds changed (e.g. a level with nav bounds streamed in) or weren't known at registration:
+    // re-registering dirties the whole bounds, but it happens once per such change, not per death place
+    if (UpdateRegisteredBounds()) return;
+
+    // the modifiers are replaced in place and only the changed boxes are dirtied
+    FNavigationRelevantData* NavigationData = NavSys->GetMutableDataForObject(*this);
+    if (!NavigationData)
+    {
+        UE_LOGFMT(LogUMBCG_DeathPlacesNavModifierComponent, Warning, "FlushDeathPlaces(): the component is not in the navigation octree, changes are not applied.");
+        return;
+    }
+
+    NavigationData->Modifiers.Reset();
+    GetNavigationData(*NavigationData);
+    NavSys->AddDirtyAreas(DirtyAreas, ENavigationDirtyFlag::DynamicModifier);
+}
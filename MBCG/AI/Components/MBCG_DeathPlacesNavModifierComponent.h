@@ -0,0 +1,86 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavRelevantComponent.h"
+#include "MBCG_DeathPlacesNavModifierComponent.generated.h"
+
+
+class UNavArea;
+
+
+/**
+ * This component exports all death places as area modifiers of a single navigation-relevant element.
+ * It's an alternative to spawning a AMBCG_DeathPlaceNavModifierVolume per death place: the actor count stays constant and the navigation octree sees one element.
+ *
+ * The component is registered once, before it has any death place, with the navigable world bounds. Death places are changed by SetDeathPlace() / RemoveDeathPlace()
+ * and pushed to navigation by FlushDeathPlaces(), which replaces the modifiers in place and dirties only the boxes that changed.
+ * If the navigable world bounds are not valid, the bounds follow the death places instead, and growing them re-registers the component.
+ *
+ * Cost: the element spans the navigable world, so every tile rebuild anywhere (e.g. by unrelated dynamic modifiers) gathers all of its modifiers
+ * to find the ones overlapping the tile. With many death places and frequent unrelated rebuilds the volumes may be cheaper.
+ * The component is owned by AMBCG_DeathPlacesNavModifier spawned by MBCG_NavSubsystem.
+ */
+UCLASS(ClassGroup = (Custom))
+class LYRAGAME_API UMBCG_DeathPlacesNavModifierComponent : public UNavRelevantComponent
+{
+    GENERATED_BODY()
+
+public:
+
+    UMBCG_DeathPlacesNavModifierComponent(const FObjectInitializer& ObjectInitializer);
+
+    //~INavRelevantInterface
+    virtual void GetNavigationData(FNavigationRelevantData& Data) const override;
+    //~End of INavRelevantInterface
+
+    //~UNavRelevantComponent
+    virtual void OnRegister() override;
+    virtual void CalcAndCacheBounds() const override;
+    //~End of UNavRelevantComponent
+
+    // Set the box and the area class of the death place, replacing its previous state if any. Pushed to navigation by FlushDeathPlaces()
+    void SetDeathPlace(int32 DeathPlaceID, const FBox& Box, TSubclassOf<UNavArea> AreaClass);
+
+    // Remove the death place, does nothing if there is no such death place. Pushed to navigation by FlushDeathPlaces()
+    void RemoveDeathPlace(int32 DeathPlaceID);
+
+    // Push the changes made since the previous flush to navigation
+    void FlushDeathPlaces();
+
+    int32 GetNumDeathPlaces() const { return DeathPlaces.Num(); }
+
+    // Get the current (maybe not flushed yet) state of the death place. Returns false if there is no such death place
+    bool GetDeathPlace(int32 DeathPlaceID, FBox& OutBox, TSubclassOf<UNavArea>& OutAreaClass) const;
+
+private:
+
+    struct FDeathPlaceModifier
+    {
+        FBox Box = FBox(ForceInit);
+        TSubclassOf<UNavArea> AreaClass;
+    };
+
+    // Death places by ID
+    TMap<int32, FDeathPlaceModifier> DeathPlaces;
+
+    // State of the death places changed since the previous flush, as of that flush (Box is invalid for death places which didn't exist then).
+    // Superseded changes collapse: only the flushed and the latest states of a death place are dirtied
+    TMap<int32, FDeathPlaceModifier> FlushedDeathPlaces;
+
+    // Remember the flushed state of the death place before its first change since the previous flush
+    void RememberFlushedDeathPlace(int32 DeathPlaceID);
+
+    // Remove dirty areas contained in other ones (e.g. a death place re-tiered in place). Overlapping areas are not merged:
+    // Recast dedups the tiles of dirty areas anyway, and a union box could cover tiles none of the areas touches
+    static void RemoveContainedDirtyAreas(TArray<FBox>& DirtyAreas);
+
+    // Bounds the component is registered with in the navigation octree: the navigable world bounds, so that every death place fits in
+    // and changes never need re-registering (which would dirty the whole bounds). The bounds of the death places if the navigable world bounds are not valid
+    FBox RegisteredBounds = FBox(ForceInit);
+
+    // Register in the navigation octree with the current navigable world bounds (or the death places' bounds, see RegisteredBounds),
+    // does nothing if they are the registered ones. Returns true if the component was (re-)registered
+    bool UpdateRegisteredBounds();
+};
@@ -12,50 +12,16 @@
 DEFINE_LOG_CATEGORY_STATIC(LogUMBCG_NPCAmbushAvaisionComponent, All, All);
 
 
-bool UMBCG_NPCAmbushAvaisionComponent::IsControlledByAI(APawn* Pawn) const
-{
-    if (!Pawn) return false;
-    AController* Controller = Pawn->GetController();
-    if (!Controller) return false;
-    if (Controller->IsA(AAIController::StaticClass())) return true;
-
-    return false;
-}
-
-
 void UMBCG_NPCAmbushAvaisionComponent::HandleOwnerHealthChanged(ULyraHealthComponent* HealthComponent, float OldValue, float NewValue, AActor* Instigator)
 {
     ALyraCharacter* LyraCharacter = Cast<ALyraCharacter>(GetOwner());
-    if (!LyraCharacter || !IsControlledByAI(LyraCharacter) || !HealthComponent) return;
+    if (!LyraCharacter || !UMBCG_NPCAmbushAvaisionSubsystem::IsControlledByAI(LyraCharacter) || !HealthComponent) return;
     // Deadly damage
     if (NewValue <= 0.f && OldValue > 0.f)
     {
-        if (Instigator)
+        APawn* AssociatedInstigatorPawn = UMBCG_NPCAmbushAvaisionSubsystem::GetAssociatedPawn(Instigator);
+        if (AssociatedInstigatorPawn)
         {
-            APawn* AssociatedInstigatorPawn = nullptr;
-
-            // Try casting to Pawn first
-            AssociatedInstigatorPawn = Cast<APawn>(Instigator);
-
-            if (!AssociatedInstigatorPawn)
-            {
-                // Instigator as a APlayerState is a default method used in Lyra
-                APlayerState* InstigatorPlayerState = Cast<APlayerState>(Instigator);
-                if (InstigatorPlayerState)
-                {
-                    AssociatedInstigatorPawn = InstigatorPlayerState->GetPawn();
-                }
-            }
-
-            if (!AssociatedInstigatorPawn)
-            {
-                AController* InstigatorController = Cast<AController>(Instigator);
-                if (InstigatorController)
-                {
-                    AssociatedInstigatorPawn = InstigatorController->GetPawn();
-                }
-            }
-
 #if 0
             // UE_LOGFMT(LogUMBCG_NPCAmbushAvaisionComponent, Display, "Owner ({0}) was killed by insitgator's ({1}) attack, InstigatorPawn = {2} ", LyraCharacter->GetDebugName(LyraCharacter),
             // Instigator->GetDebugName(Instigator), AssociatedInstigatorPawn->GetDebugName(AssociatedInstigatorPawn));
@@ -68,6 +34,16 @@ void UMBCG_NPCAmbushAvaisionComponent::HandleOwnerHealthChanged(ULyraHealthCompo
                 LyraCharacter->GetActorLocation());
         }
     }
+    // Non-lethal damage is aggregated by the subsystem
+    else if (NewValue < OldValue)
+    {
+        APawn* AssociatedInstigatorPawn = UMBCG_NPCAmbushAvaisionSubsystem::GetAssociatedPawn(Instigator);
+        if (AssociatedInstigatorPawn)
+        {
+            NPCAmbushAvaisionSubsystem->RegisterNonLethalHit(AssociatedInstigatorPawn, AssociatedInstigatorPawn->GetActorLocation(),  //
+                AssociatedInstigatorPawn->GetViewRotation().Vector(), LyraCharacter->GetActorLocation(), OldValue - NewValue);
+        }
+    }
 }
 
 
@@ -78,6 +54,9 @@ void UMBCG_NPCAmbushAvaisionComponent::BeginPlay()
     NPCAmbushAvaisionSubsystem = GetWorld()->GetSubsystem<UMBCG_NPCAmbushAvaisionSubsystem>();
     check(NPCAmbushAvaisionSubsystem);
 
+    // deaths are already reported centrally, binding per pawn would register them twice
+    if (NPCAmbushAvaisionSubsystem->IsListeningToEliminationMessages()) return;
+
     ALyraCharacter* LyraCharacter = Cast<ALyraCharacter>(GetOwner());
     if (LyraCharacter)
     {
@@ -85,6 +64,7 @@ void UMBCG_NPCAmbushAvaisionComponent::BeginPlay()
         if (HealthComponent)
         {
             HealthComponent->OnHealthChanged.AddDynamic(this, &UMBCG_NPCAmbushAvaisionComponent::HandleOwnerHealthChanged);
+            BoundHealthComponent = HealthComponent;
         }
     }
 }
@@ -92,15 +72,12 @@ void UMBCG_NPCAmbushAvaisionComponent::BeginPlay()
 
 void UMBCG_NPCAmbushAvaisionComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-    ALyraCharacter* LyraCharacter = Cast<ALyraCharacter>(GetOwner());
-    if (LyraCharacter)
+    // only unbind if BeginPlay() bound, i.e. the subsystem didn't listen to elimination messages
+    if (ULyraHealthComponent* HealthComponent = BoundHealthComponent.Get())
     {
-        ULyraHealthComponent* HealthComponent = LyraCharacter->FindComponentByClass<ULyraHealthComponent>();
-        if (HealthComponent)
-        {
-            HealthComponent->OnHealthChanged.RemoveDynamic(this, &UMBCG_NPCAmbushAvaisionComponent::HandleOwnerHealthChanged);
-        }
+        HealthComponent->OnHealthChanged.RemoveDynamic(this, &UMBCG_NPCAmbushAvaisionComponent::HandleOwnerHealthChanged);
     }
+    BoundHealthComponent.Reset();
 
     Super::EndPlay(EndPlayReason);
 }
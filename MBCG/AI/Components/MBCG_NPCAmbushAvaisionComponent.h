@@ -8,11 +8,14 @@
 
 
 class UMBCG_NPCAmbushAvaisionSubsystem;
+class ULyraHealthComponent;
 
 
 /**
  * This component allows to use MBCG_NPCAmbushAvaisionSubsystem
  * This component should be added to ALyraCharacter (which is supposed to be an NPC)
+ * The component is optional: by default MBCG_NPCAmbushAvaisionSubsystem registers deaths of AI-controlled pawns from Lyra's elimination messages,
+ * in which case the component does nothing. It's only needed if the subsystem doesn't listen to elimination messages.
  */
 UCLASS(Blueprintable, BlueprintType, ClassGroup = (Custom))
 class LYRAGAME_API UMBCG_NPCAmbushAvaisionComponent : public UPawnComponent
@@ -32,9 +35,8 @@ private:
     UFUNCTION()
     void HandleOwnerHealthChanged(ULyraHealthComponent* HealthComponent, float OldValue, float NewValue, AActor* Instigator);
 
-    // Returns True if Pawn is contolled by AI. Returns False otherwise, also if there is error.
-    // Note that this function should be run only after Pawn is possessed by Controller
-    bool IsControlledByAI(APawn* Pawn) const;
-
     UMBCG_NPCAmbushAvaisionSubsystem* NPCAmbushAvaisionSubsystem;
+
+    // Owner's health component HandleOwnerHealthChanged() is bound to, none if BeginPlay() didn't bind
+    TWeakObjectPtr<ULyraHealthComponent> BoundHealthComponent;
 };
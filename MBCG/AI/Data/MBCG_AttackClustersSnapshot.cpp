@@ -0,0 +1,247 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Data/MBCG_AttackClustersSnapshot.h"
+#include "Algo/BinarySearch.h"
+
+
+FAttackClustersSnapshot::FAttackClustersSnapshot(TConstArrayView<const TArray<FAttackCluster>*> ClustersByPartition, float MaxClusterRadius, uint64 InVersion)
+    : Version(InVersion)
+{
+    // a cell is not smaller than a cluster's diameter
+    CellSize = FMath::Max(2.f * MaxClusterRadius, 1.f);
+
+    // Cell key of every item, to sort items by cell and then by direction sector. Items of all clustering contexts go to the same index of their type
+    const int32 NumEntryTypes = static_cast<int32>(EEntryType::MAX);
+    TArray<TArray<TPair<uint64, FAttackClusterSnapshotItem>>> KeyedItemsByType;
+    KeyedItemsByType.SetNum(NumEntryTypes);
+    for (int32 PartitionIdx = 0; PartitionIdx < ClustersByPartition.Num(); ++PartitionIdx)
+    {
+        if (!ClustersByPartition[PartitionIdx]) continue;
+
+        TArray<TPair<uint64, FAttackClusterSnapshotItem>>& KeyedItems = KeyedItemsByType[PartitionIdx % NumEntryTypes];
+        KeyedItems.Reserve(KeyedItems.Num() + ClustersByPartition[PartitionIdx]->Num());
+        for (const FAttackCluster& Cluster : *ClustersByPartition[PartitionIdx])
+        {
+            if (!Cluster.IsValid || Cluster.EntryIDs.Num() == 0) continue;
+
+            FAttackClusterSnapshotItem Item;
+            Item.ClusterID = Cluster.ClusterID;
+            Item.EntryType = Cluster.EntryType;
+            Item.ContextIdx = PartitionIdx / NumEntryTypes;
+            Item.CentroidLocation = Cluster.CentroidLocation;
+            Item.Direction = Cluster.Direction;
+            Item.Weight = Cluster.Weight;
+            Item.DirectionSector = GetDirectionSector(Cluster.Direction);
+            KeyedItems.Emplace(MakeCellKey(GetCell(Cluster.CentroidLocation)), Item);
+        }
+    }
+
+    TypeData.SetNum(NumEntryTypes);
+    for (int32 TypeIdx = 0; TypeIdx < NumEntryTypes; ++TypeIdx)
+    {
+        FTypeData& Data = TypeData[TypeIdx];
+        TArray<TPair<uint64, FAttackClusterSnapshotItem>>& KeyedItems = KeyedItemsByType[TypeIdx];
+
+        KeyedItems.Sort([](const TPair<uint64, FAttackClusterSnapshotItem>& A, const TPair<uint64, FAttackClusterSnapshotItem>& B)
+            {
+                return A.Key != B.Key ? A.Key < B.Key : A.Value.DirectionSector < B.Value.DirectionSector;
+            });
+
+        Data.Items.Reserve(KeyedItems.Num());
+        for (int32 idx = 0; idx < KeyedItems.Num(); ++idx)
+        {
+            if (idx == 0 || KeyedItems[idx].Key != KeyedItems[idx - 1].Key)
+            {
+                Data.CellKeys.Add(KeyedItems[idx].Key);
+                Data.CellStarts.Add(idx);
+            }
+            Data.Items.Add(KeyedItems[idx].Value);
+        }
+        Data.CellStarts.Add(Data.Items.Num());
+    }
+}
+
+
+FIntPoint FAttackClustersSnapshot::GetCell(const FVector& Location) const
+{
+    return FIntPoint(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize));
+}
+
+
+TConstArrayView<FAttackClusterSnapshotItem> FAttackClustersSnapshot::FTypeData::FindCellItems(uint64 CellKey) const
+{
+    const int32 CellIdx = Algo::BinarySearch(CellKeys, CellKey);
+    if (CellIdx == INDEX_NONE) return {};
+
+    return TConstArrayView<FAttackClusterSnapshotItem>(Items.GetData() + CellStarts[CellIdx], CellStarts[CellIdx + 1] - CellStarts[CellIdx]);
+}
+
+
+float FAttackClustersSnapshot::GetDangerScore(const FVector& Location, float DangerRadius, EEntryType EntryType, int32 ContextIdx) const
+{
+    if (DangerRadius <= 0.f) return 0.f;
+
+    float DangerScore = 0.f;
+    ForEachClusterInRadius(Location, DangerRadius, EntryType,
+        [&](const FAttackClusterSnapshotItem& Item)
+        {
+            const float Distance = FVector::Dist(Item.CentroidLocation, Location);
+            DangerScore += Item.Weight * (1.f - FMath::Min(Distance / DangerRadius, 1.f));
+        },
+        ContextIdx);
+
+    return DangerScore;
+}
+
+
+void FAttackClustersSnapshot::FindNearestClusters(const FVector& Location, int32 K, EEntryType EntryType, TArray<FAttackClusterSnapshotItem>& OutClusters, float MaxDistance, int32 ContextIdx) const
+{
+    OutClusters.Reset();
+
+    const FTypeData& Data = TypeData[static_cast<int32>(EntryType)];
+    if (K <= 0 || MaxDistance < 0.f || Data.Items.Num() == 0) return;
+
+    const double MaxDistanceSquared = static_cast<double>(MaxDistance) * MaxDistance;
+
+    // Candidates (squared distance, item) sorted by distance, at most K of them are kept
+    using FCandidate = TPair<double, const FAttackClusterSnapshotItem*>;
+    TArray<FCandidate, TInlineAllocator<16>> Candidates;
+    auto AddCandidates = [&](TConstArrayView<FAttackClusterSnapshotItem> Items)
+    {
+        for (const FAttackClusterSnapshotItem& Item : Items)
+        {
+            if (ContextIdx != AnyContext && Item.ContextIdx != ContextIdx) continue;
+
+            const double DistanceSquared = FVector::DistSquared(Item.CentroidLocation, Location);
+            if (DistanceSquared > MaxDistanceSquared) continue;
+            if (Candidates.Num() == K && DistanceSquared >= Candidates.Last().Key) continue;
+
+            const int32 InsertIdx = Algo::UpperBoundBy(Candidates, DistanceSquared, [](const FCandidate& Candidate) { return Candidate.Key; });
+            Candidates.Insert(FCandidate(DistanceSquared, &Item), InsertIdx);
+            if (Candidates.Num() > K)
+            {
+                Candidates.Pop();
+            }
+        }
+    };
+
+    // Rings of cells around the Location's cell while they are cheaper than checking all clusters.
+    // After ring R is done, any cluster not checked yet is at least R * CellSize away
+    const FIntPoint CenterCell = GetCell(Location);
+    bool bDone = false;
+    for (int32 Ring = 0; static_cast<int64>(2 * Ring + 1) * (2 * Ring + 1) <= Data.CellKeys.Num(); ++Ring)
+    {
+        for (int32 CellX = CenterCell.X - Ring; CellX <= CenterCell.X + Ring; ++CellX)
+        {
+            // only the ring's border: full rows at the top and bottom, two cells in the other rows
+            const bool bBorderRow = CellX == CenterCell.X - Ring || CellX == CenterCell.X + Ring;
+            for (int32 CellY = CenterCell.Y - Ring; CellY <= CenterCell.Y + Ring; CellY += bBorderRow ? 1 : 2 * Ring)
+            {
+                AddCandidates(Data.FindCellItems(MakeCellKey(FIntPoint(CellX, CellY))));
+            }
+        }
+
+        const double CheckedDistance = static_cast<double>(Ring) * CellSize;
+        if (CheckedDistance * CheckedDistance >= MaxDistanceSquared || (Candidates.Num() == K && Candidates.Last().Key <= CheckedDistance * CheckedDistance))
+        {
+            bDone = true;
+            break;
+        }
+    }
+
+    // sparse clusters far from the Location are cheaper to find by checking all of them
+    if (!bDone)
+    {
+        Candidates.Reset();
+        AddCandidates(Data.Items);
+    }
+
+    OutClusters.Reserve(Candidates.Num());
+    for (const FCandidate& Candidate : Candidates)
+    {
+        OutClusters.Add(*Candidate.Value);
+    }
+}
+
+
+TConstArrayView<FAttackClusterSnapshotItem> FAttackClustersSnapshot::FindSectorItems(TConstArrayView<FAttackClusterSnapshotItem> CellItems, uint8 DirectionSector)
+{
+    // cells hold few items, so both bounds are searched in the cell only
+    const int32 First = Algo::LowerBoundBy(CellItems, DirectionSector, &FAttackClusterSnapshotItem::DirectionSector);
+    const int32 Last = Algo::UpperBoundBy(CellItems, DirectionSector, &FAttackClusterSnapshotItem::DirectionSector);
+    return CellItems.Slice(First, Last - First);
+}
+
+
+uint8 FAttackClustersSnapshot::GetDirectionSector(const FVector& Direction)
+{
+    const FVector Normal = Direction.GetSafeNormal();
+    if (Normal.IsZero()) return NoDirectionSector;
+    if (Normal.Size2D() < MinSectorDirectionHorizontalSize) return SteepDirectionSector;
+
+    // azimuth in [0, 2 * PI]
+    const float Azimuth = FMath::Atan2(Normal.Y, Normal.X) + UE_PI;
+    const int32 Sector = FMath::FloorToInt32(Azimuth / (2.f * UE_PI / NumDirectionSectors));
+    return static_cast<uint8>(FMath::Clamp(Sector, 0, NumDirectionSectors - 1));
+}
+
+
+bool FAttackClustersSnapshotPublisher::Publish(FAttackClustersSnapshotPtr Snapshot)
+{
+    check(IsInGameThread());
+
+    if (Snapshot.IsValid())
+    {
+        PendingSnapshot = MoveTemp(Snapshot);
+    }
+    if (!PendingSnapshot.IsValid()) return true;
+
+    const int32 CurrentSlotIdx = LatestSlotIdx.load();
+    for (int32 SlotIdx = 0; SlotIdx < NumSlots; ++SlotIdx)
+    {
+        // the latest slot and slots pinned by readers are not touched
+        if (SlotIdx == CurrentSlotIdx || Slots[SlotIdx].PinCount.load() != 0) continue;
+
+        Slots[SlotIdx].Snapshot = MoveTemp(PendingSnapshot);
+        LatestSlotIdx.store(SlotIdx);
+        return true;
+    }
+
+    return false;
+}
+
+
+FAttackClustersSnapshotPtr FAttackClustersSnapshotPublisher::GetLatest() const
+{
+    for (;;)
+    {
+        const int32 SlotIdx = LatestSlotIdx.load();
+        if (SlotIdx < 0) return nullptr;
+
+        const FSlot& Slot = Slots[SlotIdx];
+        Slot.PinCount.fetch_add(1);
+
+        // The slot can't be re-filled while pinned. If it is still the latest one after pinning, it is safe to read
+        if (LatestSlotIdx.load() == SlotIdx)
+        {
+            FAttackClustersSnapshotPtr Snapshot = Slot.Snapshot;
+            Slot.PinCount.fetch_sub(1);
+            return Snapshot;
+        }
+
+        Slot.PinCount.fetch_sub(1);
+    }
+}
+
+
+void FAttackClustersSnapshotPublisher::Reset()
+{
+    check(IsInGameThread());
+
+    LatestSlotIdx.store(-1);
+    for (FSlot& Slot : Slots)
+    {
+        Slot.Snapshot.Reset();
+    }
+    PendingSnapshot.Reset();
+}
@@ -0,0 +1,290 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MBCG/AI/Subsystems/MBCG_AttackClusteringSubsystem.h"
+#include <atomic>
+
+/**
+ * Immutable snapshot of attack clusters for concurrent readers (e.g. StateTree tasks or EQS running on worker threads).
+ * UMBCG_AttackClusteringSubsystem publishes a new snapshot after each change batch, readers take the latest one via UMBCG_AttackClusteringSubsystem::GetLatestClustersSnapshot() lock-free
+ * and may keep it as long as they need: the snapshot is reference-counted and is never modified after publishing.
+ */
+
+
+// Compact copy of a valid FAttackCluster without its entries
+struct FAttackClusterSnapshotItem
+{
+    // ID of the cluster in the clustering partition of its EntryType and clustering context
+    int32 ClusterID = -1;
+
+    EEntryType EntryType = EEntryType::Instigator;
+
+    // Index of the cluster's clustering context (see UMBCG_AttackClusteringSubsystem::SetClusteringContexts())
+    int32 ContextIdx = 0;
+
+    FVector CentroidLocation = FVector::ZeroVector;
+
+    // Average normalized direction of the cluster entries
+    FVector Direction = FVector::ZeroVector;
+
+    // Number of registered attacks in the cluster
+    int32 Weight = 0;
+
+    // Direction sector of the cluster (see FAttackClustersSnapshot::GetDirectionSector())
+    uint8 DirectionSector = 0;
+};
+
+
+class LYRAGAME_API FAttackClustersSnapshot
+{
+public:
+
+    // Build a snapshot of valid clusters of all EntryTypes and clustering contexts. Clusters of all contexts share one spatial index
+    // @param ClustersByPartition Clusters of all partitions, with the array index ContextIdx * EEntryType::MAX + EEntryType
+    // @param MaxClusterRadius Defines the spatial index's cell size
+    // @param Version Monotonic number of the change batch the snapshot was made after
+    FAttackClustersSnapshot(TConstArrayView<const TArray<FAttackCluster>*> ClustersByPartition, float MaxClusterRadius, uint64 InVersion);
+
+    uint64 GetVersion() const { return Version; }
+
+    // Queries take the index of the clustering context (0 = default context), or AnyContext for clusters of all contexts
+    static constexpr int32 AnyContext = INDEX_NONE;
+
+    // Valid clusters of the specified type of all clustering contexts
+    TConstArrayView<FAttackClusterSnapshotItem> GetClusters(EEntryType EntryType) const { return TypeData[static_cast<int32>(EntryType)].Items; }
+
+    // Size of the spatial index's cell
+    float GetCellSize() const { return CellSize; }
+
+    // Calls Function(const FAttackClusterSnapshotItem&) for each cluster of the specified type whose centroid is within Radius from Location
+    template <typename FunctionType>
+    void ForEachClusterInRadius(const FVector& Location, float Radius, EEntryType EntryType, FunctionType&& Function, int32 ContextIdx = 0) const;
+
+    // Danger of the location: sum of Weight of the clusters of the specified type within DangerRadius from Location, each falling off linearly with distance.
+    // With DangerRadius not bigger than GetCellSize() only up to 3x3 cells of the index are touched
+    float GetDangerScore(const FVector& Location, float DangerRadius, EEntryType EntryType, int32 ContextIdx = 0) const;
+
+    // Find up to K clusters of the specified type nearest to Location, closest first. Clusters further than MaxDistance are ignored.
+    // Cells are searched in growing rings around Location until no closer cluster can be found, so the cost depends on the local density, not on the number of clusters
+    void FindNearestClusters(const FVector& Location, int32 K, EEntryType EntryType, TArray<FAttackClusterSnapshotItem>& OutClusters, float MaxDistance = UE_MAX_FLT, int32 ContextIdx = 0) const;
+
+    // Calls Function(const FAttackClusterSnapshotItem&) for each instigators' cluster threatening Location from within the cone:
+    // the cluster's centroid is within Radius from Location and within ConeHalfAngleDegrees from ConeDirection as seen from Location,
+    // and the cluster's Direction points at Location within AimToleranceDegrees.
+    // Only the direction sectors which can contain such clusters are touched, so the AI can compare approach angles cheaply.
+    template <typename FunctionType>
+    void ForEachClusterThreateningLocation(const FVector& Location, float Radius, const FVector& ConeDirection, float ConeHalfAngleDegrees, float AimToleranceDegrees, FunctionType&& Function, int32 ContextIdx = 0) const;
+
+    // Directions are binned into NumDirectionSectors equal azimuth sectors.
+    // Steep directions, whose azimuth is unreliable, go to SteepDirectionSector which is always checked by direction queries, zero directions go to NoDirectionSector which is never checked.
+    static constexpr uint8 NumDirectionSectors = 16;
+    static constexpr uint8 SteepDirectionSector = NumDirectionSectors;
+    static constexpr uint8 NoDirectionSector = NumDirectionSectors + 1;
+
+    // Minimum horizontal component of a normalized direction binned by azimuth (cos 45 degrees)
+    static constexpr float MinSectorDirectionHorizontalSize = 0.7071f;
+
+    static uint8 GetDirectionSector(const FVector& Direction);
+
+private:
+
+    // Clusters of one EntryType with the spatial index over them.
+    // The index is a compact uniform 2D grid (X, Y): sorted keys of non-empty cells and, for each cell, a range of Items sorted by cell.
+    struct FTypeData
+    {
+        TArray<FAttackClusterSnapshotItem> Items;
+        // sorted keys of non-empty cells
+        TArray<uint64> CellKeys;
+        // Items of CellKeys[idx] are Items[CellStarts[idx]] .. Items[CellStarts[idx + 1] - 1]
+        TArray<int32> CellStarts;
+
+        // Returns range of Items in the cell, or empty range if the cell is empty. Items of a cell are sorted by DirectionSector
+        TConstArrayView<FAttackClusterSnapshotItem> FindCellItems(uint64 CellKey) const;
+    };
+
+    TArray<FTypeData> TypeData;
+
+    float CellSize = 350.f;
+
+    uint64 Version = 0;
+
+    FIntPoint GetCell(const FVector& Location) const;
+
+    static uint64 MakeCellKey(const FIntPoint& Cell) { return (static_cast<uint64>(static_cast<uint32>(Cell.X)) << 32) | static_cast<uint32>(Cell.Y); }
+
+    // Returns range of the cell's items in the direction sector
+    static TConstArrayView<FAttackClusterSnapshotItem> FindSectorItems(TConstArrayView<FAttackClusterSnapshotItem> CellItems, uint8 DirectionSector);
+};
+
+
+using FAttackClustersSnapshotPtr = TSharedPtr<const FAttackClustersSnapshot, ESPMode::ThreadSafe>;
+
+
+// Publishes snapshots from a single writer (the game thread) to any number of readers on any thread.
+//
+// The latest snapshot lives in one of several slots. A reader pins the slot with an atomic counter while copying the shared pointer out of it, and re-checks that the slot is still the latest one.
+// The writer only fills slots which are neither the latest nor pinned. Readers never take a lock and never see a slot being written, the writer never waits for readers.
+class LYRAGAME_API FAttackClustersSnapshotPublisher
+{
+public:
+
+    // Publish the snapshot as the latest one. Game thread only.
+    // @return False if all slots are pinned by readers at the moment. The snapshot is then kept and published by the next call of Publish()
+    bool Publish(FAttackClustersSnapshotPtr Snapshot);
+
+    // Returns the latest published snapshot or nullptr if nothing was published yet. Thread-safe, lock-free.
+    FAttackClustersSnapshotPtr GetLatest() const;
+
+    // Drop all snapshots. Game thread only, there must be no concurrent readers
+    void Reset();
+
+private:
+
+    static constexpr int32 NumSlots = 4;
+
+    struct FSlot
+    {
+        FAttackClustersSnapshotPtr Snapshot;
+        mutable std::atomic<int32> PinCount{0};
+    };
+
+    FSlot Slots[NumSlots];
+
+    std::atomic<int32> LatestSlotIdx{-1};
+
+    // a snapshot which could not be published because all slots were pinned
+    FAttackClustersSnapshotPtr PendingSnapshot;
+};
+
+
+template <typename FunctionType>
+void FAttackClustersSnapshot::ForEachClusterInRadius(const FVector& Location, float Radius, EEntryType EntryType, FunctionType&& Function, int32 ContextIdx) const
+{
+    const FTypeData& Data = TypeData[static_cast<int32>(EntryType)];
+    if (Data.Items.Num() == 0 || Radius < 0.f) return;
+
+    const FIntPoint MinCell = GetCell(Location - FVector(Radius, Radius, 0.f));
+    const FIntPoint MaxCell = GetCell(Location + FVector(Radius, Radius, 0.f));
+    const double RadiusSquared = static_cast<double>(Radius) * Radius;
+
+    // a huge query area is cheaper to process by checking all clusters
+    const int64 QueryCellCount = static_cast<int64>(MaxCell.X - MinCell.X + 1) * (MaxCell.Y - MinCell.Y + 1);
+    if (QueryCellCount > Data.CellKeys.Num())
+    {
+        for (const FAttackClusterSnapshotItem& Item : Data.Items)
+        {
+            if ((ContextIdx == AnyContext || Item.ContextIdx == ContextIdx) && FVector::DistSquared(Item.CentroidLocation, Location) <= RadiusSquared)
+            {
+                Function(Item);
+            }
+        }
+        return;
+    }
+
+    for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+    {
+        for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+        {
+            for (const FAttackClusterSnapshotItem& Item : Data.FindCellItems(MakeCellKey(FIntPoint(CellX, CellY))))
+            {
+                if ((ContextIdx == AnyContext || Item.ContextIdx == ContextIdx) && FVector::DistSquared(Item.CentroidLocation, Location) <= RadiusSquared)
+                {
+                    Function(Item);
+                }
+            }
+        }
+    }
+}
+
+
+template <typename FunctionType>
+void FAttackClustersSnapshot::ForEachClusterThreateningLocation(const FVector& Location, float Radius, const FVector& ConeDirection, float ConeHalfAngleDegrees, float AimToleranceDegrees, FunctionType&& Function, int32 ContextIdx) const
+{
+    const FTypeData& Data = TypeData[static_cast<int32>(EEntryType::Instigator)];
+    const FVector NormalizedConeDirection = ConeDirection.GetSafeNormal();
+    if (Data.Items.Num() == 0 || Radius < 0.f || NormalizedConeDirection.IsZero()) return;
+
+    const float CosConeHalfAngle = FMath::Cos(FMath::DegreesToRadians(FMath::Clamp(ConeHalfAngleDegrees, 0.f, 180.f)));
+    const float CosAimTolerance = FMath::Cos(FMath::DegreesToRadians(FMath::Clamp(AimToleranceDegrees, 0.f, 180.f)));
+    const double RadiusSquared = static_cast<double>(Radius) * Radius;
+
+    // A threatening cluster aims roughly opposite to ConeDirection: its Direction deviates from that by no more than MaxAimDeviation.
+    // For directions with horizontal size >= H the azimuth chord is at most the 3D chord / H, which bounds the sectors to check.
+    const FVector ExpectedAimDirection = -NormalizedConeDirection;
+    const float MaxAimDeviation = FMath::DegreesToRadians(FMath::Clamp(ConeHalfAngleDegrees, 0.f, 180.f) + FMath::Clamp(AimToleranceDegrees, 0.f, 180.f));
+    const float AzimuthChordBound = FMath::Sin(FMath::Min(MaxAimDeviation, UE_PI) * 0.5f) / MinSectorDirectionHorizontalSize;
+
+    bool bCheckAllSectors = MaxAimDeviation >= UE_PI || AzimuthChordBound >= 1.f || ExpectedAimDirection.Size2D() < MinSectorDirectionHorizontalSize;
+    int32 FirstSector = 0;
+    int32 SectorCount = NumDirectionSectors;
+    if (!bCheckAllSectors)
+    {
+        // a small margin keeps directions on a sector border from being missed due to float precision
+        const float MaxAzimuthDeviation = 2.f * FMath::Asin(AzimuthChordBound) + UE_KINDA_SMALL_NUMBER;
+        const float SectorSize = 2.f * UE_PI / NumDirectionSectors;
+        const float ExpectedAzimuth = FMath::Atan2(ExpectedAimDirection.Y, ExpectedAimDirection.X) + UE_PI;
+        FirstSector = FMath::FloorToInt32((ExpectedAzimuth - MaxAzimuthDeviation) / SectorSize);
+        const int32 LastSector = FMath::FloorToInt32((ExpectedAzimuth + MaxAzimuthDeviation) / SectorSize);
+        SectorCount = LastSector - FirstSector + 1;
+        bCheckAllSectors = SectorCount >= NumDirectionSectors;
+    }
+    if (bCheckAllSectors)
+    {
+        FirstSector = 0;
+        SectorCount = NumDirectionSectors;
+    }
+
+    auto ProcessItems = [&](TConstArrayView<FAttackClusterSnapshotItem> Items)
+    {
+        for (const FAttackClusterSnapshotItem& Item : Items)
+        {
+            if (ContextIdx != AnyContext && Item.ContextIdx != ContextIdx) continue;
+
+            const FVector ToCluster = Item.CentroidLocation - Location;
+            if (ToCluster.SizeSquared() > RadiusSquared) continue;
+
+            const FVector ToClusterNormal = ToCluster.GetSafeNormal();
+            if (ToClusterNormal.IsZero()) continue;
+
+            // within the cone and aiming at the location
+            if (FVector::DotProduct(ToClusterNormal, NormalizedConeDirection) < CosConeHalfAngle) continue;
+            if (FVector::DotProduct(Item.Direction, -ToClusterNormal) < CosAimTolerance) continue;
+
+            Function(Item);
+        }
+    };
+
+    auto ProcessCell = [&](TConstArrayView<FAttackClusterSnapshotItem> CellItems)
+    {
+        for (int32 SectorIdx = 0; SectorIdx < SectorCount; ++SectorIdx)
+        {
+            const uint8 Sector = static_cast<uint8>(((FirstSector + SectorIdx) % NumDirectionSectors + NumDirectionSectors) % NumDirectionSectors);
+            ProcessItems(FindSectorItems(CellItems, Sector));
+        }
+        ProcessItems(FindSectorItems(CellItems, SteepDirectionSector));
+    };
+
+    const FIntPoint MinCell = GetCell(Location - FVector(Radius, Radius, 0.f));
+    const FIntPoint MaxCell = GetCell(Location + FVector(Radius, Radius, 0.f));
+
+    // a huge query area is cheaper to process by checking all cells
+    const int64 QueryCellCount = static_cast<int64>(MaxCell.X - MinCell.X + 1) * (MaxCell.Y - MinCell.Y + 1);
+    if (QueryCellCount > Data.CellKeys.Num())
+    {
+        for (int32 CellIdx = 0; CellIdx < Data.CellKeys.Num(); ++CellIdx)
+        {
+            ProcessCell(TConstArrayView<FAttackClusterSnapshotItem>(Data.Items.GetData() + Data.CellStarts[CellIdx], Data.CellStarts[CellIdx + 1] - Data.CellStarts[CellIdx]));
+        }
+        return;
+    }
+
+    for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+    {
+        for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+        {
+            ProcessCell(Data.FindCellItems(MakeCellKey(FIntPoint(CellX, CellY))));
+        }
+    }
+}
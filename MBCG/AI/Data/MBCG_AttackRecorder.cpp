@@ -0,0 +1,165 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Data/MBCG_AttackRecorder.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Logging/StructuredLog.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogFAttackRecorder, All, All);
+
+
+void FAttackRecord::Serialize(FArchive& Ar, uint32 Version)
+{
+    uint8 AttackRegistrationTypeValue = static_cast<uint8>(AttackRegistrationType);
+
+    Ar << FrameNumber;
+    Ar << AttackRegistrationTypeValue;
+
+    AttackRegistrationType = static_cast<EAttackRegistrationType>(AttackRegistrationTypeValue);
+
+    if (HasInstigator())
+    {
+        Ar << InstigatorLocation;
+        Ar << InstigatorDirection;
+    }
+    if (HasVictim())
+    {
+        Ar << VictimLocation;
+        Ar << VictimDirection;
+    }
+
+    if (Version >= 2)
+    {
+        Ar << Weight;
+    }
+
+    // most attacks are in the default context: a flag, and the context's name only if it's set.
+    // Names are stored as strings since FName indices differ between processes
+    if (Version >= 3)
+    {
+        uint8 bHasContext = Context.IsNone() ? 0 : 1;
+        Ar << bHasContext;
+        if (bHasContext)
+        {
+            FString ContextString = Context.ToString();
+            Ar << ContextString;
+            Context = FName(*ContextString);
+        }
+    }
+}
+
+
+FArchive& operator<<(FArchive& Ar, FAttackRecord& Record)
+{
+    Record.Serialize(Ar, FAttackRecorder::FileVersion);
+    return Ar;
+}
+
+
+FAttackRecorder::FAttackRecorder(const FString& InFilePath, int32 InChunkCapacity)
+    : FilePath(InFilePath)
+    , ChunkCapacity(FMath::Max(1, InChunkCapacity))
+{
+    Writer = TSharedPtr<FArchive, ESPMode::ThreadSafe>(IFileManager::Get().CreateFileWriter(*FilePath));
+    if (!Writer)
+    {
+        UE_LOGFMT(LogFAttackRecorder, Error, "Failed to create the recording file {0}.", FilePath);
+        return;
+    }
+
+    uint32 Magic = FileMagic;
+    uint32 Version = FileVersion;
+    *Writer << Magic;
+    *Writer << Version;
+
+    Chunk.Reserve(ChunkCapacity);
+}
+
+
+FAttackRecorder::~FAttackRecorder()
+{
+    if (!Writer) return;
+
+    Flush();
+    LastWriteTask.Wait();
+
+    Writer->Close();
+    Writer.Reset();
+}
+
+
+void FAttackRecorder::Record(const FAttackRecord& AttackRecord)
+{
+    if (!Writer) return;
+
+    Chunk.Add(AttackRecord);
+    if (Chunk.Num() >= ChunkCapacity)
+    {
+        Flush();
+    }
+}
+
+
+void FAttackRecorder::Flush()
+{
+    if (!Writer || Chunk.Num() == 0) return;
+
+    // the chunk is handed over to the write task, the game thread continues with a new one
+    LastWriteTask = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+        [Writer = Writer, Records = MoveTemp(Chunk)]() mutable
+        {
+            for (FAttackRecord& Record : Records)
+            {
+                *Writer << Record;
+            }
+            Writer->Flush();
+        },
+        UE::Tasks::Prerequisites(LastWriteTask));
+
+    Chunk.Reset();
+    Chunk.Reserve(ChunkCapacity);
+}
+
+
+bool FAttackRecorder::LoadRecording(const FString& FilePath, TArray<FAttackRecord>& OutRecords)
+{
+    OutRecords.Reset();
+
+    TArray<uint8> Data;
+    if (!FFileHelper::LoadFileToArray(Data, *FilePath))
+    {
+        UE_LOGFMT(LogFAttackRecorder, Error, "LoadRecording(): Failed to read {0}.", FilePath);
+        return false;
+    }
+
+    FMemoryReader Reader(Data);
+
+    uint32 Magic = 0;
+    uint32 Version = 0;
+    Reader << Magic;
+    Reader << Version;
+    if (Reader.IsError() || Magic != FileMagic || Version < 1 || Version > FileVersion)
+    {
+        UE_LOGFMT(LogFAttackRecorder, Error, "LoadRecording(): {0} is not a recording of version {1} or older.", FilePath, FileVersion);
+        return false;
+    }
+
+    while (!Reader.AtEnd())
+    {
+        FAttackRecord Record;
+        Record.Serialize(Reader, Version);
+
+        // the process may have died in the middle of writing the last record
+        if (Reader.IsError())
+        {
+            UE_LOGFMT(LogFAttackRecorder, Warning, "LoadRecording(): {0} is truncated, the last record is skipped.", FilePath);
+            break;
+        }
+
+        OutRecords.Add(Record);
+    }
+
+    return true;
+}
@@ -0,0 +1,92 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Task.h"
+#include "MBCG/AI/Subsystems/MBCG_NPCAmbushAvaisionSubsystem.h"
+
+/**
+ * Compact binary recording of attacks registered with UMBCG_NPCAmbushAvaisionSubsystem::RegisterNewAttack, e.g. to reproduce a production hitch.
+ * Recordings are replayed with UMBCG_AttackReplayCommandlet and can serve as benchmark inputs.
+ *
+ * File layout: FileMagic, FileVersion, then FAttackRecord's one after another up to the end of the file.
+ * Each record stores only the locations and directions relevant to its AttackRegistrationType, in full precision so that replay is deterministic.
+ */
+
+
+// One call of UMBCG_NPCAmbushAvaisionSubsystem::RegisterNewAttack
+struct FAttackRecord
+{
+    // GFrameCounter at the moment of the registration
+    uint32 FrameNumber = 0;
+
+    EAttackRegistrationType AttackRegistrationType = EAttackRegistrationType::OnlyInstigator;
+
+    FVector InstigatorLocation = FVector::ZeroVector;
+    FVector InstigatorDirection = FVector::ZeroVector;
+    FVector VictimLocation = FVector::ZeroVector;
+    FVector VictimDirection = FVector::ZeroVector;
+
+    // Number of attacks the record represents (e.g. aggregated non-lethal hits), since FileVersion 2
+    int32 Weight = 1;
+
+    // Clustering context of the attack (see UMBCG_AttackClusteringSubsystem::SetClusteringContexts()), since FileVersion 3.
+    // Attacks of older recordings are in the default context
+    FName Context = NAME_None;
+
+    bool HasInstigator() const { return AttackRegistrationType != EAttackRegistrationType::OnlyVictim; }
+    bool HasVictim() const { return AttackRegistrationType != EAttackRegistrationType::OnlyInstigator; }
+
+    // Serialize in the format of the specified file version
+    void Serialize(FArchive& Ar, uint32 Version);
+
+    // Serialize in the format of the current file version
+    friend FArchive& operator<<(FArchive& Ar, FAttackRecord& Record);
+};
+
+
+// Records attacks on the game thread into fixed-size chunks, full chunks are appended to the file asynchronously (in order) on worker tasks
+class LYRAGAME_API FAttackRecorder
+{
+public:
+
+    static constexpr uint32 FileMagic = 0x5241424D;  // 'MBAR'
+    static constexpr uint32 FileVersion = 3;
+    static constexpr const TCHAR* FileExtension = TEXT(".mbcgattacks");
+
+    // Creates the file and writes the header. Check IsRecording() for success
+    // @param ChunkCapacity Number of records buffered before they are flushed to disk
+    explicit FAttackRecorder(const FString& InFilePath, int32 InChunkCapacity = 1024);
+
+    // Flushes the rest of records and waits until everything is written
+    ~FAttackRecorder();
+
+    bool IsRecording() const { return Writer.IsValid(); }
+
+    const FString& GetFilePath() const { return FilePath; }
+
+    // Add the record to the current chunk. Game thread only
+    void Record(const FAttackRecord& AttackRecord);
+
+    // Submit buffered records for writing without waiting for the chunk to be full
+    void Flush();
+
+    // Load all records of a recording (of the current or an older version). Returns false if the file can't be read or is not a recording
+    static bool LoadRecording(const FString& FilePath, TArray<FAttackRecord>& OutRecords);
+
+private:
+
+    FString FilePath;
+
+    int32 ChunkCapacity = 1024;
+
+    // Records which are not submitted for writing yet
+    TArray<FAttackRecord> Chunk;
+
+    // Used only by write tasks, which are chained so that at most one of them uses it at a time
+    TSharedPtr<FArchive, ESPMode::ThreadSafe> Writer;
+
+    // The last launched write task, prerequisite of the next one
+    UE::Tasks::FTask LastWriteTask;
+};
@@ -0,0 +1,51 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Data/MBCG_DamageAggregator.h"
+
+
+void FDamageAggregator::AddHit(FObjectKey InstigatorKey, const FVector& InstigatorLocation, const FVector& InstigatorDirection, const FVector& VictimLocation, float Damage, double TimeSeconds,  //
+    FName Context)
+{
+    if (Damage <= 0.f) return;
+
+    FBucketKey Key;
+    Key.InstigatorKey = InstigatorKey;
+    Key.VictimCell = FIntVector(FMath::FloorToInt32(VictimLocation.X / CellSize), FMath::FloorToInt32(VictimLocation.Y / CellSize), FMath::FloorToInt32(VictimLocation.Z / CellSize));
+    Key.Context = Context;
+
+    FBucket* Bucket = Buckets.Find(Key);
+    if (!Bucket)
+    {
+        Bucket = &Buckets.Add(Key);
+        Bucket->WindowStartSeconds = TimeSeconds;
+    }
+
+    // locations are averaged with damage as weight
+    Bucket->Damage += Damage;
+    Bucket->HitCount += 1;
+    Bucket->InstigatorLocationSum += InstigatorLocation * Damage;
+    Bucket->InstigatorDirectionSum += InstigatorDirection.GetSafeNormal() * Damage;
+    Bucket->VictimLocationSum += VictimLocation * Damage;
+}
+
+
+void FDamageAggregator::Flush(double TimeSeconds, TArray<FAggregatedAttack>& OutAttacks)
+{
+    for (auto It = Buckets.CreateIterator(); It; ++It)
+    {
+        const FBucket& Bucket = It.Value();
+        if (TimeSeconds - Bucket.WindowStartSeconds < WindowSeconds) continue;
+
+        if (Bucket.Damage >= MinWindowDamage)
+        {
+            FAggregatedAttack& Attack = OutAttacks.AddDefaulted_GetRef();
+            Attack.InstigatorLocation = Bucket.InstigatorLocationSum / Bucket.Damage;
+            Attack.InstigatorDirection = Bucket.InstigatorDirectionSum.GetSafeNormal();
+            Attack.VictimLocation = Bucket.VictimLocationSum / Bucket.Damage;
+            Attack.Weight = FMath::Clamp(FMath::RoundToInt32(Bucket.Damage / DamagePerWeight), 1, MaxWeightPerWindow);
+            Attack.Context = It.Key().Context;
+        }
+
+        It.RemoveCurrent();
+    }
+}
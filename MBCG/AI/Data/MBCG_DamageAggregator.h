@@ -0,0 +1,85 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+
+/**
+ * Aggregates high-frequency non-lethal hits (e.g. sustained suppressive fire) into weighted attacks with bounded clustering load.
+ * Hits are accumulated per instigator, victim's spatial cell and clustering context over a short window. When the window is over,
+ * the bucket emits one attack at the average locations whose weight is proportional to the accumulated damage.
+ */
+
+
+// Attack emitted by FDamageAggregator for one aggregation bucket
+struct FAggregatedAttack
+{
+    FVector InstigatorLocation = FVector::ZeroVector;
+    FVector InstigatorDirection = FVector::ZeroVector;
+    FVector VictimLocation = FVector::ZeroVector;
+    int32 Weight = 1;
+    // Clustering context of the hits (see UMBCG_AttackClusteringSubsystem::SetClusteringContexts())
+    FName Context = NAME_None;
+};
+
+
+class LYRAGAME_API FDamageAggregator
+{
+public:
+
+    // Add a non-lethal hit. Game thread only
+    // @param InstigatorKey Identifies the instigator (e.g. its pawn)
+    // @param TimeSeconds Current world time
+    // @param Context Clustering context of the hit, hits of different contexts are never aggregated together
+    void AddHit(FObjectKey InstigatorKey, const FVector& InstigatorLocation, const FVector& InstigatorDirection, const FVector& VictimLocation, float Damage, double TimeSeconds,  //
+        FName Context = NAME_None);
+
+    // Emit attacks of the buckets whose window is over and remove the buckets. Buckets with less than MinWindowDamage are dropped
+    void Flush(double TimeSeconds, TArray<FAggregatedAttack>& OutAttacks);
+
+    void Reset() { Buckets.Reset(); }
+
+    // Setters
+    // .. Duration of the aggregation window
+    void SetWindowSeconds(float NewWindowSeconds) { WindowSeconds = FMath::Max(0.f, NewWindowSeconds); }
+    // .. Size of the victims' spatial cell
+    void SetCellSize(float NewCellSize) { CellSize = FMath::Max(1.f, NewCellSize); }
+    // .. Damage accumulated in the window which corresponds to one attack of weight 1
+    void SetDamagePerWeight(float NewDamagePerWeight) { DamagePerWeight = FMath::Max(UE_KINDA_SMALL_NUMBER, NewDamagePerWeight); }
+    // .. Minimum damage accumulated in the window to emit an attack
+    void SetMinWindowDamage(float NewMinWindowDamage) { MinWindowDamage = FMath::Max(0.f, NewMinWindowDamage); }
+    // .. Maximum weight of an emitted attack, so that suppression never outweighs deaths too much
+    void SetMaxWeightPerWindow(int32 NewMaxWeightPerWindow) { MaxWeightPerWindow = FMath::Max(1, NewMaxWeightPerWindow); }
+
+private:
+
+    struct FBucketKey
+    {
+        FObjectKey InstigatorKey;
+        FIntVector VictimCell;
+        FName Context;
+
+        bool operator==(const FBucketKey& Other) const { return InstigatorKey == Other.InstigatorKey && VictimCell == Other.VictimCell && Context == Other.Context; }
+        friend uint32 GetTypeHash(const FBucketKey& Key) { return HashCombine(HashCombine(GetTypeHash(Key.InstigatorKey), GetTypeHash(Key.VictimCell)), GetTypeHash(Key.Context)); }
+    };
+
+    struct FBucket
+    {
+        double WindowStartSeconds = 0.0;
+        float Damage = 0.f;
+        int32 HitCount = 0;
+        FVector InstigatorLocationSum = FVector::ZeroVector;
+        FVector InstigatorDirectionSum = FVector::ZeroVector;
+        FVector VictimLocationSum = FVector::ZeroVector;
+    };
+
+    TMap<FBucketKey, FBucket> Buckets;
+
+    // Parameters
+    float WindowSeconds = 0.5f;
+    float CellSize = 200.f;
+    float DamagePerWeight = 50.f;
+    float MinWindowDamage = 20.f;
+    int32 MaxWeightPerWindow = 4;
+};
@@ -0,0 +1,148 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Data/MBCG_DangerPyramid.h"
+
+
+void FDangerPyramid::Reset(float InBaseCellSize, int32 InNumLevels)
+{
+    BaseCellSize = FMath::Max(InBaseCellSize, 1.f);
+    ClusterContributions.Reset();
+    Levels.Reset();
+    // cell coordinates of the coarsest level must fit int32 after shifting
+    Levels.SetNum(FMath::Clamp(InNumLevels, 1, 16));
+}
+
+
+void FDangerPyramid::SetCluster(int32 ClusterID, const FVector& Location, int32 Weight)
+{
+    if (ClusterID < 0) return;
+
+    if (ClusterContributions.Num() <= ClusterID)
+    {
+        ClusterContributions.SetNum(ClusterID + 1);
+    }
+    FClusterContribution& Contribution = ClusterContributions[ClusterID];
+
+    const FIntPoint NewCell = GetBaseCell(FVector2D(Location));
+    const int32 NewWeight = FMath::Max(Weight, 0);
+    if (Contribution.Cell == NewCell && Contribution.Weight == NewWeight) return;
+
+    // remove the previous contribution and add the new one
+    if (Contribution.Weight > 0)
+    {
+        AddWeight(Contribution.Cell, -Contribution.Weight);
+    }
+    if (NewWeight > 0)
+    {
+        AddWeight(NewCell, NewWeight);
+    }
+
+    Contribution.Cell = NewCell;
+    Contribution.Weight = NewWeight;
+}
+
+
+int32 FDangerPyramid::GetCellWeight(const FVector& Location, int32 Level) const
+{
+    if (!Levels.IsValidIndex(Level)) return 0;
+
+    const FIntPoint BaseCell = GetBaseCell(FVector2D(Location));
+    const int32* Weight = Levels[Level].Find(FIntPoint(BaseCell.X >> Level, BaseCell.Y >> Level));
+    return Weight ? *Weight : 0;
+}
+
+
+int32 FDangerPyramid::GetBoxWeight(const FBox2D& Box) const
+{
+    if (!Box.bIsValid || Levels.Num() == 0) return 0;
+
+    // start from the cells of the coarsest level overlapping the box
+    const int32 TopLevel = Levels.Num() - 1;
+    const FIntPoint MinBaseCell = GetBaseCell(Box.Min);
+    const FIntPoint MaxBaseCell = GetBaseCell(Box.Max);
+    const FIntPoint MinCell(MinBaseCell.X >> TopLevel, MinBaseCell.Y >> TopLevel);
+    const FIntPoint MaxCell(MaxBaseCell.X >> TopLevel, MaxBaseCell.Y >> TopLevel);
+
+    int32 BoxWeight = 0;
+
+    // a huge box is cheaper to process by checking all non-empty cells of the coarsest level
+    const int64 BoxCellCount = static_cast<int64>(MaxCell.X - MinCell.X + 1) * (MaxCell.Y - MinCell.Y + 1);
+    if (BoxCellCount > Levels[TopLevel].Num())
+    {
+        for (const TPair<FIntPoint, int32>& CellWeight : Levels[TopLevel])
+        {
+            if (CellWeight.Key.X < MinCell.X || CellWeight.Key.X > MaxCell.X || CellWeight.Key.Y < MinCell.Y || CellWeight.Key.Y > MaxCell.Y) continue;
+
+            AddBoxWeight(Box, TopLevel, CellWeight.Key, BoxWeight);
+        }
+        return BoxWeight;
+    }
+
+    for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+    {
+        for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+        {
+            AddBoxWeight(Box, TopLevel, FIntPoint(CellX, CellY), BoxWeight);
+        }
+    }
+    return BoxWeight;
+}
+
+
+int32 FDangerPyramid::GetLevelForSize(float Size) const
+{
+    for (int32 Level = 0; Level < Levels.Num(); ++Level)
+    {
+        if (GetCellSize(Level) >= Size) return Level;
+    }
+    return Levels.Num() - 1;
+}
+
+
+FIntPoint FDangerPyramid::GetBaseCell(const FVector2D& Location) const
+{
+    return FIntPoint(FMath::FloorToInt32(Location.X / BaseCellSize), FMath::FloorToInt32(Location.Y / BaseCellSize));
+}
+
+
+void FDangerPyramid::AddWeight(const FIntPoint& BaseCell, int32 Weight)
+{
+    for (int32 Level = 0; Level < Levels.Num(); ++Level)
+    {
+        const FIntPoint Cell(BaseCell.X >> Level, BaseCell.Y >> Level);
+        int32& CellWeight = Levels[Level].FindOrAdd(Cell);
+        CellWeight += Weight;
+
+        // keep only non-empty cells
+        if (CellWeight <= 0)
+        {
+            Levels[Level].Remove(Cell);
+        }
+    }
+}
+
+
+void FDangerPyramid::AddBoxWeight(const FBox2D& Box, int32 Level, const FIntPoint& Cell, int32& BoxWeight) const
+{
+    const int32* CellWeight = Levels[Level].Find(Cell);
+    if (!CellWeight) return;
+
+    const float CellSize = GetCellSize(Level);
+    const FBox2D CellBox(FVector2D(Cell.X * CellSize, Cell.Y * CellSize), FVector2D((Cell.X + 1) * CellSize, (Cell.Y + 1) * CellSize));
+    if (!Box.Intersect(CellBox)) return;
+
+    // the whole cell is in the box, or the finest level is reached
+    if (Level == 0 || Box.IsInside(CellBox))
+    {
+        BoxWeight += *CellWeight;
+        return;
+    }
+
+    for (int32 ChildX = 0; ChildX < 2; ++ChildX)
+    {
+        for (int32 ChildY = 0; ChildY < 2; ++ChildY)
+        {
+            AddBoxWeight(Box, Level - 1, FIntPoint(Cell.X * 2 + ChildX, Cell.Y * 2 + ChildY), BoxWeight);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Multi-resolution aggregation of cluster weights for squad- and commander-level AI asking about danger of whole rooms or regions.
+ * Level 0 is a uniform 2D grid (X, Y) of BaseCellSize cells, each next level doubles the cell size, so a cell of level L is the sum of 4 cells of level L - 1.
+ * Each cluster contributes its Weight to one cell per level. A cluster change updates only that cell of every level, O(levels),
+ * and a region's danger is read from a single cell of the matching level instead of summing over all clusters.
+ */
+
+
+class LYRAGAME_API FDangerPyramid
+{
+public:
+
+    // Clear the pyramid and set its layout
+    // @param InBaseCellSize Cell size of the finest level (e.g. the spatial index's cell size)
+    // @param InNumLevels Number of levels including the finest one
+    void Reset(float InBaseCellSize, int32 InNumLevels);
+
+    // Set the cluster's contribution, replacing its previous one. Weight 0 removes the cluster. O(levels)
+    void SetCluster(int32 ClusterID, const FVector& Location, int32 Weight);
+
+    // Sum of weights in the cell of the level containing Location. O(1)
+    int32 GetCellWeight(const FVector& Location, int32 Level) const;
+
+    // Sum of weights in the cell containing Location of the finest level whose cell is at least RegionSize (or of the coarsest level). O(1)
+    int32 GetRegionWeight(const FVector& Location, float RegionSize) const { return GetCellWeight(Location, GetLevelForSize(RegionSize)); }
+
+    // Sum of weights of the clusters in the box (X, Y only) up to the finest level's resolution: cells of the finest level crossing the box border are counted whole.
+    // Cells fully inside the box are taken from the coarsest possible level, so the cost depends on the box's perimeter and the number of levels, not on the number of clusters
+    int32 GetBoxWeight(const FBox2D& Box) const;
+
+    // The finest level whose cell is at least Size, or the coarsest level
+    int32 GetLevelForSize(float Size) const;
+
+    float GetCellSize(int32 Level) const { return BaseCellSize * static_cast<float>(1 << Level); }
+
+    int32 GetNumLevels() const { return Levels.Num(); }
+
+private:
+
+    // Cell of the finest level and weight each cluster contributes, indexed by ClusterID (Weight 0 = no contribution)
+    struct FClusterContribution
+    {
+        FIntPoint Cell = FIntPoint::ZeroValue;
+        int32 Weight = 0;
+    };
+    TArray<FClusterContribution> ClusterContributions;
+
+    // Non-empty cells of each level with their sums of weights. A cell of level L + 1 is (Cell.X >> 1, Cell.Y >> 1) of level L
+    TArray<TMap<FIntPoint, int32>> Levels;
+
+    float BaseCellSize = 350.f;
+
+    FIntPoint GetBaseCell(const FVector2D& Location) const;
+
+    // Add Weight (may be negative) to the cell and its parents on all levels
+    void AddWeight(const FIntPoint& BaseCell, int32 Weight);
+
+    // Add the weight of the box's part within the cell of the level to BoxWeight
+    void AddBoxWeight(const FBox2D& Box, int32 Level, const FIntPoint& Cell, int32& BoxWeight) const;
+};
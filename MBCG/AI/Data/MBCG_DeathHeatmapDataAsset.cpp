@@ -0,0 +1,10 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Data/MBCG_DeathHeatmapDataAsset.h"
+
+
+FSoftObjectPath UMBCG_DeathHeatmapDataAsset::GetAssetPathForMap(const FString& MapName)
+{
+    const FString AssetName = GetAssetNameForMap(MapName);
+    return FSoftObjectPath(FString::Printf(TEXT("%s/%s.%s"), HeatmapsPackagePath, *AssetName, *AssetName));
+}
@@ -0,0 +1,56 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "MBCG/AI/Subsystems/MBCG_NavSubsystem.h"  // for FDeathPlacement
+#include "MBCG_DeathHeatmapDataAsset.generated.h"
+
+/**
+ * Death placements of one map pre-clustered offline from recorded attacks (see UMBCG_DeathHeatmapBakeCommandlet).
+ * MBCG_NavSubsystem loads the asset of the current map at world start, so NPCs avoid historical killzones from the very beginning of a match.
+ *
+ * Assets are found by convention (see GetAssetPathForMap()), so the heatmaps directory must be cooked (e.g. listed in DirectoriesToAlwaysCook).
+ */
+UCLASS(BlueprintType)
+class LYRAGAME_API UMBCG_DeathHeatmapDataAsset : public UDataAsset
+{
+    GENERATED_BODY()
+
+public:
+
+    // Directory of baked heatmap assets
+    static constexpr const TCHAR* HeatmapsPackagePath = TEXT("/Game/MBCG/DeathHeatmaps");
+
+    // Name of the heatmap asset of the map (e.g. DH_L_Expanse for L_Expanse)
+    static FString GetAssetNameForMap(const FString& MapName) { return FString::Printf(TEXT("DH_%s"), *MapName); }
+
+    // Object path of the heatmap asset of the map
+    static FSoftObjectPath GetAssetPathForMap(const FString& MapName);
+
+public:
+
+    // Short name of the map the heatmap was baked for
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Death Heatmap")
+    FString MapName;
+
+    // Historical death placements. DeathPlacementID equals the array index, DeathQuantity is normalized to the NavArea obstacle tiers (1 .. 8) relative to the deadliest placement
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Death Heatmap")
+    TArray<FDeathPlacement> DeathPlacements;
+
+    // Cluster radius the placements were clustered with
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Death Heatmap")
+    float MaxClusterRadius = 0.f;
+
+    // Clustering context the deaths were baked from (see UMBCG_DeathHeatmapBakeCommandlet's -Context)
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Death Heatmap")
+    FName Context = NAME_None;
+
+    // Number of recordings (matches) and deaths the heatmap was baked from
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Death Heatmap")
+    int32 SourceRecordingCount = 0;
+
+    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Death Heatmap")
+    int32 SourceDeathCount = 0;
+};
@@ -0,0 +1,105 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/EQS/MBCG_EnvQueryGenerator_SafePoints.h"
+#include "MBCG/AI/Data/MBCG_AttackClustersSnapshot.h"
+#include "EnvironmentQuery/Contexts/EnvQueryContext_Querier.h"
+#include "Engine/World.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(MBCG_EnvQueryGenerator_SafePoints)
+
+
+#define LOCTEXT_NAMESPACE "MBCG_EnvQueryGenerator_SafePoints"
+
+
+UMBCG_EnvQueryGenerator_SafePoints::UMBCG_EnvQueryGenerator_SafePoints(const FObjectInitializer& ObjectInitializer)
+    : Super(ObjectInitializer)
+{
+    CenterContext = UEnvQueryContext_Querier::StaticClass();
+    SearchRadius.DefaultValue = 3000.f;
+    MaxClusters.DefaultValue = 8;
+    SafeDistance.DefaultValue = 500.f;
+    PointsPerCluster.DefaultValue = 8;
+    MaxDangerScore.DefaultValue = 0.5f;
+}
+
+
+void UMBCG_EnvQueryGenerator_SafePoints::GenerateItems(FEnvQueryInstance& QueryInstance) const
+{
+    UObject* BindOwner = QueryInstance.Owner.Get();
+    const UWorld* World = QueryInstance.World;
+    const UMBCG_AttackClusteringSubsystem* AttackClusteringSubsystem = World ? World->GetSubsystem<UMBCG_AttackClusteringSubsystem>() : nullptr;
+    if (!BindOwner || !AttackClusteringSubsystem) return;
+
+    const int32 ContextIdx = AttackClusteringSubsystem->FindClusteringContext(Context);
+    const FAttackClustersSnapshotPtr Snapshot = AttackClusteringSubsystem->GetLatestClustersSnapshot();
+    if (!Snapshot || ContextIdx == INDEX_NONE || Snapshot->GetClusters(EntryType).Num() == 0) return;
+
+    SearchRadius.BindData(BindOwner, QueryInstance.QueryID);
+    MaxClusters.BindData(BindOwner, QueryInstance.QueryID);
+    SafeDistance.BindData(BindOwner, QueryInstance.QueryID);
+    PointsPerCluster.BindData(BindOwner, QueryInstance.QueryID);
+    MaxDangerScore.BindData(BindOwner, QueryInstance.QueryID);
+
+    const float SearchRadiusValue = SearchRadius.GetValue();
+    const int32 MaxClustersValue = MaxClusters.GetValue();
+    const float SafeDistanceValue = SafeDistance.GetValue();
+    const int32 PointsPerClusterValue = PointsPerCluster.GetValue();
+    const float MaxDangerScoreValue = MaxDangerScore.GetValue();
+    if (MaxClustersValue <= 0 || PointsPerClusterValue <= 0) return;
+
+    TArray<FVector> CenterLocations;
+    QueryInstance.PrepareContext(CenterContext, CenterLocations);
+
+    const float DangerRadius = AttackClusteringSubsystem->GetDangerQueryRadius();
+    const float AngleStep = 2.f * UE_PI / PointsPerClusterValue;
+
+    TArray<FNavLocation> Points;
+    TArray<FAttackClusterSnapshotItem> NearestClusters;
+    for (const FVector& CenterLocation : CenterLocations)
+    {
+        Snapshot->FindNearestClusters(CenterLocation, MaxClustersValue, EntryType, NearestClusters, SearchRadiusValue, ContextIdx);
+
+        for (const FAttackClusterSnapshotItem& Cluster : NearestClusters)
+        {
+            for (int32 PointIdx = 0; PointIdx < PointsPerClusterValue; ++PointIdx)
+            {
+                const float Angle = AngleStep * PointIdx;
+                const FVector Point = Cluster.CentroidLocation + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * SafeDistanceValue;
+
+                // a point of one cluster's ring may be close to another cluster
+                if (Snapshot->GetDangerScore(Point, DangerRadius, EntryType, ContextIdx) > MaxDangerScoreValue) continue;
+
+                Points.Add(FNavLocation(Point));
+            }
+        }
+    }
+
+    ProjectAndFilterNavPoints(Points, QueryInstance);
+    StoreNavPoints(Points, QueryInstance);
+}
+
+
+FText UMBCG_EnvQueryGenerator_SafePoints::GetDescriptionTitle() const
+{
+    return FText::Format(LOCTEXT("DescriptionTitle", "Safe points around {0} clusters near {1}"),
+        UEnum::GetDisplayValueAsText(EntryType), UEnvQueryTypes::DescribeContext(CenterContext));
+}
+
+
+FText UMBCG_EnvQueryGenerator_SafePoints::GetDescriptionDetails() const
+{
+    FText Desc = FText::Format(LOCTEXT("DescriptionDetails", "up to {0} clusters within {1}, {2} points at distance {3}, max danger {4}"),
+        FText::FromString(MaxClusters.ToString()), FText::FromString(SearchRadius.ToString()), FText::FromString(PointsPerCluster.ToString()),
+        FText::FromString(SafeDistance.ToString()), FText::FromString(MaxDangerScore.ToString()));
+
+    const FText ProjectionDesc = ProjectionData.ToText(FEnvTraceData::Brief);
+    if (!ProjectionDesc.IsEmpty())
+    {
+        Desc = FText::Format(LOCTEXT("DescriptionWithProjection", "{0}, {1}"), Desc, ProjectionDesc);
+    }
+
+    return Desc;
+}
+
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,65 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/Generators/EnvQueryGenerator_ProjectedPoints.h"
+#include "DataProviders/AIDataProvider.h"
+#include "MBCG/AI/Subsystems/MBCG_AttackClusteringSubsystem.h"
+#include "MBCG_EnvQueryGenerator_SafePoints.generated.h"
+
+
+/**
+ * Generates safe points around danger clusters nearest to the context: a ring of points around each cluster at SafeDistance from its centroid.
+ * Points whose danger is above MaxDangerScore (e.g. between two close clusters) are dropped, the rest are projected on the navmesh.
+ * Clusters are taken from the spatial index of the clusters' snapshot, so the cost is bounded by MaxClusters * PointsPerCluster regardless of the number of clusters.
+ */
+UCLASS(meta = (DisplayName = "Safe Points Around Attack Clusters"))
+class LYRAGAME_API UMBCG_EnvQueryGenerator_SafePoints : public UEnvQueryGenerator_ProjectedPoints
+{
+    GENERATED_BODY()
+
+public:
+
+    UMBCG_EnvQueryGenerator_SafePoints(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+    //~UEnvQueryGenerator interface
+    virtual void GenerateItems(FEnvQueryInstance& QueryInstance) const override;
+    virtual FText GetDescriptionTitle() const override;
+    virtual FText GetDescriptionDetails() const override;
+    //~End of UEnvQueryGenerator interface
+
+protected:
+
+    // Points are generated around clusters nearest to this context
+    UPROPERTY(EditDefaultsOnly, Category = Generator)
+    TSubclassOf<UEnvQueryContext> CenterContext;
+
+    // Type of clusters to generate points around: places of death (Victim) or ambush places (Instigator)
+    UPROPERTY(EditDefaultsOnly, Category = Generator)
+    EEntryType EntryType = EEntryType::Victim;
+
+    // Clustering context of the clusters (see UMBCG_AttackClusteringSubsystem::SetClusteringContexts()), e.g. the querier's team context. None = default context
+    UPROPERTY(EditDefaultsOnly, Category = Generator)
+    FName Context;
+
+    // Only clusters within this distance from the context are used
+    UPROPERTY(EditDefaultsOnly, Category = Generator)
+    FAIDataProviderFloatValue SearchRadius;
+
+    // Maximum number of clusters (the nearest ones) to generate points around
+    UPROPERTY(EditDefaultsOnly, Category = Generator)
+    FAIDataProviderIntValue MaxClusters;
+
+    // Distance of the points from the cluster's centroid
+    UPROPERTY(EditDefaultsOnly, Category = Generator)
+    FAIDataProviderFloatValue SafeDistance;
+
+    // Number of points in the ring around each cluster
+    UPROPERTY(EditDefaultsOnly, Category = Generator)
+    FAIDataProviderIntValue PointsPerCluster;
+
+    // Points with bigger danger score (see UMBCG_AttackClusteringSubsystem::GetDangerScoreAtLocation()) are not generated
+    UPROPERTY(EditDefaultsOnly, Category = Generator)
+    FAIDataProviderFloatValue MaxDangerScore;
+};
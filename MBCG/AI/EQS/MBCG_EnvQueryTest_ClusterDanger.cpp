@@ -0,0 +1,65 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/EQS/MBCG_EnvQueryTest_ClusterDanger.h"
+#include "MBCG/AI/Data/MBCG_AttackClustersSnapshot.h"
+#include "EnvironmentQuery/Items/EnvQueryItemType_VectorBase.h"
+#include "Engine/World.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(MBCG_EnvQueryTest_ClusterDanger)
+
+
+#define LOCTEXT_NAMESPACE "MBCG_EnvQueryTest_ClusterDanger"
+
+
+UMBCG_EnvQueryTest_ClusterDanger::UMBCG_EnvQueryTest_ClusterDanger(const FObjectInitializer& ObjectInitializer)
+    : Super(ObjectInitializer)
+{
+    // the spatial index makes an item as cheap as a distance test
+    Cost = EEnvTestCost::Low;
+    ValidItemType = UEnvQueryItemType_VectorBase::StaticClass();
+    SetWorkOnFloatValues(true);
+}
+
+
+void UMBCG_EnvQueryTest_ClusterDanger::RunTest(FEnvQueryInstance& QueryInstance) const
+{
+    UObject* QueryOwner = QueryInstance.Owner.Get();
+    const UWorld* World = QueryInstance.World;
+    const UMBCG_AttackClusteringSubsystem* AttackClusteringSubsystem = World ? World->GetSubsystem<UMBCG_AttackClusteringSubsystem>() : nullptr;
+    if (!QueryOwner || !AttackClusteringSubsystem) return;
+
+    FloatValueMin.BindData(QueryOwner, QueryInstance.QueryID);
+    const float MinThresholdValue = FloatValueMin.GetValue();
+
+    FloatValueMax.BindData(QueryOwner, QueryInstance.QueryID);
+    const float MaxThresholdValue = FloatValueMax.GetValue();
+
+    // one snapshot for all items of this run
+    const FAttackClustersSnapshotPtr Snapshot = AttackClusteringSubsystem->GetLatestClustersSnapshot();
+    const float Radius = DangerRadius > 0.f ? DangerRadius : AttackClusteringSubsystem->GetDangerQueryRadius();
+    // an unknown context has no clusters, so there is no danger
+    const int32 ContextIdx = AttackClusteringSubsystem->FindClusteringContext(Context);
+
+    for (FEnvQueryInstance::ItemIterator It(this, QueryInstance); It; ++It)
+    {
+        const FVector ItemLocation = GetItemLocation(QueryInstance, It.GetIndex());
+        const float DangerScore = Snapshot && ContextIdx != INDEX_NONE ? Snapshot->GetDangerScore(ItemLocation, Radius, EntryType, ContextIdx) : 0.f;
+
+        It.SetScore(TestPurpose, FilterType, DangerScore, MinThresholdValue, MaxThresholdValue);
+    }
+}
+
+
+FText UMBCG_EnvQueryTest_ClusterDanger::GetDescriptionTitle() const
+{
+    return FText::Format(LOCTEXT("DescriptionTitle", "{0}: {1} clusters"), Super::GetDescriptionTitle(), UEnum::GetDisplayValueAsText(EntryType));
+}
+
+
+FText UMBCG_EnvQueryTest_ClusterDanger::GetDescriptionDetails() const
+{
+    return DescribeFloatTestParams();
+}
+
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,44 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/EnvQueryTest.h"
+#include "MBCG/AI/Subsystems/MBCG_AttackClusteringSubsystem.h"
+#include "MBCG_EnvQueryTest_ClusterDanger.generated.h"
+
+
+/**
+ * Scores or filters EQS items by danger at their location (see UMBCG_AttackClusteringSubsystem::GetDangerScoreAtLocation()).
+ * All items are scored against one snapshot of the clusters' spatial index pinned per run, each item touches up to 3x3 cells of the index.
+ * The test is time-sliced by the EQS item iterator like built-in tests.
+ */
+UCLASS(meta = (DisplayName = "Attack Cluster Danger"))
+class LYRAGAME_API UMBCG_EnvQueryTest_ClusterDanger : public UEnvQueryTest
+{
+    GENERATED_BODY()
+
+public:
+
+    UMBCG_EnvQueryTest_ClusterDanger(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+protected:
+
+    //~UEnvQueryTest interface
+    virtual void RunTest(FEnvQueryInstance& QueryInstance) const override;
+    virtual FText GetDescriptionTitle() const override;
+    virtual FText GetDescriptionDetails() const override;
+    //~End of UEnvQueryTest interface
+
+    // Type of clusters defining danger: places of death (Victim) or ambush places (Instigator)
+    UPROPERTY(EditDefaultsOnly, Category = Danger)
+    EEntryType EntryType = EEntryType::Victim;
+
+    // Clustering context of the clusters (see UMBCG_AttackClusteringSubsystem::SetClusteringContexts()), e.g. the querier's team context. None = default context
+    UPROPERTY(EditDefaultsOnly, Category = Danger)
+    FName Context;
+
+    // Radius within which clusters contribute to an item's danger, 0 = the subsystem's danger query radius
+    UPROPERTY(EditDefaultsOnly, Category = Danger, meta = (ClampMin = "0.0", UIMin = "0.0"))
+    float DangerRadius = 0.f;
+};
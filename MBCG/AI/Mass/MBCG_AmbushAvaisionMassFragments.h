@@ -0,0 +1,51 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include "MBCG_AmbushAvaisionMassFragments.generated.h"
+
+/**
+ * Mass counterpart of UMBCG_NPCAmbushAvaisionComponent for crowd agents (see UMBCG_AmbushAvaisionMassTrait).
+ * Note: requires MassEntity, MassCommon, MassMovement and MassSpawner modules in the game module's dependencies.
+ */
+
+
+// Lethal event of a Mass agent. Gameplay code which kills the agent sets bPendingLethalEvent,
+// UMBCG_LethalEventCollectorProcessor submits the attack to MBCG_NPCAmbushAvaisionSubsystem and clears the flag.
+USTRUCT()
+struct LYRAGAME_API FMBCG_LethalEventFragment : public FMassFragment
+{
+    GENERATED_BODY()
+
+    // True if the agent was killed since the last collection
+    bool bPendingLethalEvent = false;
+
+    // True if the instigator is known, otherwise only the victim's location is registered
+    bool bHasInstigator = false;
+
+    FVector InstigatorLocation = FVector::ZeroVector;
+
+    FVector InstigatorDirection = FVector::ZeroVector;
+};
+
+
+// Parameters of steering Mass agents away from death places, shared by all agents of the same config
+USTRUCT()
+struct LYRAGAME_API FMBCG_DangerAvoidanceParameters : public FMassSharedFragment
+{
+    GENERATED_BODY()
+
+    // Death places farther than this from the agent don't affect it
+    UPROPERTY(EditAnywhere, Category = "Danger Avoidance", meta = (ClampMin = "0.0", ForceUnits = "cm"))
+    float QueryRadius = 600.f;
+
+    // Maximum steering force applied by one death place
+    UPROPERTY(EditAnywhere, Category = "Danger Avoidance", meta = (ClampMin = "0.0"))
+    float MaxForce = 500.f;
+
+    // Death places with this number of deaths (or more) apply MaxForce, smaller ones apply proportionally less
+    UPROPERTY(EditAnywhere, Category = "Danger Avoidance", meta = (ClampMin = "1"))
+    int32 SaturationWeight = 8;
+};
@@ -0,0 +1,122 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Mass/MBCG_AmbushAvaisionMassProcessors.h"
+#include "MBCG/AI/Mass/MBCG_AmbushAvaisionMassFragments.h"
+#include "MBCG/AI/Data/MBCG_AttackClustersSnapshot.h"
+#include "MBCG/AI/Subsystems/MBCG_NPCAmbushAvaisionSubsystem.h"
+#include "MBCG/AI/Subsystems/MBCG_AttackClusteringSubsystem.h"
+#include "MassCommonFragments.h"
+#include "MassCommonTypes.h"
+#include "MassExecutionContext.h"
+#include "MassMovementFragments.h"
+#include "MassMovementProcessors.h"
+
+
+UMBCG_LethalEventCollectorProcessor::UMBCG_LethalEventCollectorProcessor()
+    : EntityQuery(*this)
+{
+    // deaths are registered by the authority only
+    ExecutionFlags = static_cast<int32>(EProcessorExecutionFlags::Server | EProcessorExecutionFlags::Standalone);
+    ProcessingPhase = EMassProcessingPhase::PostPhysics;
+}
+
+
+void UMBCG_LethalEventCollectorProcessor::ConfigureQueries()
+{
+    EntityQuery.AddRequirement<FMBCG_LethalEventFragment>(EMassFragmentAccess::ReadWrite);
+    EntityQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadOnly);
+}
+
+
+void UMBCG_LethalEventCollectorProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+    UWorld* World = EntityManager.GetWorld();
+    UMBCG_NPCAmbushAvaisionSubsystem* NPCAmbushAvaisionSubsystem = World ? World->GetSubsystem<UMBCG_NPCAmbushAvaisionSubsystem>() : nullptr;
+    if (!NPCAmbushAvaisionSubsystem) return;
+
+    EntityQuery.ParallelForEachEntityChunk(EntityManager, Context,
+        [NPCAmbushAvaisionSubsystem](FMassExecutionContext& ChunkContext)
+        {
+            const TArrayView<FMBCG_LethalEventFragment> LethalEvents = ChunkContext.GetMutableFragmentView<FMBCG_LethalEventFragment>();
+            const TConstArrayView<FTransformFragment> Transforms = ChunkContext.GetFragmentView<FTransformFragment>();
+
+            for (int32 EntityIdx = 0; EntityIdx < ChunkContext.GetNumEntities(); ++EntityIdx)
+            {
+                FMBCG_LethalEventFragment& LethalEvent = LethalEvents[EntityIdx];
+                if (!LethalEvent.bPendingLethalEvent) continue;
+
+                const FVector VictimLocation = Transforms[EntityIdx].GetTransform().GetLocation();
+                if (LethalEvent.bHasInstigator)
+                {
+                    NPCAmbushAvaisionSubsystem->SubmitAttack(LethalEvent.InstigatorLocation, LethalEvent.InstigatorDirection, EAttackRegistrationType::InstigatorAndVictim, VictimLocation);
+                }
+                else
+                {
+                    NPCAmbushAvaisionSubsystem->SubmitAttack(FVector::ZeroVector, FVector::ZeroVector, EAttackRegistrationType::OnlyVictim, VictimLocation);
+                }
+
+                LethalEvent = FMBCG_LethalEventFragment();
+            }
+        });
+}
+
+
+UMBCG_DangerAvoidanceProcessor::UMBCG_DangerAvoidanceProcessor()
+    : EntityQuery(*this)
+{
+    ExecutionFlags = static_cast<int32>(EProcessorExecutionFlags::AllNetModes);
+    // the force is added on top of the one calculated by avoidance (the whole group is done), before it's applied by movement
+    ExecutionOrder.ExecuteInGroup = UE::Mass::ProcessorGroupNames::Movement;
+    ExecutionOrder.ExecuteAfter.Add(UE::Mass::ProcessorGroupNames::Avoidance);
+    ExecutionOrder.ExecuteBefore.Add(UMassApplyForceProcessor::StaticClass()->GetFName());
+}
+
+
+void UMBCG_DangerAvoidanceProcessor::ConfigureQueries()
+{
+    EntityQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadOnly);
+    EntityQuery.AddRequirement<FMassForceFragment>(EMassFragmentAccess::ReadWrite);
+    EntityQuery.AddConstSharedRequirement<FMBCG_DangerAvoidanceParameters>(EMassFragmentPresence::All);
+}
+
+
+void UMBCG_DangerAvoidanceProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+    UWorld* World = EntityManager.GetWorld();
+    const UMBCG_AttackClusteringSubsystem* AttackClusteringSubsystem = World ? World->GetSubsystem<UMBCG_AttackClusteringSubsystem>() : nullptr;
+    if (!AttackClusteringSubsystem) return;
+
+    // one snapshot for the whole frame, shared by all chunks
+    const FAttackClustersSnapshotPtr Snapshot = AttackClusteringSubsystem->GetLatestClustersSnapshot();
+    if (!Snapshot || Snapshot->GetClusters(EEntryType::Victim).Num() == 0) return;
+
+    EntityQuery.ParallelForEachEntityChunk(EntityManager, Context,
+        [&Snapshot](FMassExecutionContext& ChunkContext)
+        {
+            const FMBCG_DangerAvoidanceParameters& Parameters = ChunkContext.GetConstSharedFragment<FMBCG_DangerAvoidanceParameters>();
+            const TConstArrayView<FTransformFragment> Transforms = ChunkContext.GetFragmentView<FTransformFragment>();
+            const TArrayView<FMassForceFragment> Forces = ChunkContext.GetMutableFragmentView<FMassForceFragment>();
+
+            if (Parameters.QueryRadius <= 0.f) return;
+
+            for (int32 EntityIdx = 0; EntityIdx < ChunkContext.GetNumEntities(); ++EntityIdx)
+            {
+                const FVector AgentLocation = Transforms[EntityIdx].GetTransform().GetLocation();
+                FVector DangerForce = FVector::ZeroVector;
+
+                Snapshot->ForEachClusterInRadius(AgentLocation, Parameters.QueryRadius, EEntryType::Victim,
+                    [&](const FAttackClusterSnapshotItem& Cluster)
+                    {
+                        // the closer and the deadlier the place, the stronger it pushes the agent away (in the ground plane)
+                        const FVector AwayFromCluster = (AgentLocation - Cluster.CentroidLocation) * FVector(1.f, 1.f, 0.f);
+                        const float Distance = AwayFromCluster.Size();
+                        const float Proximity = 1.f - FMath::Min(Distance / Parameters.QueryRadius, 1.f);
+                        const float Deadliness = FMath::Min(static_cast<float>(Cluster.Weight) / Parameters.SaturationWeight, 1.f);
+
+                        DangerForce += AwayFromCluster.GetSafeNormal() * Parameters.MaxForce * Proximity * Deadliness;
+                    });
+
+                Forces[EntityIdx].Value += DangerForce;
+            }
+        });
+}
@@ -0,0 +1,60 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassProcessor.h"
+#include "MassEntityQuery.h"
+#include "MBCG_AmbushAvaisionMassProcessors.generated.h"
+
+
+/**
+ * Collects lethal events of Mass agents (FMBCG_LethalEventFragment) and submits them to MBCG_NPCAmbushAvaisionSubsystem.
+ * Chunks are processed in parallel, attacks go through the subsystem's thread-safe SubmitAttack() and are registered as one batch at its next tick.
+ */
+UCLASS()
+class LYRAGAME_API UMBCG_LethalEventCollectorProcessor : public UMassProcessor
+{
+    GENERATED_BODY()
+
+public:
+
+    UMBCG_LethalEventCollectorProcessor();
+
+protected:
+
+    //~UMassProcessor interface
+    virtual void ConfigureQueries() override;
+    virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+    //~End of UMassProcessor interface
+
+private:
+
+    FMassEntityQuery EntityQuery;
+};
+
+
+/**
+ * Steers Mass agents away from death places: adds a repulsive force from each nearby victims' cluster to FMassForceFragment.
+ * Reads the latest immutable clusters snapshot of MBCG_AttackClusteringSubsystem, so chunks are processed in parallel without locking.
+ */
+UCLASS()
+class LYRAGAME_API UMBCG_DangerAvoidanceProcessor : public UMassProcessor
+{
+    GENERATED_BODY()
+
+public:
+
+    UMBCG_DangerAvoidanceProcessor();
+
+protected:
+
+    //~UMassProcessor interface
+    virtual void ConfigureQueries() override;
+    virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+    //~End of UMassProcessor interface
+
+private:
+
+    FMassEntityQuery EntityQuery;
+};
@@ -0,0 +1,19 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Mass/MBCG_AmbushAvaisionMassTrait.h"
+#include "MassEntityTemplateRegistry.h"
+#include "MassEntityUtils.h"
+#include "MassCommonFragments.h"
+#include "MassMovementFragments.h"
+
+
+void UMBCG_AmbushAvaisionMassTrait::BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const
+{
+    BuildContext.AddFragment<FMBCG_LethalEventFragment>();
+    BuildContext.RequireFragment<FTransformFragment>();
+    BuildContext.RequireFragment<FMassForceFragment>();
+
+    FMassEntityManager& EntityManager = UE::Mass::Utils::GetEntityManagerChecked(World);
+    const FConstSharedStruct ParametersFragment = EntityManager.GetOrCreateConstSharedFragment(DangerAvoidanceParameters);
+    BuildContext.AddConstSharedFragment(ParametersFragment);
+}
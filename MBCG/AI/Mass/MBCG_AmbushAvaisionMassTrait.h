@@ -0,0 +1,27 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTraitBase.h"
+#include "MBCG/AI/Mass/MBCG_AmbushAvaisionMassFragments.h"
+#include "MBCG_AmbushAvaisionMassTrait.generated.h"
+
+
+/**
+ * Adds ambush avoidance to Mass agents: their deaths are reported to MBCG_NPCAmbushAvaisionSubsystem and they are steered away from death places.
+ */
+UCLASS(meta = (DisplayName = "MBCG Ambush Avaision"))
+class LYRAGAME_API UMBCG_AmbushAvaisionMassTrait : public UMassEntityTraitBase
+{
+    GENERATED_BODY()
+
+protected:
+
+    //~UMassEntityTraitBase interface
+    virtual void BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const override;
+    //~End of UMassEntityTraitBase interface
+
+    UPROPERTY(EditAnywhere, Category = "Danger Avoidance")
+    FMBCG_DangerAvoidanceParameters DangerAvoidanceParameters;
+};
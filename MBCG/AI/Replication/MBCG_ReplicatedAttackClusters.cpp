@@ -0,0 +1,168 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Replication/MBCG_ReplicatedAttackClusters.h"
+#include "Net/UnrealNetwork.h"
+#include "Engine/World.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(MBCG_ReplicatedAttackClusters)
+
+
+void FMBCG_ReplicatedAttackCluster::PostReplicatedAdd(const FMBCG_ReplicatedAttackClusterArray& InArraySerializer)
+{
+    if (InArraySerializer.Owner)
+    {
+        InArraySerializer.Owner->OnReplicatedAttackClusterChangedDelegate.Broadcast(*this, false /* bRemoved */);
+    }
+}
+
+
+void FMBCG_ReplicatedAttackCluster::PostReplicatedChange(const FMBCG_ReplicatedAttackClusterArray& InArraySerializer)
+{
+    if (InArraySerializer.Owner)
+    {
+        InArraySerializer.Owner->OnReplicatedAttackClusterChangedDelegate.Broadcast(*this, false /* bRemoved */);
+    }
+}
+
+
+void FMBCG_ReplicatedAttackCluster::PreReplicatedRemove(const FMBCG_ReplicatedAttackClusterArray& InArraySerializer)
+{
+    if (InArraySerializer.Owner)
+    {
+        InArraySerializer.Owner->OnReplicatedAttackClusterChangedDelegate.Broadcast(*this, true /* bRemoved */);
+    }
+}
+
+
+void FMBCG_ReplicatedAttackClusterArray::SetCluster(const FAttackCluster& Cluster, int32 ContextIdx)
+{
+    // the number of clustering contexts is limited to fit ContextIdx (see UMBCG_AttackClusteringSubsystem::SetClusteringContexts())
+    if (Cluster.ClusterID < 0 || ContextIdx < 0 || ContextIdx > MAX_uint8) return;
+
+    const uint64 ItemKey = MakeItemKey(ContextIdx, Cluster.EntryType, Cluster.ClusterID);
+    const int32* ItemIdxPtr = ItemIdxByKey.Find(ItemKey);
+
+    // merged or emptied clusters are removed
+    if (!Cluster.IsValid || Cluster.EntryIDs.Num() == 0)
+    {
+        if (!ItemIdxPtr) return;
+
+        const int32 ItemIdx = *ItemIdxPtr;
+        ItemIdxByKey.Remove(ItemKey);
+        Items.RemoveAtSwap(ItemIdx);
+        if (Items.IsValidIndex(ItemIdx))
+        {
+            // the last item took the removed item's place
+            ItemIdxByKey.Add(MakeItemKey(Items[ItemIdx].ContextIdx, Items[ItemIdx].EntryType, Items[ItemIdx].ClusterID), ItemIdx);
+        }
+        MarkArrayDirty();
+        return;
+    }
+
+    const int32 ItemIdx = ItemIdxPtr ? *ItemIdxPtr : Items.AddDefaulted();
+    if (!ItemIdxPtr)
+    {
+        ItemIdxByKey.Add(ItemKey, ItemIdx);
+    }
+
+    FMBCG_ReplicatedAttackCluster& Item = Items[ItemIdx];
+    Item.ClusterID = Cluster.ClusterID;
+    Item.EntryType = Cluster.EntryType;
+    Item.ContextIdx = static_cast<uint8>(ContextIdx);
+    Item.CentroidLocation = Cluster.CentroidLocation;
+    Item.Direction = Cluster.Direction;
+    Item.Weight = static_cast<uint16>(FMath::Clamp(Cluster.Weight, 0, static_cast<int32>(MAX_uint16)));
+    MarkItemDirty(Item);
+}
+
+
+void FMBCG_ReplicatedAttackClusterArray::Reset()
+{
+    Items.Empty();
+    ItemIdxByKey.Empty();
+    MarkArrayDirty();
+}
+
+
+AMBCG_ReplicatedAttackClusters::AMBCG_ReplicatedAttackClusters(const FObjectInitializer& ObjectInitializer)
+    : Super(ObjectInitializer)
+{
+    bReplicates = true;
+    bAlwaysRelevant = true;
+    // changes come in batches, no need to check the actor every frame
+    NetUpdateFrequency = 10.f;
+
+    ReplicatedClusters.Owner = this;
+}
+
+
+void AMBCG_ReplicatedAttackClusters::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+    Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+    DOREPLIFETIME(AMBCG_ReplicatedAttackClusters, ReplicatedClusters);
+}
+
+
+void AMBCG_ReplicatedAttackClusters::BeginPlay()
+{
+    Super::BeginPlay();
+
+    ReplicatedClusters.Owner = this;
+
+    AttackClusteringSubsystem = GetWorld()->GetSubsystem<UMBCG_AttackClusteringSubsystem>();
+    if (!AttackClusteringSubsystem) return;
+
+    // clients find the actor via the subsystem
+    AttackClusteringSubsystem->SetReplicatedClustersActor(this);
+
+    if (!HasAuthority()) return;
+
+    // the clusters registered before the actor was spawned, then changes of each registration batch
+    const TArray<FName>& ClusteringContexts = AttackClusteringSubsystem->GetClusteringContexts();
+    for (int32 ContextIdx = 0; ContextIdx < ClusteringContexts.Num(); ++ContextIdx)
+    {
+        for (int32 TypeIdx = 0; TypeIdx < static_cast<int32>(EEntryType::MAX); ++TypeIdx)
+        {
+            for (const FAttackCluster& Cluster : AttackClusteringSubsystem->GetContextClusters(static_cast<EEntryType>(TypeIdx), ClusteringContexts[ContextIdx]))
+            {
+                ReplicatedClusters.SetCluster(Cluster, ContextIdx);
+            }
+        }
+    }
+    AttackClusteringSubsystem->OnAttackClustersChangeSetDelegate.AddDynamic(this, &AMBCG_ReplicatedAttackClusters::OnAttackClustersChangeSet);
+}
+
+
+void AMBCG_ReplicatedAttackClusters::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    if (AttackClusteringSubsystem)
+    {
+        AttackClusteringSubsystem->OnAttackClustersChangeSetDelegate.RemoveDynamic(this, &AMBCG_ReplicatedAttackClusters::OnAttackClustersChangeSet);
+        if (AttackClusteringSubsystem->GetReplicatedClustersActor() == this)
+        {
+            AttackClusteringSubsystem->SetReplicatedClustersActor(nullptr);
+        }
+    }
+
+    Super::EndPlay(EndPlayReason);
+}
+
+
+void AMBCG_ReplicatedAttackClusters::OnAttackClustersChangeSet(const FAttackClustersChangeSet& ChangeSet)
+{
+    for (int32 TypeIdx = 0; TypeIdx < static_cast<int32>(EEntryType::MAX); ++TypeIdx)
+    {
+        const EEntryType EntryType = static_cast<EEntryType>(TypeIdx);
+        const TArray<FAttackCluster>& Clusters = AttackClusteringSubsystem->GetContextClusters(EntryType, ChangeSet.Context);
+
+        // the payload is indexed by cluster ID, -1 for unchanged clusters
+        for (const int32 ClusterID : ChangeSet.GetPayload(EntryType))
+        {
+            if (Clusters.IsValidIndex(ClusterID))
+            {
+                ReplicatedClusters.SetCluster(Clusters[ClusterID], ChangeSet.ContextIdx);
+            }
+        }
+    }
+}
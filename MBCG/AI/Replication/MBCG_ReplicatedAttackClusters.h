@@ -0,0 +1,138 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "MBCG/AI/Subsystems/MBCG_AttackClusteringSubsystem.h"
+#include "MBCG_ReplicatedAttackClusters.generated.h"
+
+
+/**
+ * Replicates attack clusters of the server's UMBCG_AttackClusteringSubsystem to clients (listen-server hosts' clients, spectator tools, client-side AI prediction).
+ * Clusters are kept in a FFastArraySerializer, so only clusters changed by a registration batch are sent, with quantized centroids, directions and weights:
+ * bandwidth is proportional to churn, not to the total number of registered attacks.
+ * The actor is spawned by the subsystem on the server (see UMBCG_AttackClusteringSubsystem::SetReplicateClustersToClients()).
+ */
+
+
+class AMBCG_ReplicatedAttackClusters;
+
+// Replicated compact copy of a valid FAttackCluster
+USTRUCT(BlueprintType)
+struct FMBCG_ReplicatedAttackCluster : public FFastArraySerializerItem
+{
+    GENERATED_BODY()
+
+    // ID of the cluster in the clustering partition of its EntryType and clustering context on the server
+    UPROPERTY(BlueprintReadOnly)
+    int32 ClusterID = -1;
+
+    UPROPERTY(BlueprintReadOnly)
+    EEntryType EntryType = EEntryType::Instigator;
+
+    // Index of the cluster's clustering context on the server (see UMBCG_AttackClusteringSubsystem::GetClusteringContexts())
+    UPROPERTY(BlueprintReadOnly)
+    uint8 ContextIdx = 0;
+
+    // 0.1 cm precision
+    UPROPERTY(BlueprintReadOnly)
+    FVector_NetQuantize10 CentroidLocation = FVector::ZeroVector;
+
+    UPROPERTY(BlueprintReadOnly)
+    FVector_NetQuantizeNormal Direction = FVector::ZeroVector;
+
+    // Number of registered attacks in the cluster, saturated at MAX_uint16 (not exposed to Blueprint which doesn't support uint16)
+    UPROPERTY()
+    uint16 Weight = 0;
+
+    void PostReplicatedAdd(const struct FMBCG_ReplicatedAttackClusterArray& InArraySerializer);
+    void PostReplicatedChange(const struct FMBCG_ReplicatedAttackClusterArray& InArraySerializer);
+    void PreReplicatedRemove(const struct FMBCG_ReplicatedAttackClusterArray& InArraySerializer);
+};
+
+
+USTRUCT()
+struct FMBCG_ReplicatedAttackClusterArray : public FFastArraySerializer
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    TArray<FMBCG_ReplicatedAttackCluster> Items;
+
+    // Owner notified on clients about replicated changes
+    UPROPERTY(NotReplicated)
+    TObjectPtr<AMBCG_ReplicatedAttackClusters> Owner = nullptr;
+
+    // Server only
+    // .. Add, update or remove (if the cluster is invalid) the item of the cluster of the clustering context
+    void SetCluster(const FAttackCluster& Cluster, int32 ContextIdx = 0);
+
+    // .. Remove all items
+    void Reset();
+
+    bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+    {
+        return FFastArraySerializer::FastArrayDeltaSerialize<FMBCG_ReplicatedAttackCluster, FMBCG_ReplicatedAttackClusterArray>(Items, DeltaParms, *this);
+    }
+
+private:
+
+    // Index of the item of each cluster by MakeItemKey(), server only
+    TMap<uint64, int32> ItemIdxByKey;
+
+    static uint64 MakeItemKey(int32 ContextIdx, EEntryType EntryType, int32 ClusterID)
+    {
+        return (static_cast<uint64>(ContextIdx) << 40) | (static_cast<uint64>(EntryType) << 32) | static_cast<uint32>(ClusterID);
+    }
+};
+
+template <>
+struct TStructOpsTypeTraits<FMBCG_ReplicatedAttackClusterArray> : public TStructOpsTypeTraitsBase2<FMBCG_ReplicatedAttackClusterArray>
+{
+    enum
+    {
+        WithNetDeltaSerializer = true,
+    };
+};
+
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnReplicatedAttackClusterChanged, const FMBCG_ReplicatedAttackCluster&, Cluster, bool, bRemoved);
+
+
+UCLASS(NotPlaceable, Transient)
+class LYRAGAME_API AMBCG_ReplicatedAttackClusters : public AInfo
+{
+    GENERATED_BODY()
+
+public:
+
+    AMBCG_ReplicatedAttackClusters(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+    //~AActor interface
+    virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+    virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+    //~End of AActor interface
+
+    // Replicated clusters of all EntryTypes and clustering contexts, in no particular order
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    const TArray<FMBCG_ReplicatedAttackCluster>& GetReplicatedClusters() const { return ReplicatedClusters.Items; }
+
+    // Delegate for broadcasting on clients when a replicated cluster is added, changed or removed
+    UPROPERTY(BlueprintAssignable)
+    FOnReplicatedAttackClusterChanged OnReplicatedAttackClusterChangedDelegate;
+
+private:
+
+    UPROPERTY(Replicated)
+    FMBCG_ReplicatedAttackClusterArray ReplicatedClusters;
+
+    UPROPERTY()
+    TObjectPtr<UMBCG_AttackClusteringSubsystem> AttackClusteringSubsystem;
+
+    // Server: copy the changed clusters to the replicated array
+    UFUNCTION()
+    void OnAttackClustersChangeSet(const FAttackClustersChangeSet& ChangeSet);
+};
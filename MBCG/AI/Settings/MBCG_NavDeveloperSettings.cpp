@@ -0,0 +1,9 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Settings/MBCG_NavDeveloperSettings.h"
+
+
+UMBCG_NavDeveloperSettings::UMBCG_NavDeveloperSettings()
+{
+    CategoryName = TEXT("Game");
+}
@@ -0,0 +1,50 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "MBCG_NavDeveloperSettings.generated.h"
+
+
+// Navigation settings of one map, read by MBCG_NavSubsystem at world begin play
+USTRUCT()
+struct FMBCG_MapNavSettings
+{
+    GENERATED_BODY()
+
+    // Number of dormant death place volumes prewarmed for live death placements on the map (0 = MBCG_NavSubsystem's default, see SetDeathNavModifierVolumePoolSize())
+    UPROPERTY(EditAnywhere, Category = "Death Places", meta = (ClampMin = "0", UIMin = "0"))
+    int32 NavModifierVolumePoolSize = 0;
+
+    // Represent death places on the map by a single navigation-relevant component instead of volumes (see UMBCG_NavSubsystem::SetUseDeathPlacesNavModifier()).
+    // Read at world begin play before the heatmap is applied, so nothing is spawned as volumes
+    UPROPERTY(EditAnywhere, Category = "Death Places")
+    bool bUseDeathPlacesNavModifier = false;
+};
+
+
+/**
+ * Per-map navigation settings of MBCG (Project Settings > Game > MBCG Navigation).
+ * Unlike the functions of MBCG_NavSubsystem they are known before the world begins play, so they apply to maps without any gameplay code or baked heatmap.
+ */
+UCLASS(Config = Game, DefaultConfig, meta = (DisplayName = "MBCG Navigation"))
+class LYRAGAME_API UMBCG_NavDeveloperSettings : public UDeveloperSettings
+{
+    GENERATED_BODY()
+
+public:
+
+    UMBCG_NavDeveloperSettings();
+
+    static const UMBCG_NavDeveloperSettings* Get() { return GetDefault<UMBCG_NavDeveloperSettings>(); }
+
+    // Settings of the map, nullptr if there are none
+    const FMBCG_MapNavSettings* FindMapSettings(const FString& MapName) const { return MapSettings.Find(FName(*MapName)); }
+
+private:
+
+    // Settings by short name of the map (e.g. L_Expanse)
+    UPROPERTY(Config, EditAnywhere, Category = "Death Places")
+    TMap<FName, FMBCG_MapNavSettings> MapSettings;
+};
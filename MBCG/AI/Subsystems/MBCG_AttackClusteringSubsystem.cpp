@@ -1,82 +1,773 @@
 // Copyright DevRespawn.com (MBCG). All Rights Reserved.
 
 #include "MBCG/AI/Subsystems/MBCG_AttackClusteringSubsystem.h"
+#include "MBCG/AI/Data/MBCG_AttackClustersSnapshot.h"
+#include "MBCG/AI/Subsystems/MBCG_ClusteringSchedulerSubsystem.h"
+#include "MBCG/AI/Telemetry/MBCG_ClusteringTelemetry.h"
+#include "MBCG/AI/Replication/MBCG_ReplicatedAttackClusters.h"
 #include "MBCG/FunctionLibraries/MBCG_BPFL_Utils.h"  // for SafeSetNum()
 #include "Logging/StructuredLog.h"
+#include "Tasks/Task.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Hash/CityHash.h"
+#include "HAL/PlatformTime.h"
 
 
 DEFINE_LOG_CATEGORY_STATIC(LogUMBCG_AttackClusteringSubsystem, All, All);
 
 
-namespace MBCG_AttackClusteringSubsystem_Debug
+void FAttackCluster::UpdateCentroidProperties(const TArray<FClusterEntry>& ClusterEntries)
+{
+    if (EntryIDs.Num() == 0)
+    {
+        CentroidLocation = FVector::ZeroVector;
+        Direction = FVector::ZeroVector;
+        Weight = 0;
+        return;
+    }
+
+    FVector LocationSum = FVector::ZeroVector;
+    FVector DirectionSum = FVector::ZeroVector;
+    int32 WeightSum = 0;
+
+    for (int32 EntryID : EntryIDs)
+    {
+        const FClusterEntry& ClusterEntry = ClusterEntries[EntryID];
+        LocationSum += ClusterEntry.EntryLocation * ClusterEntry.Weight;
+        DirectionSum += ClusterEntry.EntryDirection * ClusterEntry.Weight;
+        WeightSum += ClusterEntry.Weight;
+    }
+
+    Weight = WeightSum;
+    CentroidLocation = WeightSum > 0 ? LocationSum / WeightSum : FVector::ZeroVector;
+    Direction = DirectionSum.GetSafeNormal();
+}
+
+
+void FAttackCluster::AddEntry(const FClusterEntry& ClusterEntry)
+{
+    EntryIDs.Add(ClusterEntry.EntryID);
+    Weight += ClusterEntry.Weight;
+}
+
+
+void FAttackCluster::RemoveEntry(const FClusterEntry& ClusterEntry)
+{
+    if (EntryIDs.Remove(ClusterEntry.EntryID) > 0)
+    {
+        Weight -= ClusterEntry.Weight;
+    }
+}
+
+
+void UMBCG_AttackClusteringSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+    Super::Initialize(Collection);
+
+    Partitions.Empty();
+    CreatePartitions();
+
+    FClusteringTelemetry::Get().StartFromCommandLine();
+
+    // readers always get a snapshot, even before the first registration
+    SnapshotPublisher = MakePimpl<FAttackClustersSnapshotPublisher>();
+    PublishClustersSnapshot();
+}
+
+
+void UMBCG_AttackClusteringSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+    Super::OnWorldBeginPlay(InWorld);
+
+    // clusters are registered by the authority, clients get them replicated (standalone games have no clients)
+    const ENetMode NetMode = InWorld.GetNetMode();
+    if (!bReplicateClustersToClients || !InWorld.IsGameWorld() || NetMode == NM_Client || NetMode == NM_Standalone) return;
+
+    FActorSpawnParameters SpawnParameters;
+    SpawnParameters.ObjectFlags |= RF_Transient;
+    ReplicatedClustersActor = InWorld.SpawnActor<AMBCG_ReplicatedAttackClusters>(SpawnParameters);
+    if (!ReplicatedClustersActor)
+    {
+        UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Error, "OnWorldBeginPlay(): Unexpected: Spawning AMBCG_ReplicatedAttackClusters failed, clusters are not replicated.");
+    }
+}
+
+
+void UMBCG_AttackClusteringSubsystem::Deinitialize()
+{
+    Super::Deinitialize();
+
+    // waits for the scheduled job, if any, since it works on the partitions
+    if (ClusteringSchedulerClientID != INDEX_NONE)
+    {
+        if (UMBCG_ClusteringSchedulerSubsystem* ClusteringScheduler = GEngine ? GEngine->GetEngineSubsystem<UMBCG_ClusteringSchedulerSubsystem>() : nullptr)
+        {
+            ClusteringScheduler->UnregisterClient(ClusteringSchedulerClientID);
+        }
+        ClusteringSchedulerClientID = INDEX_NONE;
+    }
+    ReplicatedClustersActor = nullptr;
+    PendingRegistrations.Empty();
+    InFlightRegistrations.Empty();
+    InFlightProcessedPartitionIdxs.Empty();
+    bScheduledBatchInFlight = false;
+
+    // Clear all data
+    for (FAttackClusteringPartition& Partition : Partitions)
+    {
+        Partition.Reset();
+    }
+    DangerPyramids.Empty();
+    if (SnapshotPublisher)
+    {
+        SnapshotPublisher->Reset();
+    }
+}
+
+
+FAttackClustersSnapshotPtr UMBCG_AttackClusteringSubsystem::GetLatestClustersSnapshot() const
+{
+    return SnapshotPublisher ? SnapshotPublisher->GetLatest() : nullptr;
+}
+
+
+void UMBCG_AttackClusteringSubsystem::CreatePartitions()
+{
+    // one clustering partition per clustering context and EntryType, see GetPartitionIdx()
+    TArray<FAttackClusteringPartition> NewPartitions;
+    NewPartitions.Reserve(ClusteringContexts.Num() * static_cast<int32>(EEntryType::MAX));
+    for (int32 ContextIdx = 0; ContextIdx < ClusteringContexts.Num(); ++ContextIdx)
+    {
+        for (int32 TypeIdx = 0; TypeIdx < static_cast<int32>(EEntryType::MAX); ++TypeIdx)
+        {
+            // the default context's partitions carry the settings made so far
+            if (Partitions.IsValidIndex(TypeIdx))
+            {
+                NewPartitions.Add_GetRef(Partitions[TypeIdx]).Reset();
+            }
+            else
+            {
+                NewPartitions.Emplace_GetRef(static_cast<EEntryType>(TypeIdx)).SetMaxClusterRadius(MaxClusterRadius);
+            }
+        }
+    }
+    Partitions = MoveTemp(NewPartitions);
+
+    DangerPyramids.Empty(Partitions.Num());
+    DangerPyramids.SetNum(Partitions.Num());
+    RebuildDangerPyramids();
+}
+
+
+void UMBCG_AttackClusteringSubsystem::SetClusteringContexts(const TArray<FName>& NewClusteringContexts)
+{
+    check(IsInGameThread());
+
+    for (FAttackClusteringPartition& Partition : Partitions)
+    {
+        if (Partition.GetClusterEntries().Num() > 0)
+        {
+            UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "SetClusteringContexts(): Clustering contexts can't be changed after cluster entries were registered.");
+            return;
+        }
+    }
+    if (bScheduledBatchInFlight || PendingRegistrations.Num() > 0)
+    {
+        UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "SetClusteringContexts(): Clustering contexts can't be changed while registrations are in flight.");
+        return;
+    }
+
+    ClusteringContexts.Reset();
+    ClusteringContexts.Add(NAME_None);
+    for (const FName Context : NewClusteringContexts)
+    {
+        if (!Context.IsNone())
+        {
+            ClusteringContexts.AddUnique(Context);
+        }
+    }
+    if (ClusteringContexts.Num() > MaxClusteringContexts)
+    {
+        UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "SetClusteringContexts(): Only {0} clustering contexts are supported, the rest are ignored.", MaxClusteringContexts);
+        ClusteringContexts.SetNum(MaxClusteringContexts);
+    }
+
+    CreatePartitions();
+    PublishClustersSnapshot();
+}
+
+
+bool UMBCG_AttackClusteringSubsystem::SoftCheckNoScheduledBatchInFlight(const TCHAR* FunctionName) const
+{
+    if (!bScheduledBatchInFlight) return true;
+
+    UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "{0}(): the partitions are being clustered by a scheduled batch, they can't be used until it's done.", FunctionName);
+    return false;
+}
+
+
+const TArray<FClusterEntry>& UMBCG_AttackClusteringSubsystem::GetClusterEntries(EEntryType EntryType) const
+{
+    static const TArray<FClusterEntry> NoClusterEntries;
+
+    return SoftCheckNoScheduledBatchInFlight(TEXT("GetClusterEntries")) ? GetPartition(EntryType).GetClusterEntries() : NoClusterEntries;
+}
+
+
+const TArray<FAttackCluster>& UMBCG_AttackClusteringSubsystem::GetClusters(EEntryType EntryType) const
+{
+    static const TArray<FAttackCluster> NoClusters;
+
+    return SoftCheckNoScheduledBatchInFlight(TEXT("GetClusters")) ? GetPartition(EntryType).GetClusters() : NoClusters;
+}
+
+
+const TArray<FAttackCluster>& UMBCG_AttackClusteringSubsystem::GetContextClusters(EEntryType EntryType, FName Context) const
+{
+    static const TArray<FAttackCluster> NoClusters;
+    if (!SoftCheckNoScheduledBatchInFlight(TEXT("GetContextClusters"))) return NoClusters;
+
+    const int32 ContextIdx = FindClusteringContext(Context);
+    return ContextIdx != INDEX_NONE ? GetPartition(EntryType, ContextIdx).GetClusters() : NoClusters;
+}
+
+
+void UMBCG_AttackClusteringSubsystem::PublishClustersSnapshot()
+{
+    TArray<const TArray<FAttackCluster>*> ClustersByPartition;
+    for (const FAttackClusteringPartition& Partition : Partitions)
+    {
+        ClustersByPartition.Add(&Partition.GetClusters());
+    }
+
+    ++SnapshotVersion;
+    SnapshotPublisher->Publish(MakeShared<FAttackClustersSnapshot, ESPMode::ThreadSafe>(ClustersByPartition, MaxClusterRadius, SnapshotVersion));
+}
+
+
+void UMBCG_AttackClusteringSubsystem::SetMaxClusterRadius(float NewMaxClusterRadius)
+{
+    if (!SoftCheckNoScheduledBatchInFlight(TEXT("SetMaxClusterRadius"))) return;
+
+    MaxClusterRadius = NewMaxClusterRadius;
+
+    for (FAttackClusteringPartition& Partition : Partitions)
+    {
+        Partition.SetMaxClusterRadius(NewMaxClusterRadius);
+    }
+
+    // the pyramids' finest cell follows the cluster size
+    RebuildDangerPyramids();
+}
+
+
+void UMBCG_AttackClusteringSubsystem::SetReassignmentHysteresis(float NewReassignmentHysteresis)
+{
+    if (!SoftCheckNoScheduledBatchInFlight(TEXT("SetReassignmentHysteresis"))) return;
+
+    for (FAttackClusteringPartition& Partition : Partitions)
+    {
+        Partition.SetReassignmentHysteresis(NewReassignmentHysteresis);
+    }
+}
+
+
+void UMBCG_AttackClusteringSubsystem::SetMaxReassignmentPasses(int32 NewMaxReassignmentPasses)
+{
+    if (!SoftCheckNoScheduledBatchInFlight(TEXT("SetMaxReassignmentPasses"))) return;
+
+    for (FAttackClusteringPartition& Partition : Partitions)
+    {
+        Partition.SetMaxReassignmentPasses(NewMaxReassignmentPasses);
+    }
+}
+
+
+void UMBCG_AttackClusteringSubsystem::SetEntryCoalescingRadius(float NewEntryCoalescingRadius)
+{
+    if (!SoftCheckNoScheduledBatchInFlight(TEXT("SetEntryCoalescingRadius"))) return;
+
+    for (FAttackClusteringPartition& Partition : Partitions)
+    {
+        Partition.SetEntryCoalescingRadius(NewEntryCoalescingRadius);
+    }
+}
+
+
+void UMBCG_AttackClusteringSubsystem::SetClusteringMode(EAttackClusteringMode NewClusteringMode)
+{
+    if (!SoftCheckNoScheduledBatchInFlight(TEXT("SetClusteringMode"))) return;
+
+    for (FAttackClusteringPartition& Partition : Partitions)
+    {
+        if (Partition.GetClusterEntries().Num() > 0)
+        {
+            UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "SetClusteringMode(): Clustering mode can't be changed after cluster entries were registered.");
+            return;
+        }
+    }
+
+    for (FAttackClusteringPartition& Partition : Partitions)
+    {
+        Partition.SetClusteringMode(NewClusteringMode);
+    }
+}
+
+
+void UMBCG_AttackClusteringSubsystem::RegisterNewClusterEntry(const FVector& EntryLocation, const FVector& EntryDirection, const EEntryType EntryType)
+{
+    FClusterEntryRegistration Registration;
+    Registration.EntryLocation = EntryLocation;
+    Registration.EntryDirection = EntryDirection;
+    Registration.EntryType = EntryType;
+
+    RegisterNewClusterEntries({Registration});
+}
+
+
+void UMBCG_AttackClusteringSubsystem::SetUseSharedClusteringScheduler(bool bNewUseSharedClusteringScheduler)
+{
+    if (bNewUseSharedClusteringScheduler == (ClusteringSchedulerClientID != INDEX_NONE)) return;
+    if (!SoftCheckNoScheduledBatchInFlight(TEXT("SetUseSharedClusteringScheduler"))) return;
+
+    for (FAttackClusteringPartition& Partition : Partitions)
+    {
+        if (Partition.GetClusterEntries().Num() > 0)
+        {
+            UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "SetUseSharedClusteringScheduler(): Scheduling can't be changed after cluster entries were registered.");
+            return;
+        }
+    }
+
+    UMBCG_ClusteringSchedulerSubsystem* ClusteringScheduler = GEngine ? GEngine->GetEngineSubsystem<UMBCG_ClusteringSchedulerSubsystem>() : nullptr;
+    if (!ClusteringScheduler)
+    {
+        UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Error, "SetUseSharedClusteringScheduler(): ClusteringScheduler is not valid.");
+        return;
+    }
+
+    if (bNewUseSharedClusteringScheduler)
+    {
+        ClusteringSchedulerClientID = ClusteringScheduler->RegisterClient(GetWorld() ? GetWorld()->GetName() : GetName());
+    }
+    else if (!bScheduledBatchInFlight && PendingRegistrations.Num() == 0)
+    {
+        ClusteringScheduler->UnregisterClient(ClusteringSchedulerClientID);
+        ClusteringSchedulerClientID = INDEX_NONE;
+    }
+    else
+    {
+        UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "SetUseSharedClusteringScheduler(): Scheduling can't be disabled while registrations are in flight.");
+    }
+}
+
+
+void UMBCG_AttackClusteringSubsystem::SetMaxRegistrationsPerScheduledBatch(int32 NewMaxRegistrationsPerScheduledBatch)
+{
+    MaxRegistrationsPerScheduledBatch = FMath::Max(1, NewMaxRegistrationsPerScheduledBatch);
+}
+
+
+void UMBCG_AttackClusteringSubsystem::SetDangerPyramidNumLevels(int32 NewDangerPyramidNumLevels)
+{
+    // rebuilding reads the partitions' clusters
+    if (!SoftCheckNoScheduledBatchInFlight(TEXT("SetDangerPyramidNumLevels"))) return;
+
+    DangerPyramidNumLevels = FMath::Max(1, NewDangerPyramidNumLevels);
+    RebuildDangerPyramids();
+}
+
+
+int32 UMBCG_AttackClusteringSubsystem::GetRegionDanger(const FVector& Location, float RegionSize, EEntryType EntryType, FName Context) const
+{
+    check(IsInGameThread());
+
+    const int32 ContextIdx = FindClusteringContext(Context);
+    if (ContextIdx == INDEX_NONE || !DangerPyramids.IsValidIndex(GetPartitionIdx(EntryType, ContextIdx))) return 0;
+
+    return GetDangerPyramid(EntryType, ContextIdx).GetRegionWeight(Location, RegionSize);
+}
+
+
+int32 UMBCG_AttackClusteringSubsystem::GetDangerInBox(const FBox& Box, EEntryType EntryType, FName Context) const
+{
+    check(IsInGameThread());
+
+    const int32 ContextIdx = FindClusteringContext(Context);
+    if (ContextIdx == INDEX_NONE || !DangerPyramids.IsValidIndex(GetPartitionIdx(EntryType, ContextIdx)) || !Box.IsValid) return 0;
+
+    return GetDangerPyramid(EntryType, ContextIdx).GetBoxWeight(FBox2D(FVector2D(Box.Min), FVector2D(Box.Max)));
+}
+
+
+void UMBCG_AttackClusteringSubsystem::UpdateDangerPyramid(int32 PartitionIdx)
+{
+    const FAttackClusteringPartition& Partition = Partitions[PartitionIdx];
+    FDangerPyramid& DangerPyramid = DangerPyramids[PartitionIdx];
+    const TArray<FAttackCluster>& PartitionClusters = Partition.GetClusters();
+
+    // the payload is indexed by cluster ID, -1 for unchanged clusters
+    for (const int32 ClusterID : Partition.GetChangedClustersIDsPayload())
+    {
+        if (!PartitionClusters.IsValidIndex(ClusterID)) continue;
+
+        const FAttackCluster& Cluster = PartitionClusters[ClusterID];
+        DangerPyramid.SetCluster(ClusterID, Cluster.CentroidLocation, Cluster.IsValid ? Cluster.Weight : 0);
+    }
+}
+
+
+void UMBCG_AttackClusteringSubsystem::RebuildDangerPyramids()
+{
+    for (int32 PartitionIdx = 0; PartitionIdx < DangerPyramids.Num() && PartitionIdx < Partitions.Num(); ++PartitionIdx)
+    {
+        FDangerPyramid& DangerPyramid = DangerPyramids[PartitionIdx];
+        DangerPyramid.Reset(2.f * MaxClusterRadius, DangerPyramidNumLevels);
+
+        for (const FAttackCluster& Cluster : Partitions[PartitionIdx].GetClusters())
+        {
+            if (Cluster.IsValid)
+            {
+                DangerPyramid.SetCluster(Cluster.ClusterID, Cluster.CentroidLocation, Cluster.Weight);
+            }
+        }
+    }
+}
+
+
+void UMBCG_AttackClusteringSubsystem::SetDangerQueryRadius(float NewDangerQueryRadius)
+{
+    DangerQueryRadius = FMath::Max(0.f, NewDangerQueryRadius);
+}
+
+
+float UMBCG_AttackClusteringSubsystem::GetDangerScoreAtLocation(const FVector& Location, EEntryType EntryType, FName Context) const
+{
+    const int32 ContextIdx = FindClusteringContext(Context);
+    if (ContextIdx == INDEX_NONE) return 0.f;
+
+    const FAttackClustersSnapshotPtr Snapshot = GetLatestClustersSnapshot();
+    return Snapshot ? Snapshot->GetDangerScore(Location, DangerQueryRadius, EntryType, ContextIdx) : 0.f;
+}
+
+
+void UMBCG_AttackClusteringSubsystem::GetDangerScoresAtLocations(const TArray<FVector>& Locations, EEntryType EntryType, TArray<float>& OutDangerScores, FName Context) const
+{
+    OutDangerScores.Reset();
+    OutDangerScores.SetNumZeroed(Locations.Num());
+
+    const int32 ContextIdx = FindClusteringContext(Context);
+    const FAttackClustersSnapshotPtr Snapshot = GetLatestClustersSnapshot();
+    if (!Snapshot || ContextIdx == INDEX_NONE) return;
+
+    ParallelFor(Locations.Num(), [&](int32 LocationIdx)
+        {
+            OutDangerScores[LocationIdx] = Snapshot->GetDangerScore(Locations[LocationIdx], DangerQueryRadius, EntryType, ContextIdx);
+        },
+        Locations.Num() < MinLocationsForParallelQuery ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+
+TArray<int32> UMBCG_AttackClusteringSubsystem::FindClustersInRadius(const FVector& Location, float Radius, EEntryType EntryType, FName Context) const
+{
+    TArray<int32> ClusterIDs;
+    const int32 ContextIdx = FindClusteringContext(Context);
+    if (ContextIdx == INDEX_NONE) return ClusterIDs;
+
+    if (const FAttackClustersSnapshotPtr Snapshot = GetLatestClustersSnapshot())
+    {
+        Snapshot->ForEachClusterInRadius(Location, Radius, EntryType,
+            [&ClusterIDs](const FAttackClusterSnapshotItem& Item)
+            {
+                ClusterIDs.Add(Item.ClusterID);
+            },
+            ContextIdx);
+    }
+    return ClusterIDs;
+}
+
+
+void UMBCG_AttackClusteringSubsystem::FindClustersInRadiusOfLocations(const TArray<FVector>& Locations, float Radius, EEntryType EntryType, TArray<int32>& OutClusterIDs, TArray<int32>& OutClusterCounts, FName Context) const
+{
+    OutClusterIDs.Reset();
+    OutClusterCounts.Reset();
+    OutClusterCounts.SetNumZeroed(Locations.Num());
+
+    const int32 ContextIdx = FindClusteringContext(Context);
+    const FAttackClustersSnapshotPtr Snapshot = GetLatestClustersSnapshot();
+    if (!Snapshot || ContextIdx == INDEX_NONE) return;
+
+    for (int32 LocationIdx = 0; LocationIdx < Locations.Num(); ++LocationIdx)
+    {
+        const int32 FirstIdx = OutClusterIDs.Num();
+        Snapshot->ForEachClusterInRadius(Locations[LocationIdx], Radius, EntryType,
+            [&OutClusterIDs](const FAttackClusterSnapshotItem& Item)
+            {
+                OutClusterIDs.Add(Item.ClusterID);
+            },
+            ContextIdx);
+        OutClusterCounts[LocationIdx] = OutClusterIDs.Num() - FirstIdx;
+    }
+}
+
+
+TArray<int32> UMBCG_AttackClusteringSubsystem::FindNearestClusters(const FVector& Location, int32 K, EEntryType EntryType, FName Context) const
+{
+    TArray<int32> ClusterIDs;
+    const int32 ContextIdx = FindClusteringContext(Context);
+    if (ContextIdx == INDEX_NONE) return ClusterIDs;
+
+    if (const FAttackClustersSnapshotPtr Snapshot = GetLatestClustersSnapshot())
+    {
+        TArray<FAttackClusterSnapshotItem> NearestClusters;
+        Snapshot->FindNearestClusters(Location, K, EntryType, NearestClusters, UE_MAX_FLT, ContextIdx);
+        for (const FAttackClusterSnapshotItem& Item : NearestClusters)
+        {
+            ClusterIDs.Add(Item.ClusterID);
+        }
+    }
+    return ClusterIDs;
+}
+
+
+void UMBCG_AttackClusteringSubsystem::FindNearestClustersOfLocations(const TArray<FVector>& Locations, int32 K, EEntryType EntryType, TArray<int32>& OutClusterIDs, FName Context) const
+{
+    OutClusterIDs.Reset();
+    if (K <= 0) return;
+
+    OutClusterIDs.Init(INDEX_NONE, Locations.Num() * K);
+
+    const int32 ContextIdx = FindClusteringContext(Context);
+    const FAttackClustersSnapshotPtr Snapshot = GetLatestClustersSnapshot();
+    if (!Snapshot || ContextIdx == INDEX_NONE) return;
+
+    // every location writes to its own K slots, so locations can be processed in parallel
+    ParallelFor(Locations.Num(), [&](int32 LocationIdx)
+        {
+            TArray<FAttackClusterSnapshotItem> NearestClusters;
+            Snapshot->FindNearestClusters(Locations[LocationIdx], K, EntryType, NearestClusters, UE_MAX_FLT, ContextIdx);
+            for (int32 idx = 0; idx < NearestClusters.Num(); ++idx)
+            {
+                OutClusterIDs[LocationIdx * K + idx] = NearestClusters[idx].ClusterID;
+            }
+        },
+        Locations.Num() < MinLocationsForParallelQuery ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+
+void UMBCG_AttackClusteringSubsystem::RegisterNewClusterEntries(const TArray<FClusterEntryRegistration>& Registrations)
+{
+    check(IsInGameThread());
+
+    if (ClusteringSchedulerClientID != INDEX_NONE)
+    {
+        // clustered on the shared scheduler, listeners are notified when the batch is done
+        PendingRegistrations.Append(Registrations);
+        SubmitPendingRegistrations();
+        return;
+    }
+
+    BroadcastClustersChanged(ClusterRegistrations(Registrations));
+}
+
+
+void UMBCG_AttackClusteringSubsystem::SubmitPendingRegistrations()
 {
-    int32 RecursionDepth = 0;
+    if (bScheduledBatchInFlight || PendingRegistrations.Num() == 0) return;
 
-    // Remembers RecursionDepth as a maximum of input Depth argument
-    static void SetRecursionDepthIfNeeded(const int32 Depth)
+    UMBCG_ClusteringSchedulerSubsystem* ClusteringScheduler = GEngine ? GEngine->GetEngineSubsystem<UMBCG_ClusteringSchedulerSubsystem>() : nullptr;
+    if (!ClusteringScheduler)
     {
-        if (RecursionDepth < Depth)
+        UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Error, "SubmitPendingRegistrations(): ClusteringScheduler is not valid.");
+        return;
+    }
+
+    // the rest of the pending registrations goes with the next batches
+    const int32 BatchSize = FMath::Min(PendingRegistrations.Num(), MaxRegistrationsPerScheduledBatch);
+    InFlightRegistrations = TArray<FClusterEntryRegistration>(PendingRegistrations.GetData(), BatchSize);
+    PendingRegistrations.RemoveAt(0, BatchSize);
+    bScheduledBatchInFlight = true;
+
+    // The subsystem outlives the job: Deinitialize() unregisters the client which waits for the running job
+    ClusteringScheduler->SubmitJob(ClusteringSchedulerClientID,
+        [this, WeakThis = TWeakObjectPtr<UMBCG_AttackClusteringSubsystem>(this)]()
+        {
+            InFlightProcessedPartitionIdxs = ClusterRegistrations(InFlightRegistrations);
+
+            AsyncTask(ENamedThreads::GameThread,
+                [WeakThis]()
+                {
+                    if (UMBCG_AttackClusteringSubsystem* This = WeakThis.Get())
+                    {
+                        This->OnScheduledBatchFinished();
+                    }
+                });
+        });
+}
+
+
+void UMBCG_AttackClusteringSubsystem::OnScheduledBatchFinished()
+{
+    // the subsystem was deinitialized after the job was done
+    if (!bScheduledBatchInFlight) return;
+
+    bScheduledBatchInFlight = false;
+    InFlightRegistrations.Reset();
+
+    BroadcastClustersChanged(InFlightProcessedPartitionIdxs);
+    InFlightProcessedPartitionIdxs.Reset();
+
+    SubmitPendingRegistrations();
+}
+
+
+TArray<int32> UMBCG_AttackClusteringSubsystem::ClusterRegistrations(const TArray<FClusterEntryRegistration>& Registrations)
+{
+    // split registrations by clustering context and EntryType since each of them is clustered in its own partition.
+    // ClusteringContexts can't change while registrations are in flight, so it is safe to read here
+    TArray<TArray<FClusterEntryRegistration>> RegistrationsByPartition;
+    RegistrationsByPartition.SetNum(Partitions.Num());
+    for (const FClusterEntryRegistration& Registration : Registrations)
+    {
+        if (!ClusteringContexts.IsValidIndex(Registration.ContextIdx))
+        {
+            UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "ClusterRegistrations(): Unexpected: unknown clustering context index {0}, the registration is skipped.", Registration.ContextIdx);
+            continue;
+        }
+        RegistrationsByPartition[GetPartitionIdx(Registration.EntryType, Registration.ContextIdx)].Add(Registration);
+    }
+
+    TArray<int32> PartitionIdxsToProcess;
+    for (int32 PartitionIdx = 0; PartitionIdx < Partitions.Num(); ++PartitionIdx)
+    {
+        if (RegistrationsByPartition[PartitionIdx].Num() > 0)
+        {
+            PartitionIdxsToProcess.Add(PartitionIdx);
+        }
+    }
+
+    if (PartitionIdxsToProcess.Num() == 0) return PartitionIdxsToProcess;
+
+    // Partitions never interact, so all of them but the last one are processed on worker tasks while the last one is processed on this thread
+    TArray<UE::Tasks::FTask> PartitionTasks;
+    for (int32 Idx = 0; Idx < PartitionIdxsToProcess.Num() - 1; ++Idx)
+    {
+        FAttackClusteringPartition& Partition = Partitions[PartitionIdxsToProcess[Idx]];
+        const TArray<FClusterEntryRegistration>& PartitionRegistrations = RegistrationsByPartition[PartitionIdxsToProcess[Idx]];
+
+        PartitionTasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION,
+            [&Partition, &PartitionRegistrations]()
+            {
+                Partition.RegisterNewClusterEntries(PartitionRegistrations);
+            }));
+    }
+
+    const int32 LastPartitionIdx = PartitionIdxsToProcess.Last();
+    Partitions[LastPartitionIdx].RegisterNewClusterEntries(RegistrationsByPartition[LastPartitionIdx]);
+
+    // join before broadcasting so that listeners see the consistent state of all partitions
+    UE::Tasks::Wait(PartitionTasks);
+
+    return PartitionIdxsToProcess;
+}
+
+
+void UMBCG_AttackClusteringSubsystem::BroadcastClustersChanged(const TArray<int32>& ProcessedPartitionIdxs)
+{
+    check(IsInGameThread());
+
+    if (ProcessedPartitionIdxs.Num() == 0) return;
+
+    // readers on other threads see the whole change batch at once
+    PublishClustersSnapshot();
+
+    // one change set per changed clustering context. Processed partitions are sorted, so partitions of a context follow each other
+    TArray<FAttackClustersChangeSet> ChangeSets;
+    for (const int32 PartitionIdx : ProcessedPartitionIdxs)
+    {
+        const FAttackClusteringPartition& Partition = Partitions[PartitionIdx];
+        const int32 ContextIdx = PartitionIdx / static_cast<int32>(EEntryType::MAX);
+        if (ChangeSets.Num() == 0 || ChangeSets.Last().ContextIdx != ContextIdx)
+        {
+            FAttackClustersChangeSet& ChangeSet = ChangeSets.AddDefaulted_GetRef();
+            ChangeSet.Context = ClusteringContexts[ContextIdx];
+            ChangeSet.ContextIdx = ContextIdx;
+        }
+        ChangeSets.Last().GetPayload(Partition.GetEntryType()) = Partition.GetChangedClustersIDsPayload();
+
+        // the pyramid is up to date by the time listeners are notified
+        UpdateDangerPyramid(PartitionIdx);
+
+#if 0
+        // Broadcast that clusters changed
+        // COP: Use OnSomeAttackClustersChangedDelegate which is more efficient
+        // OnAttackClustersChangedDelegate.Broadcast();
+#endif
+        // Braodcast that some clusters changed (or addeded, removed etc). Its cluster IDs are ones of the default context
+        if (ContextIdx == 0)
         {
-            RecursionDepth = Depth;
+            OnSomeAttackClustersChangedDelegate.Broadcast(Partition.GetEntryType(), Partition.GetChangedClustersIDsPayload());
         }
-    }
 
-    static void PrintRecursionDepth()
-    {
-        UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Display, "Maximum recursion depth recorded = {0}", RecursionDepth);
+        // the adjustment steps also go to telemetry with each RegistrationBatch event
+        UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Verbose, "Maximum adjustment steps recorded = {0}", Partition.GetRecordedAdjustmentSteps());
     }
 
-    // reset the recursion depth counter
-    static void ResetRecursionDepth()
+    // the whole batch as one transaction per context
+    for (const FAttackClustersChangeSet& ChangeSet : ChangeSets)
     {
-        RecursionDepth = 0;
+        OnAttackClustersChangeSetDelegate.Broadcast(ChangeSet);
     }
-}  // namespace MBCG_AttackClusteringSubsystem_Debug
-
-
-namespace LocalDebug = MBCG_AttackClusteringSubsystem_Debug;
+}
 
 
-void FAttackCluster::UpdateCentroidProperties(const TArray<FClusterEntry>& ClusterEntries)
+bool FAttackClustersChangeSet::HasChanges(EEntryType EntryType) const
 {
-    if (EntryIDs.Num() == 0)
-    {
-        CentroidLocation = FVector::ZeroVector;
-        Direction = FVector::ZeroVector;
-        return;
-    }
-
-    FVector LocationSum = FVector::ZeroVector;
-    FVector DirectionSum = FVector::ZeroVector;
-
-    for (int32 EntryID : EntryIDs)
+    for (const int32 ClusterID : GetPayload(EntryType))
     {
-        LocationSum += ClusterEntries[EntryID].EntryLocation;
-        DirectionSum += ClusterEntries[EntryID].EntryDirection;
+        if (ClusterID >= 0) return true;
     }
-
-    CentroidLocation = LocationSum / EntryIDs.Num();
-    Direction = DirectionSum.GetSafeNormal();
+    return false;
 }
 
 
-void UMBCG_AttackClusteringSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+void FAttackClusteringPartition::Reset()
 {
-    Super::Initialize(Collection);
+    ClusterEntries.Empty();
+    CoalescingGrid.Empty();
+    GridCellClusterIDs.Empty();
+    GridClusterParentIDs.Empty();
+    GridClusterLocationSums.Empty();
+    GridClusterDirectionSums.Empty();
+    Clusters.Empty();
+    ChangedClustersIDsPayload.Empty();
+    ExpelledEntryIDs.Empty();
 }
 
 
-void UMBCG_AttackClusteringSubsystem::Deinitialize()
+bool FAttackClusteringPartition::ConsumeAdjustmentStep()
 {
-    Super::Deinitialize();
+    if (RemainingAdjustmentSteps > 0)
+    {
+        --RemainingAdjustmentSteps;
+        return true;
+    }
 
-    // Clear all data
-    ClusterEntries.Empty();
-    Clusters.Empty();
+    // Degrade gracefully: no further adjustments, expelled entries are still integrated so every entry belongs to exactly one cluster
+    if (!bAdjustmentBudgetSpent)
+    {
+        bAdjustmentBudgetSpent = true;
+        UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "ConsumeAdjustmentStep(): The registration spent all {0} adjustment steps. Keeping the current assignment.", MaxAdjustmentSteps);
+        FClusteringTelemetry::Record(EClusteringTelemetryEvent::AdjustmentBudgetExhausted, EntryType, MaxAdjustmentSteps, ExpelledEntryIDs.Num());
+    }
+    return false;
 }
 
 
-bool UMBCG_AttackClusteringSubsystem::SoftCheckCluster(int32 ClusterID) const
+bool FAttackClusteringPartition::SoftCheckCluster(int32 ClusterID) const
 {
     if (ClusterID == -1) return false;
     if (!Clusters[ClusterID].IsValid) return false;
@@ -86,7 +777,7 @@ bool UMBCG_AttackClusteringSubsystem::SoftCheckCluster(int32 ClusterID) const
 }
 
 
-bool UMBCG_AttackClusteringSubsystem::SoftCheckClusterEntry(int32 EntryID) const
+bool FAttackClusteringPartition::SoftCheckClusterEntry(int32 EntryID) const
 {
     if (EntryID == -1) return false;
 
@@ -94,7 +785,7 @@ bool UMBCG_AttackClusteringSubsystem::SoftCheckClusterEntry(int32 EntryID) const
 }
 
 
-void UMBCG_AttackClusteringSubsystem::AddToChangedClustersPayloadIfNeeded(int32 ClusterID)
+void FAttackClusteringPartition::AddToChangedClustersPayloadIfNeeded(int32 ClusterID)
 {
     // check
     if (ClusterID < 0)
@@ -113,7 +804,7 @@ void UMBCG_AttackClusteringSubsystem::AddToChangedClustersPayloadIfNeeded(int32
 }
 
 
-void UMBCG_AttackClusteringSubsystem::AddToChangedClustersPayloadIfNeeded(const TArray<int32>& ClusterIDs)
+void FAttackClusteringPartition::AddToChangedClustersPayloadIfNeeded(const TArray<int32>& ClusterIDs)
 {
     // increase ChangedClustersIDsPayload array if needed
     if (ChangedClustersIDsPayload.Num() < ClusterIDs.Num())
@@ -131,7 +822,7 @@ void UMBCG_AttackClusteringSubsystem::AddToChangedClustersPayloadIfNeeded(const
 }
 
 
-float UMBCG_AttackClusteringSubsystem::CalculateClusterReciprocalGravityEffect(float DistanceToCluster, int32 ClusterID) const
+float FAttackClusteringPartition::CalculateClusterReciprocalGravityEffect(float DistanceToCluster, int32 ClusterID) const
 {
     // check input
     if (!SoftCheckCluster(ClusterID)) return FLT_MAX;
@@ -140,14 +831,21 @@ float UMBCG_AttackClusteringSubsystem::CalculateClusterReciprocalGravityEffect(f
     // Check if outside the cluster boundaries
     if (DistanceToCluster > MaxClusterRadius) return FLT_MAX;
 
-    return (DistanceToCluster * DistanceToCluster) / (ClusterGravity * Clusters[ClusterID].EntryIDs.Num());
+    return (DistanceToCluster * DistanceToCluster) / (ClusterGravity * Clusters[ClusterID].Weight);
 }
 
 
-int32 UMBCG_AttackClusteringSubsystem::FindBestCluster(const FClusterEntry& ClusterEntry) const
+int32 FAttackClusteringPartition::FindBestCluster(const FClusterEntry& ClusterEntry) const
 {
-    int32 BestClusterIndex = -1;
     float BestScore = FLT_MAX;
+    return FindBestCluster(ClusterEntry, BestScore);
+}
+
+
+int32 FAttackClusteringPartition::FindBestCluster(const FClusterEntry& ClusterEntry, float& BestScore) const
+{
+    int32 BestClusterIndex = -1;
+    BestScore = FLT_MAX;
 
     // Find if the new cluster entry is located witin already existing cluster's radius
     for (int32 i = 0; i < Clusters.Num(); ++i)
@@ -156,7 +854,7 @@ int32 UMBCG_AttackClusteringSubsystem::FindBestCluster(const FClusterEntry& Clus
 
         // Skip the the current cluster if the cluster entry is the only entry in this cluster
         // This allows a single-entry cluster to be moved to another cluster
-        if (ClusterEntry.EntryID == i && Clusters[i].EntryIDs.Num() == 1) continue;
+        if (ClusterEntry.ClusterID == i && Clusters[i].EntryIDs.Num() == 1) continue;
 
         const FAttackCluster& CurrentCluster = Clusters[i];
         float Distance = FVector::Dist(CurrentCluster.CentroidLocation, ClusterEntry.EntryLocation);
@@ -210,19 +908,43 @@ int32 UMBCG_AttackClusteringSubsystem::FindBestCluster(const FClusterEntry& Clus
         }
     }
 
+    // the closest single-entry cluster is outside MaxClusterRadius, so its score is not comparable with reciprocal gravity effect
+    if (BestClusterIndex != -1)
+    {
+        BestScore = FLT_MAX;
+    }
+
     return BestClusterIndex;
 }
 
 
-void UMBCG_AttackClusteringSubsystem::HandleEntriesInOverlappingClusters(const EEntryType EntryType, int32 Depth)
+float FAttackClusteringPartition::CalculateCurrentClusterScore(const FClusterEntry& ClusterEntry) const
+{
+    if (!SoftCheckCluster(ClusterEntry.ClusterID)) return FLT_MAX;
+
+    // a single-entry cluster is free to join another cluster (see FindBestCluster())
+    if (Clusters[ClusterEntry.ClusterID].EntryIDs.Num() == 1) return FLT_MAX;
+
+    float Distance = FVector::Dist(Clusters[ClusterEntry.ClusterID].CentroidLocation, ClusterEntry.EntryLocation);
+    return CalculateClusterReciprocalGravityEffect(Distance, ClusterEntry.ClusterID);
+}
+
+
+uint64 FAttackClusteringPartition::CalculateAssignmentStateHash() const
 {
-    LocalDebug::SetRecursionDepthIfNeeded(Depth);
-    if (Depth > MaxRecursionDepth)
+    TArray<int32> AssignedClusterIDs;
+    AssignedClusterIDs.Reserve(ClusterEntries.Num());
+    for (const FClusterEntry& SingleClusterEntry : ClusterEntries)
     {
-        UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "HandleEntriesInOverlappingClusters(): Reached recursion depth limit. Halting clustering adjustments in In overlapping clusters.");
-        return;
+        AssignedClusterIDs.Add(SingleClusterEntry.ClusterID);
     }
 
+    return CityHash64(reinterpret_cast<const char*>(AssignedClusterIDs.GetData()), AssignedClusterIDs.Num() * sizeof(int32));
+}
+
+
+bool FAttackClusteringPartition::ReassignEntriesInOverlappingClusters()
+{
     // clusters which were affected by moved cluster entries
     TArray<int32> AffectedClusterIDs;
     // Cluster entries which are expelled from their former clusters due to clusters centroid shifting when handling overlapping clusters
@@ -234,7 +956,8 @@ void UMBCG_AttackClusteringSubsystem::HandleEntriesInOverlappingClusters(const E
         // Only clusters of the specified EntryType to be processed
         if (SingleClusterEntry.EntryType != EntryType) continue;
 
-        int32 BestClusterIndex = FindBestCluster(SingleClusterEntry);
+        float BestScore = FLT_MAX;
+        int32 BestClusterIndex = FindBestCluster(SingleClusterEntry, BestScore);
         // cluster entry should be expelled and handled additionally
         if (BestClusterIndex == -1)
         {
@@ -245,45 +968,92 @@ void UMBCG_AttackClusteringSubsystem::HandleEntriesInOverlappingClusters(const E
         // cluster entry should be moved to a different cluster
         if (SingleClusterEntry.ClusterID != BestClusterIndex)
         {
+            // Hysteresis: an entry which is still within its current cluster moves only if the new cluster is better by ReassignmentHysteresis.
+            // This prevents entries from ping-ponging between clusters whose centroids chase each other
+            const float CurrentScore = CalculateCurrentClusterScore(SingleClusterEntry);
+            if (CurrentScore != FLT_MAX && BestScore >= CurrentScore * (1.f - ReassignmentHysteresis)) continue;
+
             // remove cluster entry from a former cluster
             int32 OldClusterID = SingleClusterEntry.ClusterID;
-            FAttackCluster& OldCluster = Clusters[OldClusterID];
+            if (OldClusterID >= 0)
+            {
+                FAttackCluster& OldCluster = Clusters[OldClusterID];
+                OldCluster.RemoveEntry(SingleClusterEntry);
+                AffectedClusterIDs.Add(OldClusterID);
+            }
             ClusterEntries[SingleClusterEntry.EntryID].ClusterID = -1;
-            OldCluster.EntryIDs.Remove(SingleClusterEntry.EntryID);
-            AffectedClusterIDs.Add(OldClusterID);
 
             // assign the cluster entry to the most suitable cluster
             ClusterEntries[SingleClusterEntry.EntryID].ClusterID = BestClusterIndex;
             FAttackCluster& BestCluster = Clusters[BestClusterIndex];
-            BestCluster.EntryIDs.Add(SingleClusterEntry.EntryID);
+            BestCluster.AddEntry(SingleClusterEntry);
             AffectedClusterIDs.Add(BestClusterIndex);
         }
     }
 
+    // Expelled cluster entries are removed from their former clusters before they are integrated again
+    for (int32 EntryID : ExpelledClusterEntryIDs)
+    {
+        const int32 OldClusterID = ClusterEntries[EntryID].ClusterID;
+        if (OldClusterID >= 0)
+        {
+            Clusters[OldClusterID].RemoveEntry(ClusterEntries[EntryID]);
+            AffectedClusterIDs.AddUnique(OldClusterID);
+        }
+        ClusterEntries[EntryID].ClusterID = -1;  // Mark as unclustered
+    }
+
     // for all modified clusters:UpdateCentroidProperties()
     for (int32 ClusterID : AffectedClusterIDs)
     {
+        // a cluster left without entries is removed
+        if (Clusters[ClusterID].EntryIDs.Num() == 0)
+        {
+            Clusters[ClusterID].IsValid = false;
+        }
         Clusters[ClusterID].UpdateCentroidProperties(ClusterEntries);
     }
 
     // Handle cluster entries which were expelled from their former clusters
-    for (int32 EntryID : ExpelledClusterEntryIDs)
-    {
-        IntegrateClusterEntry(ClusterEntries[EntryID]);
-    }
+    ExpelledEntryIDs.Append(ExpelledClusterEntryIDs);
+    IntegrateExpelledClusterEntries();
 
     // update ChangedClustersIDsPayload
     AddToChangedClustersPayloadIfNeeded(AffectedClusterIDs);
 
-    // If any cluster shifted, then cluster entries may need to be assigned to some other clusters
-    if (AffectedClusterIDs.Num() > 0)
+    return AffectedClusterIDs.Num() > 0 || ExpelledClusterEntryIDs.Num() > 0;
+}
+
+
+void FAttackClusteringPartition::HandleEntriesInOverlappingClusters()
+{
+    // Assignment states met during this call. A repeated state means that entries oscillate between clusters and further passes would only repeat the cycle
+    TSet<uint64> VisitedAssignmentStates;
+    VisitedAssignmentStates.Add(CalculateAssignmentStateHash());
+
+    for (int32 Pass = 0; Pass < MaxReassignmentPasses; ++Pass)
     {
-        HandleEntriesInOverlappingClusters(EntryType, Depth + 1);
+        // each pass is an adjustment step of the registration
+        if (!ConsumeAdjustmentStep()) return;
+
+        // If any cluster shifted, then cluster entries may need to be assigned to some other clusters
+        if (!ReassignEntriesInOverlappingClusters()) return;
+
+        bool bAlreadyVisited = false;
+        VisitedAssignmentStates.Add(CalculateAssignmentStateHash(), &bAlreadyVisited);
+        if (bAlreadyVisited)
+        {
+            UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Verbose, "HandleEntriesInOverlappingClusters(): Reassignment cycle detected after {0} passes. Keeping the current assignment.", Pass + 1);
+            return;
+        }
     }
+
+    // Degrade gracefully: the current assignment is kept as is, every entry still belongs to exactly one cluster
+    UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "HandleEntriesInOverlappingClusters(): Reached MaxReassignmentPasses ({0}). Keeping the current assignment.", MaxReassignmentPasses);
 }
 
 
-bool UMBCG_AttackClusteringSubsystem::AreClustersFullyOverlapping(int32 SourceClusterID, int32 TargetClusterID) const
+bool FAttackClusteringPartition::AreClustersFullyOverlapping(int32 SourceClusterID, int32 TargetClusterID) const
 {
     // check input
     if (!SoftCheckCluster(SourceClusterID) || !SoftCheckCluster(TargetClusterID)) return false;
@@ -301,7 +1071,7 @@ bool UMBCG_AttackClusteringSubsystem::AreClustersFullyOverlapping(int32 SourceCl
 }
 
 
-int32 UMBCG_AttackClusteringSubsystem::FindBestMasterClusterCandidate(int32 SourceClusterID, const TArray<int32>& MasterCandidateClusterIDs) const
+int32 FAttackClusteringPartition::FindBestMasterClusterCandidate(int32 SourceClusterID, const TArray<int32>& MasterCandidateClusterIDs) const
 {
     // check input
     if (!SoftCheckCluster(SourceClusterID)) return -1;
@@ -335,7 +1105,7 @@ int32 UMBCG_AttackClusteringSubsystem::FindBestMasterClusterCandidate(int32 Sour
 }
 
 
-bool UMBCG_AttackClusteringSubsystem::UniteClusters(const int32 MovedSourceClusterID, int32 BestMasterClusterID)
+bool FAttackClusteringPartition::UniteClusters(const int32 MovedSourceClusterID, int32 BestMasterClusterID)
 {
     // basic input check
     if (!SoftCheckCluster(MovedSourceClusterID) || !SoftCheckCluster(BestMasterClusterID)) return false;
@@ -353,113 +1123,209 @@ bool UMBCG_AttackClusteringSubsystem::UniteClusters(const int32 MovedSourceClust
     TArray<int32> SourceCopyEntryIDs = Clusters[MovedSourceClusterID].EntryIDs;
     for (int32 MovedEntryID : SourceCopyEntryIDs)
     {
-        Clusters[BestMasterClusterID].EntryIDs.Add(MovedEntryID);
+        Clusters[BestMasterClusterID].AddEntry(ClusterEntries[MovedEntryID]);
         ClusterEntries[MovedEntryID].ClusterID = BestMasterClusterID;
     }
     Clusters[MovedSourceClusterID].EntryIDs.Empty();
+    Clusters[MovedSourceClusterID].Weight = 0;
     Clusters[MovedSourceClusterID].IsValid = false;
     Clusters[BestMasterClusterID].UpdateCentroidProperties(ClusterEntries);
 
     // update ChangedClustersIDsPayload with changed clusters IDs
     AddToChangedClustersPayloadIfNeeded({Clusters[MovedSourceClusterID].ClusterID, Clusters[BestMasterClusterID].ClusterID});
 
-    // A cluster was changed, therefore its centroid moved, so perhaps its entries or other cluster's entries should be re-assigned to other clusters
-    HandleEntriesInOverlappingClusters(Clusters[MovedSourceClusterID].EntryType);
+    FClusteringTelemetry::Record(EClusteringTelemetryEvent::ClustersMerged, EntryType, BestMasterClusterID, MovedSourceClusterID, Clusters[BestMasterClusterID].CentroidLocation);
 
     // return true if there were changes (by default), false if something went wrong
     return true;
 }
 
 
-void UMBCG_AttackClusteringSubsystem::FindAndUniteFullyOverlappingClusters(const EEntryType EntryType)
+bool FAttackClusteringPartition::FindAndUniteFullyOverlappingClusters()
 {
-    bool ChangesOccurred = false;
-    // Unite clusters until no further changes occur
-    do
+    // Go though all clusters and consider SourceCluster to be "absorbed" by the TargetCluster
+    for (int32 SourceClusterIdx = 0; SourceClusterIdx < Clusters.Num() - 1; ++SourceClusterIdx)
     {
-        int32 MovedSourceClusterIdx = -1;
-        int32 BestMasterClusterIdx = -1;
-        bool ChangesExpected = false;
+        // only valid clusters of the specified EntryType to be considered
+        if (!Clusters[SourceClusterIdx].IsValid || Clusters[SourceClusterIdx].EntryType != EntryType) continue;
 
-        // Go though all clusters and consider SourceCluster to be "absorbed" by the TargetCluster
-        for (int32 SourceClusterIdx = 0; SourceClusterIdx < Clusters.Num() - 1; ++SourceClusterIdx)
+        // Clusters that are suitable to be masters when uniting with the current source cluster
+        TArray<int32> MasterCandidateClusterIDs;
+        for (int32 TargetClusterIdx = 0; TargetClusterIdx < Clusters.Num(); ++TargetClusterIdx)
         {
-            // only valid clusters of the specified EntryType to be considered
-            if (!Clusters[SourceClusterIdx].IsValid || Clusters[SourceClusterIdx].EntryType != EntryType) continue;
-
-            // Clusters that are suitable to be masters when uniting with the current source cluster
-            TArray<int32> MasterCandidateClusterIDs;
-            for (int32 TargetClusterIdx = 0; TargetClusterIdx < Clusters.Num(); ++TargetClusterIdx)
-            {
-                if (SourceClusterIdx == TargetClusterIdx || !Clusters[TargetClusterIdx].IsValid || Clusters[TargetClusterIdx].EntryType != EntryType) continue;
-
-                // It makes sense to consider uniting clusters if their centroids are no further than a cluster diameter from each other
-                if (FVector::Dist(Clusters[SourceClusterIdx].CentroidLocation, Clusters[TargetClusterIdx].CentroidLocation) > 2 * MaxClusterRadius) continue;
+            if (SourceClusterIdx == TargetClusterIdx || !Clusters[TargetClusterIdx].IsValid || Clusters[TargetClusterIdx].EntryType != EntryType) continue;
 
-                // Unite clusters if all entries of one of the cluster is within the other cluster's bounds
-                if (AreClustersFullyOverlapping(SourceClusterIdx, TargetClusterIdx))
-                {
-                    MasterCandidateClusterIDs.Add(TargetClusterIdx);
-                }
-            }
+            // It makes sense to consider uniting clusters if their centroids are no further than a cluster diameter from each other
+            if (FVector::Dist(Clusters[SourceClusterIdx].CentroidLocation, Clusters[TargetClusterIdx].CentroidLocation) > 2 * MaxClusterRadius) continue;
 
-            // Find the best cluster candidate to be a master for the current source cluster
-            BestMasterClusterIdx = FindBestMasterClusterCandidate(SourceClusterIdx, MasterCandidateClusterIDs);
-            if (BestMasterClusterIdx != -1)
+            // Unite clusters if all entries of one of the cluster is within the other cluster's bounds
+            if (AreClustersFullyOverlapping(SourceClusterIdx, TargetClusterIdx))
             {
-                MovedSourceClusterIdx = SourceClusterIdx;
-                ChangesExpected = true;
-                // Quit the loop since the clusters array has been changed and run the main loop again afresh
-                break;
+                MasterCandidateClusterIDs.Add(TargetClusterIdx);
             }
         }
 
-        if (ChangesExpected)
+        // Find the best cluster candidate to be a master for the current source cluster
+        const int32 BestMasterClusterIdx = FindBestMasterClusterCandidate(SourceClusterIdx, MasterCandidateClusterIDs);
+        if (BestMasterClusterIdx != -1)
         {
-            ChangesOccurred = UniteClusters(MovedSourceClusterIdx, BestMasterClusterIdx);
+            // each union is an adjustment step of the registration
+            return ConsumeAdjustmentStep() && UniteClusters(SourceClusterIdx, BestMasterClusterIdx);
         }
-        else
+    }
+
+    return false;
+}
+
+
+void FAttackClusteringPartition::RegisterNewClusterEntries(TConstArrayView<FClusterEntryRegistration> Registrations)
+{
+    RecordedAdjustmentSteps = 0;
+    ChangedClustersIDsPayload.Empty();
+
+    const uint64 StartCycles = FClusteringTelemetry::IsEnabled() ? FPlatformTime::Cycles64() : 0;
+
+    for (const FClusterEntryRegistration& Registration : Registrations)
+    {
+        // check
+        if (Registration.EntryType != EntryType)
         {
-            ChangesOccurred = false;
+            UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Error, "RegisterNewClusterEntries(): EntryType mismatch between registration and partition. The registration is skipped.");
+            continue;
         }
 
+        RegisterNewClusterEntry(Registration.EntryLocation, Registration.EntryDirection, FMath::Max(1, Registration.Weight));
+    }
 
-    } while (ChangesOccurred);
+    if (FClusteringTelemetry::IsEnabled())
+    {
+        const float DurationMs = static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+        FClusteringTelemetry::Record(EClusteringTelemetryEvent::RegistrationBatch, EntryType, Registrations.Num(), RecordedAdjustmentSteps, FVector::ZeroVector, DurationMs);
+    }
 }
 
 
-void UMBCG_AttackClusteringSubsystem::RegisterNewClusterEntry(const FVector& EntryLocation, const FVector& EntryDirection, const EEntryType EntryType)
+void FAttackClusteringPartition::RegisterNewClusterEntry(const FVector& EntryLocation, const FVector& EntryDirection, int32 Weight)
 {
-    LocalDebug::ResetRecursionDepth();
+    if (ClusteringMode == EAttackClusteringMode::Grid)
+    {
+        RegisterNewClusterEntryInGrid(EntryLocation, EntryDirection, Weight);
+        return;
+    }
 
-    FClusterEntry NewClusterEntry;
-    NewClusterEntry.EntryID = ClusterEntries.Num();
-    NewClusterEntry.EntryType = EntryType;
-    NewClusterEntry.EntryLocation = EntryLocation;
-    NewClusterEntry.EntryDirection = EntryDirection.GetSafeNormal();
+    RemainingAdjustmentSteps = MaxAdjustmentSteps;
+    bAdjustmentBudgetSpent = false;
 
-    ClusterEntries.Add(NewClusterEntry);
+    // Many attacks happen at practically the same spot, they are coalesced into one weighted entry
+    const int32 CoalescedEntryID = FindEntryToCoalesce(EntryLocation);
+    if (CoalescedEntryID != -1)
+    {
+        CoalesceIntoClusterEntry(CoalescedEntryID, EntryDirection, Weight);
+    }
+    else
+    {
+        FClusterEntry NewClusterEntry;
+        NewClusterEntry.EntryID = ClusterEntries.Num();
+        NewClusterEntry.EntryType = EntryType;
+        NewClusterEntry.EntryLocation = EntryLocation;
+        NewClusterEntry.EntryDirection = EntryDirection.GetSafeNormal();
+        NewClusterEntry.Weight = Weight;
 
-    ChangedClustersIDsPayload.Empty();
+        ClusterEntries.Add(NewClusterEntry);
+        AddToCoalescingGrid(NewClusterEntry);
 
-    IntegrateClusterEntry(ClusterEntries[NewClusterEntry.EntryID]);
-    HandleEntriesInOverlappingClusters(EntryType);
-    FindAndUniteFullyOverlappingClusters(EntryType);
+        IntegrateClusterEntry(ClusterEntries[NewClusterEntry.EntryID]);
+    }
 
-#if 0
-    // Broadcast that clusters changed
-    // COP: Use OnSomeAttackClustersChangedDelegate which is more efficient
-    // OnAttackClustersChangedDelegate.Broadcast();
-#endif
-    // Braodcast that some clusters changed (or addeded, removed etc)
-    OnSomeAttackClustersChangedDelegate.Broadcast(ChangedClustersIDsPayload);
+    // A united cluster's centroid moves, so perhaps its entries or other cluster's entries should be re-assigned to other clusters.
+    // The loop ends when clusters are stable or the registration's adjustment steps are spent
+    do
+    {
+        HandleEntriesInOverlappingClusters();
+    } while (FindAndUniteFullyOverlappingClusters());
+
+    RecordedAdjustmentSteps = FMath::Max(RecordedAdjustmentSteps, MaxAdjustmentSteps - RemainingAdjustmentSteps);
+}
+
+
+FIntVector FAttackClusteringPartition::GetCoalescingGridCell(const FVector& Location) const
+{
+    return FIntVector(                                               //
+        FMath::FloorToInt32(Location.X / EntryCoalescingRadius),  //
+        FMath::FloorToInt32(Location.Y / EntryCoalescingRadius),  //
+        FMath::FloorToInt32(Location.Z / EntryCoalescingRadius));
+}
+
+
+void FAttackClusteringPartition::AddToCoalescingGrid(const FClusterEntry& ClusterEntry)
+{
+    if (EntryCoalescingRadius <= 0.f) return;
+
+    CoalescingGrid.Add(GetCoalescingGridCell(ClusterEntry.EntryLocation), ClusterEntry.EntryID);
+}
+
+
+int32 FAttackClusteringPartition::FindEntryToCoalesce(const FVector& EntryLocation) const
+{
+    if (EntryCoalescingRadius <= 0.f) return -1;
+
+    const FIntVector Cell = GetCoalescingGridCell(EntryLocation);
+    const float MaxDistSquared = EntryCoalescingRadius * EntryCoalescingRadius;
+
+    int32 BestEntryID = -1;
+    float BestDistSquared = FLT_MAX;
+    TArray<int32, TInlineAllocator<4>> CellEntryIDs;
+
+    // the cell size equals the coalescing radius, so the closest entry is in one of the neighbouring cells
+    for (int32 DX = -1; DX <= 1; ++DX)
+    {
+        for (int32 DY = -1; DY <= 1; ++DY)
+        {
+            for (int32 DZ = -1; DZ <= 1; ++DZ)
+            {
+                CellEntryIDs.Reset();
+                CoalescingGrid.MultiFind(Cell + FIntVector(DX, DY, DZ), CellEntryIDs);
+                for (const int32 EntryID : CellEntryIDs)
+                {
+                    const float DistSquared = FVector::DistSquared(ClusterEntries[EntryID].EntryLocation, EntryLocation);
+                    if (DistSquared <= MaxDistSquared && DistSquared < BestDistSquared)
+                    {
+                        BestDistSquared = DistSquared;
+                        BestEntryID = EntryID;
+                    }
+                }
+            }
+        }
+    }
+
+    return BestEntryID;
+}
+
+
+void FAttackClusteringPartition::CoalesceIntoClusterEntry(int32 EntryID, const FVector& EntryDirection, int32 Weight)
+{
+    FClusterEntry& ClusterEntry = ClusterEntries[EntryID];
+
+    // the entry keeps its location, its direction becomes the weighted average
+    ClusterEntry.EntryDirection = (ClusterEntry.EntryDirection * ClusterEntry.Weight + EntryDirection.GetSafeNormal() * Weight).GetSafeNormal();
+    ClusterEntry.Weight += Weight;
+
+    if (!SoftCheckCluster(ClusterEntry.ClusterID))
+    {
+        IntegrateClusterEntry(ClusterEntry);
+        return;
+    }
 
-    // Uncomment this to log out the maximum recursion depth that took place
-    LocalDebug::PrintRecursionDepth();
+    // the cluster became heavier and its centroid shifted towards the entry
+    Clusters[ClusterEntry.ClusterID].UpdateCentroidProperties(ClusterEntries);
+    AddToChangedClustersPayloadIfNeeded(ClusterEntry.ClusterID);
+
+    HandleExpelledClusterEntries(ClusterEntry.ClusterID);
+    IntegrateExpelledClusterEntries();
 }
 
 
-int32 UMBCG_AttackClusteringSubsystem::CreateNewCluster(const FClusterEntry& ClusterEntry)
+int32 FAttackClusteringPartition::CreateNewCluster(const FClusterEntry& ClusterEntry)
 {
     // input check
     if (!SoftCheckClusterEntry(ClusterEntry.EntryID))
@@ -471,7 +1337,7 @@ int32 UMBCG_AttackClusteringSubsystem::CreateNewCluster(const FClusterEntry& Clu
     FAttackCluster NewCluster;
     NewCluster.ClusterID = Clusters.Num();
     NewCluster.EntryType = ClusterEntry.EntryType;
-    NewCluster.EntryIDs.Add(ClusterEntry.EntryID);
+    NewCluster.AddEntry(ClusterEntry);
     NewCluster.CentroidLocation = ClusterEntry.EntryLocation;
     NewCluster.Direction = ClusterEntry.EntryDirection;
     NewCluster.IsValid = true;
@@ -481,80 +1347,75 @@ int32 UMBCG_AttackClusteringSubsystem::CreateNewCluster(const FClusterEntry& Clu
     // update ChangedClustersIDsPayload
     AddToChangedClustersPayloadIfNeeded(NewCluster.ClusterID);
 
+    FClusteringTelemetry::Record(EClusteringTelemetryEvent::ClusterCreated, EntryType, NewCluster.ClusterID, -1, NewCluster.CentroidLocation);
+
     return NewCluster.ClusterID;
 }
 
 
-bool UMBCG_AttackClusteringSubsystem::HandleExpelledClusterEntries(const FAttackCluster& ClusterCopy, int32 Depth)
+bool FAttackClusteringPartition::HandleExpelledClusterEntries(int32 ClusterID)
 {
     // input check
-    if (!SoftCheckCluster(ClusterCopy.ClusterID)) return false;
+    if (!SoftCheckCluster(ClusterID)) return false;
 
-    LocalDebug::SetRecursionDepthIfNeeded(Depth);
+    bool ChangesOccurred = false;
 
-    if (Depth > MaxRecursionDepth)
+    // expelling entries shifts the centroid again, so the cluster is checked until it keeps all its entries (or the adjustment steps are spent)
+    while (ConsumeAdjustmentStep())
     {
-        UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "HandleExpelledClusterEntries(): Reached recursion depth limit. Halting clustering adjustments.");
-        return false;
-    }
-
-    TArray<int32> ExpelledClusterEntryIDs;
+        TArray<int32> ExpelledClusterEntryIDs;
 
-    // Identify cluster entries to expel based on MaxClusterRadius
-    for (int32 EntryID : ClusterCopy.EntryIDs)
-    {
-        float Distance = FVector::Dist(ClusterCopy.CentroidLocation, ClusterEntries[EntryID].EntryLocation);
-        if (Distance > MaxClusterRadius)
+        // Identify cluster entries to expel based on MaxClusterRadius
+        for (int32 EntryID : Clusters[ClusterID].EntryIDs)
         {
-            ExpelledClusterEntryIDs.Add(EntryID);
+            float Distance = FVector::Dist(Clusters[ClusterID].CentroidLocation, ClusterEntries[EntryID].EntryLocation);
+            if (Distance > MaxClusterRadius)
+            {
+                ExpelledClusterEntryIDs.Add(EntryID);
+            }
         }
-    }
 
-    // If no cluster entries are expelled, nothing has changed
-    if (ExpelledClusterEntryIDs.Num() == 0)
-    {
-        return false;
-    }
+        // If no cluster entries are expelled, nothing has changed
+        if (ExpelledClusterEntryIDs.Num() == 0) break;
 
-    // Remove expelled cluster entries from the cluster
-    for (int32 ExpelledEntryID : ExpelledClusterEntryIDs)
-    {
-        Clusters[ClusterCopy.ClusterID].EntryIDs.Remove(ExpelledEntryID);
-        ClusterEntries[ExpelledEntryID].ClusterID = -1;  // Mark as unclustered
-    }
+        // Remove expelled cluster entries from the cluster, they are integrated again by IntegrateExpelledClusterEntries()
+        for (int32 ExpelledEntryID : ExpelledClusterEntryIDs)
+        {
+            Clusters[ClusterID].RemoveEntry(ClusterEntries[ExpelledEntryID]);
+            ClusterEntries[ExpelledEntryID].ClusterID = -1;  // Mark as unclustered
+            ExpelledEntryIDs.Add(ExpelledEntryID);
 
-    // Update cluster centroid after expulsion
-    Clusters[ClusterCopy.ClusterID].UpdateCentroidProperties(ClusterEntries);
+            FClusteringTelemetry::Record(EClusteringTelemetryEvent::EntryExpelled, EntryType, ClusterID, ExpelledEntryID, ClusterEntries[ExpelledEntryID].EntryLocation);
+        }
 
-    // update ChangedClustersIDsPayload
-    AddToChangedClustersPayloadIfNeeded(ClusterCopy.ClusterID);
+        // Update cluster centroid after expulsion
+        Clusters[ClusterID].UpdateCentroidProperties(ClusterEntries);
 
-    bool ChangesOccurred = false;
+        // update ChangedClustersIDsPayload
+        AddToChangedClustersPayloadIfNeeded(ClusterID);
 
-    // Re-assign expelled cluster entries, potentially forming new clusters
-    for (int32 ExpelledEntryID : ExpelledClusterEntryIDs)
-    {
-        ChangesOccurred |= IntegrateClusterEntry(ClusterEntries[ExpelledEntryID], Depth + 1);
+        ChangesOccurred = true;
     }
 
     return ChangesOccurred;
 }
 
 
-bool UMBCG_AttackClusteringSubsystem::IntegrateClusterEntry(const FClusterEntry& ClusterEntry, int32 Depth)
+bool FAttackClusteringPartition::IntegrateClusterEntry(const FClusterEntry& ClusterEntry)
 {
-    // input check
-    if (!SoftCheckClusterEntry(ClusterEntry.EntryID))
-    {
-        UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "IntegrateClusterEntry(): Wrong input: ClusterEntry.EntryID == -1.");
-        return false;
-    }
+    if (!PlaceClusterEntry(ClusterEntry)) return false;
+
+    IntegrateExpelledClusterEntries();
+    return true;
+}
 
-    LocalDebug::SetRecursionDepthIfNeeded(Depth);
 
-    if (Depth > MaxRecursionDepth)
+bool FAttackClusteringPartition::PlaceClusterEntry(const FClusterEntry& ClusterEntry)
+{
+    // input check
+    if (!SoftCheckClusterEntry(ClusterEntry.EntryID))
     {
-        UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "IntegrateClusterEntry(): Recursion limit reached. Stopping cluster entry processing.");
+        UE_LOGFMT(LogUMBCG_AttackClusteringSubsystem, Warning, "PlaceClusterEntry(): Wrong input: ClusterEntry.EntryID == -1.");
         return false;
     }
 
@@ -571,24 +1432,196 @@ bool UMBCG_AttackClusteringSubsystem::IntegrateClusterEntry(const FClusterEntry&
 
     // Assign the cluster entry to the best cluster
     FAttackCluster& BestCluster = Clusters[BestClusterIndex];
-    BestCluster.EntryIDs.Add(ClusterEntry.EntryID);
+    BestCluster.AddEntry(ClusterEntry);
     ClusterEntries[ClusterEntry.EntryID].ClusterID = BestClusterIndex;
     BestCluster.UpdateCentroidProperties(ClusterEntries);
     // update ChangedClustersIDsPayload
     AddToChangedClustersPayloadIfNeeded(Clusters[BestClusterIndex].ClusterID);
 
-    // Adjust clusters until no further changes occur
-    bool ChangesOccurred = true;
-    while (ChangesOccurred)
+    // Only this cluster's centroid shifted, so only its entries may be expelled
+    HandleExpelledClusterEntries(BestClusterIndex);
+
+    return true;
+}
+
+
+void FAttackClusteringPartition::IntegrateExpelledClusterEntries()
+{
+    // A worklist instead of recursion: entries expelled while placing an entry are appended and placed by the same loop.
+    // It ends since expelling takes adjustment steps, and entries are still placed (without expelling) when the steps are spent
+    for (int32 Idx = 0; Idx < ExpelledEntryIDs.Num(); ++Idx)
+    {
+        const FClusterEntry& ExpelledClusterEntry = ClusterEntries[ExpelledEntryIDs[Idx]];
+
+        // an entry expelled several times is placed once it's unclustered
+        if (ExpelledClusterEntry.ClusterID != -1) continue;
+
+        PlaceClusterEntry(ExpelledClusterEntry);
+    }
+    ExpelledEntryIDs.Reset();
+}
+
+
+FIntVector FAttackClusteringPartition::GetClusteringGridCell(const FVector& Location) const
+{
+    return FIntVector(                                          //
+        FMath::FloorToInt32(Location.X / MaxClusterRadius),  //
+        FMath::FloorToInt32(Location.Y / MaxClusterRadius),  //
+        FMath::FloorToInt32(Location.Z / MaxClusterRadius));
+}
+
+
+int32 FAttackClusteringPartition::FindGridClusterRoot(int32 ClusterID)
+{
+    // find the root
+    int32 RootClusterID = ClusterID;
+    while (GridClusterParentIDs[RootClusterID] != RootClusterID)
+    {
+        RootClusterID = GridClusterParentIDs[RootClusterID];
+    }
+
+    // path compression
+    while (GridClusterParentIDs[ClusterID] != RootClusterID)
+    {
+        const int32 ParentClusterID = GridClusterParentIDs[ClusterID];
+        GridClusterParentIDs[ClusterID] = RootClusterID;
+        ClusterID = ParentClusterID;
+    }
+
+    return RootClusterID;
+}
+
+
+void FAttackClusteringPartition::UpdateGridClusterCentroidProperties(int32 ClusterID)
+{
+    FAttackCluster& Cluster = Clusters[ClusterID];
+    Cluster.CentroidLocation = Cluster.Weight > 0 ? GridClusterLocationSums[ClusterID] / Cluster.Weight : FVector::ZeroVector;
+    Cluster.Direction = GridClusterDirectionSums[ClusterID].GetSafeNormal();
+}
+
+
+void FAttackClusteringPartition::RegisterNewClusterEntryInGrid(const FVector& EntryLocation, const FVector& EntryDirection, int32 Weight)
+{
+    const FVector NormalizedDirection = EntryDirection.GetSafeNormal();
+
+    int32 ClusterID = -1;
+    FIntVector Cell;
+
+    const int32 CoalescedEntryID = FindEntryToCoalesce(EntryLocation);
+    if (CoalescedEntryID != -1)
+    {
+        // add the attack's weight to the existing entry and its cluster
+        FClusterEntry& ClusterEntry = ClusterEntries[CoalescedEntryID];
+        ClusterEntry.EntryDirection = (ClusterEntry.EntryDirection * ClusterEntry.Weight + NormalizedDirection * Weight).GetSafeNormal();
+        ClusterEntry.Weight += Weight;
+
+        ClusterID = ClusterEntry.ClusterID;
+        Cell = GetClusteringGridCell(ClusterEntry.EntryLocation);
+        Clusters[ClusterID].Weight += Weight;
+        GridClusterLocationSums[ClusterID] += ClusterEntry.EntryLocation * Weight;
+        GridClusterDirectionSums[ClusterID] += NormalizedDirection * Weight;
+    }
+    else
+    {
+        FClusterEntry NewClusterEntry;
+        NewClusterEntry.EntryID = ClusterEntries.Num();
+        NewClusterEntry.EntryType = EntryType;
+        NewClusterEntry.EntryLocation = EntryLocation;
+        NewClusterEntry.EntryDirection = NormalizedDirection;
+        NewClusterEntry.Weight = Weight;
+
+        Cell = GetClusteringGridCell(EntryLocation);
+        const int32* CellClusterID = GridCellClusterIDs.Find(Cell);
+        if (CellClusterID)
+        {
+            ClusterID = FindGridClusterRoot(*CellClusterID);
+            NewClusterEntry.ClusterID = ClusterID;
+            Clusters[ClusterID].AddEntry(NewClusterEntry);
+            GridClusterLocationSums[ClusterID] += EntryLocation * Weight;
+            GridClusterDirectionSums[ClusterID] += NormalizedDirection * Weight;
+        }
+        else
+        {
+            ClusterID = Clusters.Num();
+            NewClusterEntry.ClusterID = ClusterID;
+            CreateNewCluster(NewClusterEntry);
+            GridCellClusterIDs.Add(Cell, ClusterID);
+            GridClusterParentIDs.Add(ClusterID);
+            GridClusterLocationSums.Add(EntryLocation * Weight);
+            GridClusterDirectionSums.Add(NormalizedDirection * Weight);
+        }
+
+        ClusterEntries.Add(NewClusterEntry);
+        AddToCoalescingGrid(NewClusterEntry);
+    }
+
+    UpdateGridClusterCentroidProperties(ClusterID);
+    AddToChangedClustersPayloadIfNeeded(ClusterID);
+
+    UniteAdjacentGridClusters(Cell);
+}
+
+
+void FAttackClusteringPartition::UniteAdjacentGridClusters(const FIntVector& Cell)
+{
+    const int32* CellClusterID = GridCellClusterIDs.Find(Cell);
+    if (!CellClusterID) return;
+
+    for (int32 DX = -1; DX <= 1; ++DX)
     {
-        ChangesOccurred = false;
-        // a copy to avoid "Array has changed during ranged-for iteration" error because of the recursive nature of function calls
-        TArray<FAttackCluster> ClustersCopy = Clusters;
-        for (FAttackCluster& CurrentClusterCopy : ClustersCopy)
+        for (int32 DY = -1; DY <= 1; ++DY)
         {
-            ChangesOccurred |= HandleExpelledClusterEntries(CurrentClusterCopy, Depth);
+            for (int32 DZ = -1; DZ <= 1; ++DZ)
+            {
+                if (DX == 0 && DY == 0 && DZ == 0) continue;
+
+                const int32* NeighbourClusterID = GridCellClusterIDs.Find(Cell + FIntVector(DX, DY, DZ));
+                if (!NeighbourClusterID) continue;
+
+                const int32 RootClusterID = FindGridClusterRoot(*CellClusterID);
+                const int32 NeighbourRootClusterID = FindGridClusterRoot(*NeighbourClusterID);
+                if (RootClusterID == NeighbourRootClusterID) continue;
+
+                // Adjacent cells are united only if they represent the same hotspot split by a cell border
+                if (FVector::Dist(Clusters[RootClusterID].CentroidLocation, Clusters[NeighbourRootClusterID].CentroidLocation) > MaxClusterRadius) continue;
+
+                // union by size: the smaller cluster is absorbed by the bigger one
+                if (Clusters[RootClusterID].EntryIDs.Num() >= Clusters[NeighbourRootClusterID].EntryIDs.Num())
+                {
+                    UniteGridClusters(NeighbourRootClusterID, RootClusterID);
+                }
+                else
+                {
+                    UniteGridClusters(RootClusterID, NeighbourRootClusterID);
+                }
+            }
         }
     }
+}
 
-    return true;
+
+void FAttackClusteringPartition::UniteGridClusters(int32 MovedSourceClusterID, int32 MasterClusterID)
+{
+    FAttackCluster& SourceCluster = Clusters[MovedSourceClusterID];
+    FAttackCluster& MasterCluster = Clusters[MasterClusterID];
+
+    for (const int32 MovedEntryID : SourceCluster.EntryIDs)
+    {
+        ClusterEntries[MovedEntryID].ClusterID = MasterClusterID;
+    }
+    MasterCluster.EntryIDs.Append(SourceCluster.EntryIDs);
+    MasterCluster.Weight += SourceCluster.Weight;
+    GridClusterLocationSums[MasterClusterID] += GridClusterLocationSums[MovedSourceClusterID];
+    GridClusterDirectionSums[MasterClusterID] += GridClusterDirectionSums[MovedSourceClusterID];
+    UpdateGridClusterCentroidProperties(MasterClusterID);
+
+    SourceCluster.EntryIDs.Empty();
+    SourceCluster.Weight = 0;
+    SourceCluster.IsValid = false;
+    GridClusterParentIDs[MovedSourceClusterID] = MasterClusterID;
+
+    // update ChangedClustersIDsPayload with changed clusters IDs
+    AddToChangedClustersPayloadIfNeeded({MovedSourceClusterID, MasterClusterID});
+
+    FClusteringTelemetry::Record(EClusteringTelemetryEvent::ClustersMerged, EntryType, MasterClusterID, MovedSourceClusterID, MasterCluster.CentroidLocation);
 }
@@ -4,8 +4,15 @@
 
 #include "CoreMinimal.h"
 #include "Subsystems/WorldSubsystem.h"
+#include "Templates/PimplPtr.h"
+#include "MBCG/AI/Data/MBCG_DangerPyramid.h"
 #include "MBCG_AttackClusteringSubsystem.generated.h"
 
+
+class FAttackClustersSnapshot;
+class FAttackClustersSnapshotPublisher;
+class AMBCG_ReplicatedAttackClusters;
+
 /**
  * This susbsystem implements clasterizing locations (both instigators's and victims' in separate cluster groups) to define ambush locations or places of death.
  * Currently only attack source location (InstigatorLocation) and target location (VictimLocation) are taken into account when clasterizing.
@@ -19,7 +26,20 @@ UENUM(BlueprintType)
 enum class EEntryType : uint8
 {
     Instigator,  // Default
-    Victim
+    Victim,
+    MAX UMETA(Hidden)
+};
+
+
+// Algorithm used to cluster entries
+UENUM(BlueprintType)
+enum class EAttackClusteringMode : uint8
+{
+    // Clusters are adjusted (entries expelled, re-assigned, clusters united) after every registration. Default
+    Exact,
+    // Entries are assigned to fixed grid cells of MaxClusterRadius size, adjacent cells with close centroids are united. No adjustments are made, so inserts are O(1),
+    // but a cluster may contain entries further than MaxClusterRadius from its centroid
+    Grid
 };
 
 
@@ -31,7 +51,7 @@ struct FClusterEntry
 {
     GENERATED_BODY()
 
-    // identifier for this entry, serving as its index in the NPCAmbushAvoidanceSubsystem's attack array
+    // identifier for this entry, serving as its index in the entries array of the clustering partition of its EntryType
     UPROPERTY(BlueprintReadOnly)
     int32 EntryID = -1;
 
@@ -50,6 +70,10 @@ struct FClusterEntry
     // ID of the cluster to which this entry belongs (-1 = unclustered)
     UPROPERTY(BlueprintReadOnly)
     int32 ClusterID = -1;
+
+    // Multiplicity of the entry: number of registered attacks coalesced into this entry (see EntryCoalescingRadius)
+    UPROPERTY(BlueprintReadOnly)
+    int32 Weight = 1;
 };
 
 
@@ -60,7 +84,7 @@ struct FAttackCluster
 {
     GENERATED_BODY()
 
-    // identifier for the cluster
+    // identifier for the cluster, serving as its index in the clusters array of the clustering partition of its EntryType
     UPROPERTY(BlueprintReadOnly)
     int32 ClusterID = -1;
 
@@ -84,60 +108,96 @@ struct FAttackCluster
     UPROPERTY(BlueprintReadOnly)
     bool IsValid = false;
 
-    // Update the cluster's centroid and average direction
+    // Sum of the cluster entries' weights, i.e. number of registered attacks in the cluster
+    UPROPERTY(BlueprintReadOnly)
+    int32 Weight = 0;
+
+    // Update the cluster's centroid, average direction (both weighted by entries' Weight) and Weight
     // @param AttackEntries Reference to all cluster entries
     void UpdateCentroidProperties(const TArray<FClusterEntry>& ClusterEntries);
-};
 
+    // Add the entry to EntryIDs keeping Weight up to date. Centroid properties are not updated
+    void AddEntry(const FClusterEntry& ClusterEntry);
 
-DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnAttackClustersChanged);
-DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnSomeAttackClustersChanged, const TArray<int32>&, ChangedClustersIDsPayload);
+    // Remove the entry from EntryIDs keeping Weight up to date. Centroid properties are not updated
+    void RemoveEntry(const FClusterEntry& ClusterEntry);
+};
 
 
-UCLASS()
-class LYRAGAME_API UMBCG_AttackClusteringSubsystem : public UWorldSubsystem
+// Input data for a single cluster entry to be registered.
+// It is not stored anywhere, a FClusterEntry is created from it when registering.
+struct FClusterEntryRegistration
 {
-    GENERATED_BODY()
+    // Location by which clusters are defined
+    FVector EntryLocation = FVector::ZeroVector;
 
-public:
+    // Direction of the entry (normalized on registration)
+    FVector EntryDirection = FVector::ZeroVector;
+
+    // Type of the entry. Defines to which clustering partition the entry goes
+    EEntryType EntryType = EEntryType::Instigator;
+
+    // Number of attacks this registration represents
+    int32 Weight = 1;
+
+    // Index of the clustering context of the entry (see UMBCG_AttackClusteringSubsystem::FindClusteringContext()), 0 = default context
+    int32 ContextIdx = 0;
+};
 
-    virtual void Initialize(FSubsystemCollectionBase& Collection) override;
-    virtual void Deinitialize() override;
 
+// Clustering state and algorithm for cluster entries of one EntryType.
+//
+// Entries and clusters of different EntryType never interact, so each EntryType is clustered in its own partition owning its own entries, clusters and change payload.
+// This allows partitions of different EntryType to be processed concurrently (see UMBCG_AttackClusteringSubsystem::RegisterNewClusterEntries).
+// A single partition is not thread-safe and must be processed by one thread at a time.
+class FAttackClusteringPartition
+{
 public:
 
-    // Get all cluster entries
-    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    explicit FAttackClusteringPartition(EEntryType InEntryType = EEntryType::Instigator)
+        : EntryType(InEntryType)
+    {
+    }
+
+    // Create cluster entries from the registrations, place them into clusters and adjust clusters if needed.
+    // Collects IDs of all changed clusters into ChangedClustersIDsPayload (emptied first).
+    // @param Registrations Entries to register. All of them must be of the partition's EntryType
+    void RegisterNewClusterEntries(TConstArrayView<FClusterEntryRegistration> Registrations);
+
+    // Clear all entries and clusters
+    void Reset();
+
+    EEntryType GetEntryType() const { return EntryType; }
+
     const TArray<FClusterEntry>& GetClusterEntries() const { return ClusterEntries; }
 
-    // Get all clusters
-    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
     const TArray<FAttackCluster>& GetClusters() const { return Clusters; }
 
-    // Get maximum radius of a cluster
-    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
-    float GetMaxClusterRadius() const { return MaxClusterRadius; }
+    // return ChangedClustersIDsPayload - the array with Cluster IDs which were changed as a result of the last call of RegisterNewClusterEntries()
+    const TArray<int32>& GetChangedClustersIDsPayload() const { return ChangedClustersIDsPayload; }
 
-    // Set maximum radius of clusters. This functin is supposed to be run before clastering.
-    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
     void SetMaxClusterRadius(float NewMaxClusterRadius) { MaxClusterRadius = NewMaxClusterRadius; }
 
-    // From user-input (UMBCG_NPCAmbushAvaisionSubsystem::RegisterNewAttack) create one or more cluster entries depending on AttackRegistrationType
-    void RegisterNewClusterEntry(const FVector& EntryLocation, const FVector& EntryDirection, const EEntryType EntryType = EEntryType::Instigator);
+    void SetReassignmentHysteresis(float NewReassignmentHysteresis) { ReassignmentHysteresis = FMath::Clamp(NewReassignmentHysteresis, 0.f, 1.f); }
 
-    // Delegate for broadcasting when any of clusters are changed
-    UPROPERTY(BLueprintAssignable)
-    FOnAttackClustersChanged OnAttackClustersChangedDelegate;
+    void SetMaxReassignmentPasses(int32 NewMaxReassignmentPasses) { MaxReassignmentPasses = FMath::Max(1, NewMaxReassignmentPasses); }
 
-    // Delegate for broadcasting when specific clusters are changed
-    UPROPERTY(BLueprintAssignable)
-    FOnSomeAttackClustersChanged OnSomeAttackClustersChangedDelegate;
+    EAttackClusteringMode GetClusteringMode() const { return ClusteringMode; }
 
-    // return ChangedClustersIDsPayload - the aray with Cluster IDs which were changed as a result of the last call of RegisterNewClusterEntry()
-    const TArray<int32>& GetChangedClustersIDsPayload() const { return ChangedClustersIDsPayload; }
+    // Supposed to be set before any entry is registered
+    void SetClusteringMode(EAttackClusteringMode NewClusteringMode) { ClusteringMode = NewClusteringMode; }
+
+    // Note: changing the radius does not re-index already registered entries, so it is supposed to be set before clustering
+    void SetEntryCoalescingRadius(float NewEntryCoalescingRadius) { EntryCoalescingRadius = NewEntryCoalescingRadius; }
+
+    // Maximum number of adjustment steps a registration took during the last call of RegisterNewClusterEntries()
+    int32 GetRecordedAdjustmentSteps() const { return RecordedAdjustmentSteps; }
 
 private:
 
+    // Type of all entries and clusters in this partition
+    EEntryType EntryType = EEntryType::Instigator;
+
     // List of all cluster entries, with the array index corresponding to EntryID (e.g. ClusterEntries[7].EntryID = 7)
     TArray<FClusterEntry> ClusterEntries;
     // List of all clusters, with the array index corresponding to ClusterID (e.g. Clusters[7].ClusterID = 7)
@@ -146,8 +206,15 @@ private:
     // Parameters
     // .. Maximum distance between cluster centroid and the cluster entries' Locations to belong to the same cluster
     float MaxClusterRadius = 175.0f;
-    // .. Maximum recursive depth to prevent infinite loops
-    const int32 MaxRecursionDepth = 100;
+    // .. Work budget of one registration: expulsion checks, reassignment passes and cluster unions it causes, all together.
+    // .. When it's spent, the current assignment is kept (expelled entries are still placed), so the worst-case registration time is bounded
+    const int32 MaxAdjustmentSteps = 1024;
+    // .. Relative score improvement (0..1) required to move a cluster entry from its current cluster to another one when handling overlapping clusters
+    float ReassignmentHysteresis = 0.1f;
+    // .. Maximum number of reassignment passes per adjustment. When reached, the current assignment is kept
+    int32 MaxReassignmentPasses = 32;
+    // .. Attacks closer than this distance to an existing entry are coalesced into that entry increasing its Weight (0 = no coalescing)
+    float EntryCoalescingRadius = 10.f;
     // .. Precomputed cosine of 30 degrees for directional similarity
     // .. COP: Not used for now
     // float CosMaxMeleeAmbushSectorDegrees = 0.87f;
@@ -155,37 +222,80 @@ private:
     // gravity constant to calculate how much a cluster attracts its cluster entries
     float ClusterGravity = 9.8f;
 
+    // Algorithm used for clustering in this partition
+    EAttackClusteringMode ClusteringMode = EAttackClusteringMode::Exact;
+
+    // Debug: maximum number of adjustment steps taken by a registration of the last RegisterNewClusterEntries()
+    int32 RecordedAdjustmentSteps = 0;
+
+    // Adjustment steps left to the current registration (see MaxAdjustmentSteps)
+    int32 RemainingAdjustmentSteps = 0;
+
+    // Whether the current registration asked for a step after spending all of them
+    bool bAdjustmentBudgetSpent = false;
+
+    // Take an adjustment step of the current registration. Returns false if all of them are spent, which is reported once per registration
+    bool ConsumeAdjustmentStep();
+
+    // Worklist of entries expelled from their clusters (unclustered) and waiting to be placed again, see IntegrateExpelledClusterEntries()
+    TArray<int32> ExpelledEntryIDs;
+
+    // Create a cluster entry (or coalesce the attack into an existing entry) and integrate it into clusters
+    void RegisterNewClusterEntry(const FVector& EntryLocation, const FVector& EntryDirection, int32 Weight);
+
+    // Uniform grid of entries with cell size equal to EntryCoalescingRadius to find near-duplicate entries
+    TMultiMap<FIntVector, int32> CoalescingGrid;
+
+    FIntVector GetCoalescingGridCell(const FVector& Location) const;
+
+    void AddToCoalescingGrid(const FClusterEntry& ClusterEntry);
+
+    // Returns ID of the closest entry within EntryCoalescingRadius from EntryLocation, or -1 if there is no such entry
+    int32 FindEntryToCoalesce(const FVector& EntryLocation) const;
+
+    // Adds the attack's weight to an existing entry and adjusts its cluster whose centroid may have shifted
+    void CoalesceIntoClusterEntry(int32 EntryID, const FVector& EntryDirection, int32 Weight);
+
     // Returns reciprocal effect of cluster gravity (the closer to the cluster, the lower value). Returns FLT_MAX if distance is outside cluster's boundaries. Returning 0 is possible
     float CalculateClusterReciprocalGravityEffect(float DistanceToCluster, int32 ClusterID) const;
 
-    // Intelligently (using recursion) integrates a new cluster entry into an appropriate attack cluster, managing cluster composition and relationships.
+    // Intelligently integrates a new cluster entry into an appropriate attack cluster, managing cluster composition and relationships.
     //
     // This function attempts to place the given cluster entry into an existing cluster or create a new cluster if needed.
     // The integration process is dynamic and may cause cascading adjustments to existing clusters:
     // - A cluster entry might be added to an existing cluster based on similarity attributes
     // - Existing cluster entries in the chosen or other clusters may be relocated to maintain cluster coherence
     // - Similarity is determined by location (direction is not considered as a clastering parameter)
-    // - Cluster are grouped independently by entry type
+    //
+    // Entries expelled on the way are handled by a worklist (see IntegrateExpelledClusterEntries()), not by recursion.
     //
     // @param ClusterEntry Reference to the cluster entry to be integrated into the cluster system
-    // @param Depth Current recursion depth to prevent infinite recursive clustering (default: 0)
     //
-    // @return True if successful integration, false if recursion depth exceeds a predefined threshold
-    bool IntegrateClusterEntry(const FClusterEntry& ClusterEntry, int32 Depth = 0);
+    // @return True if successful integration, false if the input is wrong
+    bool IntegrateClusterEntry(const FClusterEntry& ClusterEntry);
+
+    // Put the cluster entry into the best cluster (or a new one) and expel the entries the cluster's shifted centroid doesn't cover any more (see ExpelledEntryIDs).
+    // @return True if successful placement, false if the input is wrong
+    bool PlaceClusterEntry(const FClusterEntry& ClusterEntry);
+
+    // Place the entries of the ExpelledEntryIDs worklist, including the ones expelled meanwhile, until it's empty
+    void IntegrateExpelledClusterEntries();
 
     // Find the best cluster for a cluster entry, or return -1 if no suitable cluster exists
     // @return Clusters's array index which is equal to ClusterID
     int32 FindBestCluster(const FClusterEntry& ClusterEntry) const;
+    // @param BestScore Reciprocal gravity effect of the found cluster. FLT_MAX if no cluster was found or the found cluster is outside MaxClusterRadius
+    int32 FindBestCluster(const FClusterEntry& ClusterEntry, float& BestScore) const;
+
+    // Returns reciprocal gravity effect of the cluster the entry currently belongs to, or FLT_MAX if the entry is free to be moved (unclustered, outside its cluster or alone in it)
+    float CalculateCurrentClusterScore(const FClusterEntry& ClusterEntry) const;
 
     // Create a new cluster for a cluster entry. Returns ID of the created cluster, or -1 if there was something wrong
     int32 CreateNewCluster(const FClusterEntry& ClusterEntry);
 
-    // Adjusts clusters by expelling cluster entries outside the MaxClusterRadius and forming new clusters
-    // @param ClusterCopy Reference to a copy of the cluster to be adjusted. The original cluster will be identified using ClusterCopy.ClusterID and modified in the Clusters array.
-    // Passing a reference to the original cluster is prohibited to ensure changes are made directly to the Clusters array because of the potentially recursive nature of function calls.
-    //
-    // @return True if cluster was changed, False if there were no changes made to the cluster or recursion depth was exceeded
-    bool HandleExpelledClusterEntries(const FAttackCluster& ClusterCopy, int32 Depth = 0);
+    // Adjusts the cluster by expelling cluster entries outside the MaxClusterRadius into the ExpelledEntryIDs worklist. Each check takes an adjustment step
+    // @return True if cluster was changed, False if there were no changes made to the cluster or the adjustment steps are spent
+    bool HandleExpelledClusterEntries(int32 ClusterID);
 
     // Manages cluster assignment for cluster entries to be re-assigned to a different cluster in scenarios with overlapping clusters.
     //
@@ -199,12 +309,19 @@ private:
     //
     // Key responsibilities:
     // - Ensure each cluster entry is assigned to its most suitable cluster
-    //
-    // @param EntryType Specifies clusters of which type to consider for re-assignment
-    void HandleEntriesInOverlappingClusters(const EEntryType EntryType, int32 Depth = 0);
+    // - Ensure the adjustment is bounded: an entry moves only if the new cluster is better by ReassignmentHysteresis, repeated assignment states (oscillation) stop the adjustment,
+    //   and no more than MaxReassignmentPasses passes are made
+    void HandleEntriesInOverlappingClusters();
 
+    // A single pass of HandleEntriesInOverlappingClusters(): re-assigns entries to their most suitable clusters and then updates the affected clusters' centroids.
+    // @return True if any cluster was changed
+    bool ReassignEntriesInOverlappingClusters();
 
-    // Array of cluster IDs that were changed as a result of the last call of RegisterNewClusterEntry().
+    // Returns hash of the current entries-to-clusters assignment, used to detect oscillation
+    uint64 CalculateAssignmentStateHash() const;
+
+
+    // Array of cluster IDs that were changed as a result of the last call of RegisterNewClusterEntries().
     // The array is passed as a OnSomeAttackClustersChangedDelegate delegate's payload
     // The array's elements are stored in accordance with Clusters and by index (i.e. ChangedAttackClustersIDsPayload[SomeIdx] == Clusters[SomeIdx] == SomeIdx)
     // The array may contain null elements
@@ -214,6 +331,34 @@ private:
     void AddToChangedClustersPayloadIfNeeded(int32 ClusterID);
     void AddToChangedClustersPayloadIfNeeded(const TArray<int32>& ClusterIDs);
 
+    // Grid clustering mode (EAttackClusteringMode::Grid)
+private:
+
+    // Grid cell (of MaxClusterRadius size) to ID of the cluster created for it. The cluster may be absorbed by another one later, use FindGridClusterRoot() to get the actual cluster
+    TMap<FIntVector, int32> GridCellClusterIDs;
+    // Union-find parents of clusters, with the array index corresponding to ClusterID. A root cluster is its own parent
+    TArray<int32> GridClusterParentIDs;
+    // Running weighted sums of entries' locations and directions of clusters, with the array index corresponding to ClusterID
+    TArray<FVector> GridClusterLocationSums;
+    TArray<FVector> GridClusterDirectionSums;
+
+    FIntVector GetClusteringGridCell(const FVector& Location) const;
+
+    // Returns ID of the actual (root) cluster which the input cluster was united into, compressing the path
+    int32 FindGridClusterRoot(int32 ClusterID);
+
+    // Update the cluster's centroid and average direction from the running sums in O(1)
+    void UpdateGridClusterCentroidProperties(int32 ClusterID);
+
+    // Create a cluster entry (or coalesce the attack into an existing entry), put it into the cluster of its grid cell and unite the cell with adjacent cells if needed
+    void RegisterNewClusterEntryInGrid(const FVector& EntryLocation, const FVector& EntryDirection, int32 Weight);
+
+    // Unite the cluster of the cell with clusters of adjacent cells whose centroids are within MaxClusterRadius
+    void UniteAdjacentGridClusters(const FIntVector& Cell);
+
+    // Move all entries of the source cluster into the master cluster, invalidating the source cluster
+    void UniteGridClusters(int32 MovedSourceClusterID, int32 MasterClusterID);
+
     // Checks
 private:
 
@@ -230,10 +375,11 @@ private:
     // Find and unite clusters that are fully overlapping by their entries
     //
     // Iterates through clusters and identifies cases where one cluster's entries are completely contained within another cluster's boundaries. When such clusters are found, the most suitable
-    // cluster is chosen to absorb the overlapping cluster.
+    // cluster is chosen to absorb the overlapping cluster. Only one pair is united per call (taking an adjustment step), since the union shifts the master's centroid
+    // and entries should be reassigned before looking for the next pair.
     //
-    // @param EntryType Specifies clusters of which type to consider for processing
-    void FindAndUniteFullyOverlappingClusters(const EEntryType EntryType);
+    // @return bool True if clusters were united, false if there are no fully overlapping clusters or the adjustment steps are spent
+    bool FindAndUniteFullyOverlappingClusters();
 
     // Determines whether one cluster's entries are completely contained within
     // the boundaries of another cluster by comparing their spatial characteristics.
@@ -259,7 +405,7 @@ private:
     //
     // Transfers cluster entries from a source cluster to a target cluster, assuming
     // complete spatial overlap between the clusters.
-    // The clusters which are to be united must be of the same EntryType and contain at least one cluster entry each.
+    // The clusters which are to be united must contain at least one cluster entry each.
     //
     // @param MovedSourceClusterID The ID of the cluster whose entries will be transferred
     // @param BestMasterClusterID The ID of the cluster receiving the transferred entries
@@ -267,3 +413,307 @@ private:
     // @return bool True if entries were successfully moved, false if an error occurred
     bool UniteClusters(const int32 MovedSourceClusterID, int32 BestMasterClusterID);
 };
+
+
+// Changes of all EntryTypes of one clustering context made by one registration batch.
+// Payloads have the ChangedClustersIDsPayload format: indexed by cluster ID, -1 for unchanged clusters; empty if no clusters of the type were changed
+USTRUCT(BlueprintType)
+struct FAttackClustersChangeSet
+{
+    GENERATED_BODY()
+
+    // Clustering context of the changes (NAME_None = default context)
+    UPROPERTY(BlueprintReadOnly)
+    FName Context;
+
+    // .. its index, see UMBCG_AttackClusteringSubsystem::FindClusteringContext()
+    UPROPERTY(BlueprintReadOnly)
+    int32 ContextIdx = 0;
+
+    UPROPERTY(BlueprintReadOnly)
+    TArray<int32> InstigatorClustersIDsPayload;
+
+    UPROPERTY(BlueprintReadOnly)
+    TArray<int32> VictimClustersIDsPayload;
+
+    const TArray<int32>& GetPayload(EEntryType EntryType) const { return EntryType == EEntryType::Victim ? VictimClustersIDsPayload : InstigatorClustersIDsPayload; }
+    TArray<int32>& GetPayload(EEntryType EntryType) { return EntryType == EEntryType::Victim ? VictimClustersIDsPayload : InstigatorClustersIDsPayload; }
+
+    // True if some clusters of the type were changed
+    bool HasChanges(EEntryType EntryType) const;
+};
+
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnAttackClustersChanged);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnSomeAttackClustersChanged, EEntryType, EntryType, const TArray<int32>&, ChangedClustersIDsPayload);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnAttackClustersChangeSet, const FAttackClustersChangeSet&, ChangeSet);
+
+
+UCLASS()
+class LYRAGAME_API UMBCG_AttackClusteringSubsystem : public UWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+
+    virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+    virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+    virtual void Deinitialize() override;
+
+public:
+
+    // Get all cluster entries of the specified type of the default clustering context. Game thread only.
+    // Empty while a scheduled batch is in flight (see SetUseSharedClusteringScheduler())
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    const TArray<FClusterEntry>& GetClusterEntries(EEntryType EntryType) const;
+
+    // Get all clusters of the specified type of the default clustering context. Game thread only, other threads should use GetLatestClustersSnapshot().
+    // Empty while a scheduled batch is in flight (see SetUseSharedClusteringScheduler())
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    const TArray<FAttackCluster>& GetClusters(EEntryType EntryType) const;
+
+    // Get all clusters of the specified type of the clustering context, empty if there is no such context or a scheduled batch is in flight. Game thread only
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    const TArray<FAttackCluster>& GetContextClusters(EEntryType EntryType, FName Context) const;
+
+    // Get maximum radius of a cluster
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    float GetMaxClusterRadius() const { return MaxClusterRadius; }
+
+    // Set maximum radius of clusters. This functin is supposed to be run before clastering.
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetMaxClusterRadius(float NewMaxClusterRadius);
+
+    // Set relative score improvement (0..1) required to move a cluster entry to another cluster when clusters overlap. Bigger values make clusters more stable.
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetReassignmentHysteresis(float NewReassignmentHysteresis);
+
+    // Set maximum number of reassignment passes per adjustment which bounds the worst-case registration time
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetMaxReassignmentPasses(int32 NewMaxReassignmentPasses);
+
+    // Get the algorithm used for clustering
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    EAttackClusteringMode GetClusteringMode() const { return GetPartition(EEntryType::Instigator).GetClusteringMode(); }
+
+    // Set the algorithm used for clustering in this world (e.g. Grid for low-end servers and bot-heavy modes).
+    // This function must be run before clastering, it does nothing if some entries are already registered.
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetClusteringMode(EAttackClusteringMode NewClusteringMode);
+
+    // Set the distance within which a new attack is coalesced into an existing entry of the same type instead of creating a new entry (0 = no coalescing).
+    // This function is supposed to be run before clastering.
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetEntryCoalescingRadius(float NewEntryCoalescingRadius);
+
+    // Cluster this world's registrations on the process-wide UMBCG_ClusteringSchedulerSubsystem instead of the game thread (e.g. for dedicated servers hosting many matches).
+    // When enabled, registrations are queued and clustered in batches on worker threads, listeners are notified on the game thread when a batch is done.
+    // While a batch is in flight the partitions belong to it: GetClusters()/GetClusterEntries() return nothing and the clustering parameters can't be changed,
+    // readers should use GetLatestClustersSnapshot() or the change delegates (which are broadcast after the batch is done).
+    // This function must be run before clastering, it does nothing if some entries are already registered.
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetUseSharedClusteringScheduler(bool bNewUseSharedClusteringScheduler);
+
+    // Set maximum number of registrations clustered by one scheduled job, so that a bursty world never occupies a shared worker for long
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetMaxRegistrationsPerScheduledBatch(int32 NewMaxRegistrationsPerScheduledBatch);
+
+    // Set named clustering contexts in addition to the default one (NAME_None), e.g. one per team so that team A's killzones are not team B's.
+    // Entries of each context are clustered in their own partitions, clusters of all contexts share one spatial index (see GetLatestClustersSnapshot()).
+    // This function must be run before clastering, it does nothing if some entries are already registered.
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetClusteringContexts(const TArray<FName>& NewClusteringContexts);
+
+    // Get names of all clustering contexts, with the array index corresponding to the context index. The default context NAME_None is the first one
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    const TArray<FName>& GetClusteringContexts() const { return ClusteringContexts; }
+
+    // Index of the clustering context, INDEX_NONE if there is no such context
+    int32 FindClusteringContext(FName Context) const { return ClusteringContexts.IndexOfByKey(Context); }
+
+    // From user-input (UMBCG_NPCAmbushAvaisionSubsystem::RegisterNewAttack) create a cluster entry of the specified type
+    void RegisterNewClusterEntry(const FVector& EntryLocation, const FVector& EntryDirection, const EEntryType EntryType = EEntryType::Instigator);
+
+    // Register several cluster entries at once.
+    // Entries of different EntryType are clustered concurrently in their own partitions (one worker task per extra partition, joined before broadcasting).
+    // OnSomeAttackClustersChangedDelegate is broadcast once for each EntryType whose clusters were changed, after all partitions are processed.
+    // With the shared clustering scheduler the registrations are only queued here and the delegates are broadcast later.
+    void RegisterNewClusterEntries(const TArray<FClusterEntryRegistration>& Registrations);
+
+    // Delegate for broadcasting when any of clusters are changed
+    UPROPERTY(BLueprintAssignable)
+    FOnAttackClustersChanged OnAttackClustersChangedDelegate;
+
+    // Delegate for broadcasting when specific clusters of some EntryType of the default clustering context are changed
+    UPROPERTY(BLueprintAssignable)
+    FOnSomeAttackClustersChanged OnSomeAttackClustersChangedDelegate;
+
+    // Delegate for broadcasting once per registration batch and changed clustering context with the changes of all EntryTypes merged, after OnSomeAttackClustersChangedDelegate.
+    // E.g. an attack registered as InstigatorAndVictim is a single transaction with a single change set
+    UPROPERTY(BLueprintAssignable)
+    FOnAttackClustersChangeSet OnAttackClustersChangeSetDelegate;
+
+    // return ChangedClustersIDsPayload - the aray with Cluster IDs of the specified type which were changed as a result of the last registration
+    const TArray<int32>& GetChangedClustersIDsPayload(EEntryType EntryType) const { return GetPartition(EntryType).GetChangedClustersIDsPayload(); }
+
+    // Spatial danger queries.
+    // They are served from the spatial index of the latest snapshot (see GetLatestClustersSnapshot()), so they are cheap enough for every NPC's decision tick and can be called from any thread.
+    // Returned cluster IDs are indices in GetContextClusters(EntryType, Context). The batched variants take the snapshot once for all locations.
+    // Queries of an unknown clustering context find no clusters.
+
+    // Danger at the location: Weight of the clusters of the type within DangerQueryRadius, falling off linearly with distance
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    float GetDangerScoreAtLocation(const FVector& Location, EEntryType EntryType, FName Context = NAME_None) const;
+
+    // Danger at each of the locations, OutDangerScores[idx] corresponds to Locations[idx]
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void GetDangerScoresAtLocations(const TArray<FVector>& Locations, EEntryType EntryType, TArray<float>& OutDangerScores, FName Context = NAME_None) const;
+
+    // IDs of clusters of the type whose centroid is within Radius from Location
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    TArray<int32> FindClustersInRadius(const FVector& Location, float Radius, EEntryType EntryType, FName Context = NAME_None) const;
+
+    // IDs of clusters within Radius from each of the locations: OutClusterCounts[idx] IDs for Locations[idx] follow each other in OutClusterIDs in the order of Locations
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void FindClustersInRadiusOfLocations(const TArray<FVector>& Locations, float Radius, EEntryType EntryType, TArray<int32>& OutClusterIDs, TArray<int32>& OutClusterCounts, FName Context = NAME_None) const;
+
+    // IDs of up to K clusters of the type nearest to Location, closest first
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    TArray<int32> FindNearestClusters(const FVector& Location, int32 K, EEntryType EntryType, FName Context = NAME_None) const;
+
+    // IDs of up to K nearest clusters for each of the locations: OutClusterIDs[idx * K .. idx * K + K - 1] are for Locations[idx], padded with -1
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void FindNearestClustersOfLocations(const TArray<FVector>& Locations, int32 K, EEntryType EntryType, TArray<int32>& OutClusterIDs, FName Context = NAME_None) const;
+
+    // Danger of a region: Weight of the clusters of the type in the danger pyramid's cell containing Location whose size is the finest one not smaller than RegionSize.
+    // O(1) regardless of the number of clusters, e.g. for squad- and commander-level AI. Game thread only
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    int32 GetRegionDanger(const FVector& Location, float RegionSize, EEntryType EntryType, FName Context = NAME_None) const;
+
+    // Weight of the clusters of the type in the box (X, Y only), up to the resolution of 2 * MaxClusterRadius at the box's border. Game thread only
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    int32 GetDangerInBox(const FBox& Box, EEntryType EntryType, FName Context = NAME_None) const;
+
+    // Multi-resolution aggregation of cluster weights of the type and clustering context, updated after each change batch. Game thread only
+    const FDangerPyramid& GetDangerPyramid(EEntryType EntryType, int32 ContextIdx = 0) const { return DangerPyramids[GetPartitionIdx(EntryType, ContextIdx)]; }
+
+    // Set number of levels of the danger pyramids, each level doubles the cell size starting from 2 * MaxClusterRadius
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetDangerPyramidNumLevels(int32 NewDangerPyramidNumLevels);
+
+    // Get the radius of GetDangerScoreAtLocation()
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    float GetDangerQueryRadius() const { return DangerQueryRadius; }
+
+    // Set the radius of GetDangerScoreAtLocation(). Radii up to 2 * MaxClusterRadius (the index's cell size) keep a query within 3x3 cells
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetDangerQueryRadius(float NewDangerQueryRadius);
+
+    // Replicate clusters to clients with AMBCG_ReplicatedAttackClusters spawned by the server at world begin play. Only changed clusters are sent.
+    // This function must be run before the world begins play.
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetReplicateClustersToClients(bool bNewReplicateClustersToClients) { bReplicateClustersToClients = bNewReplicateClustersToClients; }
+
+    // Actor replicating clusters: spawned on the server, replicated on clients. Nullptr if clusters are not replicated (or not replicated yet on a client)
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    AMBCG_ReplicatedAttackClusters* GetReplicatedClustersActor() const { return ReplicatedClustersActor; }
+
+    // Called by AMBCG_ReplicatedAttackClusters when it begins and ends play
+    void SetReplicatedClustersActor(AMBCG_ReplicatedAttackClusters* InReplicatedClustersActor) { ReplicatedClustersActor = InReplicatedClustersActor; }
+
+    // Returns the latest immutable snapshot of clusters, published after each change batch.
+    // Thread-safe and lock-free: can be called from any thread while the subsystem is alive, the returned snapshot stays valid as long as it is referenced.
+    TSharedPtr<const FAttackClustersSnapshot, ESPMode::ThreadSafe> GetLatestClustersSnapshot() const;
+
+private:
+
+    // Publishes snapshots of clusters for readers on other threads
+    TPimplPtr<FAttackClustersSnapshotPublisher> SnapshotPublisher;
+
+    // Version of the last published snapshot, increases with each change batch
+    uint64 SnapshotVersion = 0;
+
+    // Build a snapshot of the current state of all partitions and publish it
+    void PublishClustersSnapshot();
+
+    // Cluster the registrations in their partitions concurrently. Returns indices of the processed partitions. Can be run on any thread
+    TArray<int32> ClusterRegistrations(const TArray<FClusterEntryRegistration>& Registrations);
+
+    // Publish the snapshot and broadcast changes of the processed partitions. Game thread only
+    void BroadcastClustersChanged(const TArray<int32>& ProcessedPartitionIdxs);
+
+    // Shared clustering scheduler
+    // .. ID of this world in UMBCG_ClusteringSchedulerSubsystem, INDEX_NONE if clustering runs on the game thread
+    int32 ClusteringSchedulerClientID = INDEX_NONE;
+
+    // .. Registrations waiting for the next scheduled batch
+    TArray<FClusterEntryRegistration> PendingRegistrations;
+
+    // .. Registrations of the batch being clustered, owned by the scheduled job while it is in flight
+    TArray<FClusterEntryRegistration> InFlightRegistrations;
+
+    // .. Partitions processed by the scheduled job, written by the job and read on the game thread after it is done
+    TArray<int32> InFlightProcessedPartitionIdxs;
+
+    // .. True while a batch is submitted to the scheduler and not finished yet. Only one batch per world is in flight so partitions are never touched concurrently
+    bool bScheduledBatchInFlight = false;
+
+    // .. Per-world budget of one scheduled job
+    int32 MaxRegistrationsPerScheduledBatch = 64;
+
+    // Danger queries
+    // .. Radius within which clusters contribute to the danger score
+    float DangerQueryRadius = 350.f;
+
+    // .. Number of levels of the danger pyramids
+    int32 DangerPyramidNumLevels = 8;
+
+    // .. Batched queries with fewer locations are run on the calling thread only
+    static constexpr int32 MinLocationsForParallelQuery = 64;
+
+    // Returns false (with a warning) while a scheduled batch is in flight, since the partitions must not be read or changed on the game thread meanwhile
+    bool SoftCheckNoScheduledBatchInFlight(const TCHAR* FunctionName) const;
+
+    // Submit the next batch of pending registrations unless a batch is already in flight
+    void SubmitPendingRegistrations();
+
+    // Called on the game thread when the scheduled batch is done
+    void OnScheduledBatchFinished();
+
+    // Replication
+    // .. If the server spawns AMBCG_ReplicatedAttackClusters
+    bool bReplicateClustersToClients = true;
+
+    UPROPERTY()
+    TObjectPtr<AMBCG_ReplicatedAttackClusters> ReplicatedClustersActor;
+
+    // Danger pyramids, one per clustering partition, with the array index corresponding to the partition's index
+    TArray<FDangerPyramid> DangerPyramids;
+
+    // Update the danger pyramid with the changed clusters of the partition. Game thread only
+    void UpdateDangerPyramid(int32 PartitionIdx);
+
+    // Rebuild all danger pyramids from scratch, e.g. after their layout is changed
+    void RebuildDangerPyramids();
+
+    // Names of the clustering contexts, with the array index corresponding to the context index. The default context NAME_None is always the first one
+    TArray<FName> ClusteringContexts = {NAME_None};
+
+    // .. the context index is replicated as uint8 (see FMBCG_ReplicatedAttackCluster)
+    static constexpr int32 MaxClusteringContexts = 256;
+
+    // Clustering partitions, one per clustering context and EEntryType, with the array index ContextIdx * EEntryType::MAX + EEntryType (see GetPartitionIdx())
+    TArray<FAttackClusteringPartition> Partitions;
+
+    static int32 GetPartitionIdx(EEntryType EntryType, int32 ContextIdx) { return ContextIdx * static_cast<int32>(EEntryType::MAX) + static_cast<int32>(EntryType); }
+
+    const FAttackClusteringPartition& GetPartition(EEntryType EntryType, int32 ContextIdx = 0) const { return Partitions[GetPartitionIdx(EntryType, ContextIdx)]; }
+    FAttackClusteringPartition& GetPartition(EEntryType EntryType, int32 ContextIdx = 0) { return Partitions[GetPartitionIdx(EntryType, ContextIdx)]; }
+
+    // Create partitions (and danger pyramids) for all clustering contexts. Settings of the existing default context's partitions are kept, their entries are not
+    void CreatePartitions();
+
+    // Parameters
+    // .. Maximum distance between cluster centroid and the cluster entries' Locations to belong to the same cluster (applied to all partitions)
+    float MaxClusterRadius = 175.0f;
+};
\ No newline at end of file
@@ -0,0 +1,165 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Subsystems/MBCG_ClusteringSchedulerSubsystem.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Tasks/Task.h"
+#include "Misc/ScopeLock.h"
+#include "Logging/StructuredLog.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogUMBCG_ClusteringSchedulerSubsystem, All, All);
+
+
+void UMBCG_ClusteringSchedulerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+    Super::Initialize(Collection);
+
+    // by default all worker threads may be busy with clustering of different worlds
+    MaxConcurrentTurns = FMath::Max(1, FTaskGraphInterface::Get().GetNumWorkerThreads());
+}
+
+
+void UMBCG_ClusteringSchedulerSubsystem::Deinitialize()
+{
+    // all clients are supposed to be unregistered by this time
+    {
+        FScopeLock Lock(&Mutex);
+        if (Clients.Num() > 0)
+        {
+            UE_LOGFMT(LogUMBCG_ClusteringSchedulerSubsystem, Warning, "Deinitialize(): {0} clients are still registered.", Clients.Num());
+        }
+    }
+
+    Super::Deinitialize();
+}
+
+
+int32 UMBCG_ClusteringSchedulerSubsystem::RegisterClient(const FString& ClientName)
+{
+    FScopeLock Lock(&Mutex);
+
+    const int32 ClientID = NextClientID++;
+    FClient& Client = Clients.Add(ClientID);
+    Client.Name = ClientName;
+
+    return ClientID;
+}
+
+
+void UMBCG_ClusteringSchedulerSubsystem::UnregisterClient(int32 ClientID)
+{
+    check(IsInGameThread());
+
+    // wait for the running turn to finish: its jobs reference the client's data
+    for (;;)
+    {
+        UE::Tasks::FTask RunningTurn;
+        {
+            FScopeLock Lock(&Mutex);
+            FClient* Client = Clients.Find(ClientID);
+            if (!Client) return;
+
+            Client->PendingJobs.Empty();
+            if (!Client->bRunning)
+            {
+                ReadyClientIDs.Remove(ClientID);
+                Clients.Remove(ClientID);
+                return;
+            }
+            RunningTurn = Client->RunningTurn;
+        }
+
+        // blocks (or runs the turn here if it hasn't started yet) instead of spinning, the turn ends after its current job as there are no pending ones
+        RunningTurn.Wait();
+    }
+}
+
+
+void UMBCG_ClusteringSchedulerSubsystem::SubmitJob(int32 ClientID, TUniqueFunction<void()>&& Job)
+{
+    FScopeLock Lock(&Mutex);
+
+    FClient* Client = Clients.Find(ClientID);
+    if (!Client)
+    {
+        UE_LOGFMT(LogUMBCG_ClusteringSchedulerSubsystem, Error, "SubmitJob(): Unknown ClientID = {0}. The job is dropped.", ClientID);
+        return;
+    }
+
+    Client->PendingJobs.Add(MoveTemp(Job));
+    if (!Client->bRunning && !Client->bReady)
+    {
+        Client->bReady = true;
+        ReadyClientIDs.Add(ClientID);
+    }
+
+    DispatchLocked();
+}
+
+
+void UMBCG_ClusteringSchedulerSubsystem::SetMaxConcurrentTurns(int32 NewMaxConcurrentTurns)
+{
+    FScopeLock Lock(&Mutex);
+    MaxConcurrentTurns = FMath::Max(1, NewMaxConcurrentTurns);
+    DispatchLocked();
+}
+
+
+void UMBCG_ClusteringSchedulerSubsystem::SetMaxJobsPerTurn(int32 NewMaxJobsPerTurn)
+{
+    FScopeLock Lock(&Mutex);
+    MaxJobsPerTurn = FMath::Max(1, NewMaxJobsPerTurn);
+}
+
+
+void UMBCG_ClusteringSchedulerSubsystem::DispatchLocked()
+{
+    while (RunningTurns < MaxConcurrentTurns && ReadyClientIDs.Num() > 0)
+    {
+        const int32 ClientID = ReadyClientIDs[0];
+        ReadyClientIDs.RemoveAt(0);
+
+        FClient& Client = Clients.FindChecked(ClientID);
+        Client.bReady = false;
+        Client.bRunning = true;
+        ++RunningTurns;
+
+        Client.RunningTurn = UE::Tasks::Launch(UE_SOURCE_LOCATION,
+            [this, ClientID]()
+            {
+                RunClientTurn(ClientID);
+            });
+    }
+}
+
+
+void UMBCG_ClusteringSchedulerSubsystem::RunClientTurn(int32 ClientID)
+{
+    for (int32 JobIdx = 0;; ++JobIdx)
+    {
+        TUniqueFunction<void()> Job;
+        {
+            FScopeLock Lock(&Mutex);
+            FClient& Client = Clients.FindChecked(ClientID);
+
+            // the turn is over: give way to other clients
+            if (JobIdx >= MaxJobsPerTurn || Client.PendingJobs.Num() == 0)
+            {
+                Client.bRunning = false;
+                if (Client.PendingJobs.Num() > 0)
+                {
+                    Client.bReady = true;
+                    ReadyClientIDs.Add(ClientID);
+                }
+                --RunningTurns;
+                DispatchLocked();
+                return;
+            }
+
+            Job = MoveTemp(Client.PendingJobs[0]);
+            Client.PendingJobs.RemoveAt(0);
+        }
+
+        Job();
+    }
+}
@@ -0,0 +1,80 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "HAL/CriticalSection.h"
+#include "Tasks/Task.h"
+#include "MBCG_ClusteringSchedulerSubsystem.generated.h"
+
+/**
+ * Process-wide scheduler of clustering jobs shared by all worlds (e.g. several concurrent match worlds in one dedicated server process).
+ *
+ * Each world (a client of the scheduler) submits jobs into its own FIFO queue, jobs of one client are executed one at a time and in order.
+ * Clients with pending jobs are served round-robin: a client runs at most MaxJobsPerTurn jobs per turn and then goes to the end of the ready queue, so a bursty world can't stall the others.
+ * Turns are executed on UE::Tasks worker threads (work-stealing), no more than MaxConcurrentTurns at a time, so throughput scales with core count.
+ */
+UCLASS()
+class LYRAGAME_API UMBCG_ClusteringSchedulerSubsystem : public UEngineSubsystem
+{
+    GENERATED_BODY()
+
+public:
+
+    virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+    virtual void Deinitialize() override;
+
+public:
+
+    // Register a client (e.g. a world's clustering subsystem). Returns ID of the client
+    int32 RegisterClient(const FString& ClientName);
+
+    // Unregister the client dropping its pending jobs. Waits until the client's running job (if any) is finished. Game thread only.
+    void UnregisterClient(int32 ClientID);
+
+    // Add the job to the end of the client's queue. Thread-safe
+    void SubmitJob(int32 ClientID, TUniqueFunction<void()>&& Job);
+
+    // Set maximum number of client turns running concurrently on worker threads
+    void SetMaxConcurrentTurns(int32 NewMaxConcurrentTurns);
+
+    // Set maximum number of jobs a client runs per turn before giving way to other clients
+    void SetMaxJobsPerTurn(int32 NewMaxJobsPerTurn);
+
+private:
+
+    struct FClient
+    {
+        FString Name;
+        TArray<TUniqueFunction<void()>> PendingJobs;
+        // True while a turn of this client is running
+        bool bRunning = false;
+        // Task of the running (or the last) turn
+        UE::Tasks::FTask RunningTurn;
+        // True while the client is in ReadyClientIDs
+        bool bReady = false;
+    };
+
+    // Guards all the data below. Held only for queue operations, never while jobs run
+    FCriticalSection Mutex;
+
+    TMap<int32, FClient> Clients;
+
+    // Clients with pending jobs which are not running, in round-robin order
+    TArray<int32> ReadyClientIDs;
+
+    int32 NextClientID = 0;
+
+    int32 RunningTurns = 0;
+
+    int32 MaxConcurrentTurns = 1;
+
+    int32 MaxJobsPerTurn = 1;
+
+    // Launch turns of ready clients while there are free worker slots. Mutex must be locked
+    void DispatchLocked();
+
+    // Run up to MaxJobsPerTurn jobs of the client on the current (worker) thread
+    void RunClientTurn(int32 ClientID);
+};
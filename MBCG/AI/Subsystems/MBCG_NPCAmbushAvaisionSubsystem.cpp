@@ -1,11 +1,25 @@
 // Copyright DevRespawn.com (MBCG). All Rights Reserved.
 
 #include "MBCG/AI/Subsystems/MBCG_NPCAmbushAvaisionSubsystem.h"
+#include "MBCG/AI/Data/MBCG_AttackRecorder.h"
+#include "Character/LyraHealthComponent.h"
+#include "AbilitySystem/Attributes/LyraHealthSet.h"  // for TAG_Lyra_Damage_Message
+#include "Messages/LyraVerbMessage.h"
+#include "Teams/LyraTeamSubsystem.h"
+#include "AIController.h"
+#include "GameFramework/PlayerState.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "NativeGameplayTags.h"
 #include "Logging/StructuredLog.h"
 
 
 DEFINE_LOG_CATEGORY_STATIC(LogUMBCG_NPCAmbushAvaisionSubsystem, All, All);
 
+// Lyra defines its elimination message tag as a static in LyraHealthComponent.cpp, so the same tag is defined here
+UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_MBCG_Lyra_Elimination_Message, "Lyra.Elimination.Message");
+
 
 void UMBCG_NPCAmbushAvaisionSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
@@ -23,45 +37,315 @@ void UMBCG_NPCAmbushAvaisionSubsystem::PostInitialize()
 
     // this hub subsystem listens to the AttackClusteringSubsystem's delegate to update the navmesh
     AttackClusteringSubsystem->OnAttackClustersChangedDelegate.AddDynamic(this, &UMBCG_NPCAmbushAvaisionSubsystem::OnAttackClustersChanged);
-    AttackClusteringSubsystem->OnSomeAttackClustersChangedDelegate.AddDynamic(this, &UMBCG_NPCAmbushAvaisionSubsystem::OnSomeAttackClustersChanged);
-    // OnSomeAttackClustersChanged(const TArray<int32>& ChangedClustersIDsPayload)
+    // one change set per registration batch, so an InstigatorAndVictim attack updates the navmesh once
+    AttackClusteringSubsystem->OnAttackClustersChangeSetDelegate.AddDynamic(this, &UMBCG_NPCAmbushAvaisionSubsystem::OnAttackClustersChangeSet);
 
     // make DeathNavModifierVolume a similar size as cluster
     NavSubsystem->SetDeathNavModifierVolumeHalfSize(AttackClusteringSubsystem->GetMaxClusterRadius());
+
+    // record production sessions, one file per world
+    FString RecordingDirectory;
+    if (GetWorld()->IsGameWorld() && FParse::Value(FCommandLine::Get(), TEXT("MBCGRecordAttacks="), RecordingDirectory))
+    {
+        // <MapName>_<Timestamp> lets UMBCG_DeathHeatmapBakeCommandlet group recordings by map
+        const FString FileName = FString::Printf(TEXT("%s_%s%s"), *GetWorld()->GetName(), *FDateTime::Now().ToString(), FAttackRecorder::FileExtension);
+        StartAttackRecording(FPaths::Combine(RecordingDirectory, FileName));
+    }
+}
+
+
+void UMBCG_NPCAmbushAvaisionSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+    Super::OnWorldBeginPlay(InWorld);
+
+    // elimination messages are broadcast by the authority
+    // worlds without a game instance (e.g. the commandlets' standalone worlds) have no gameplay message subsystem
+    if (bListenToEliminationMessages && InWorld.IsGameWorld() && InWorld.GetNetMode() != NM_Client && UGameplayMessageSubsystem::HasInstance(&InWorld))
+    {
+        UGameplayMessageSubsystem& MessageSubsystem = UGameplayMessageSubsystem::Get(&InWorld);
+        EliminationListenerHandle = MessageSubsystem.RegisterListener(TAG_MBCG_Lyra_Elimination_Message, this, &UMBCG_NPCAmbushAvaisionSubsystem::OnEliminationMessage);
+        DamageListenerHandle = MessageSubsystem.RegisterListener(TAG_Lyra_Damage_Message, this, &UMBCG_NPCAmbushAvaisionSubsystem::OnDamageMessage);
+    }
 }
 
 
 void UMBCG_NPCAmbushAvaisionSubsystem::Deinitialize()
 {
+    EliminationListenerHandle.Unregister();
+    DamageListenerHandle.Unregister();
+    DamageAggregator.Reset();
+    StopAttackRecording();
+    SubmittedAttacks.Empty();
+
     AttackClusteringSubsystem->OnAttackClustersChangedDelegate.RemoveDynamic(this, &UMBCG_NPCAmbushAvaisionSubsystem::OnAttackClustersChanged);
-    AttackClusteringSubsystem->OnSomeAttackClustersChangedDelegate.RemoveDynamic(this, &UMBCG_NPCAmbushAvaisionSubsystem::OnSomeAttackClustersChanged);
+    AttackClusteringSubsystem->OnAttackClustersChangeSetDelegate.RemoveDynamic(this, &UMBCG_NPCAmbushAvaisionSubsystem::OnAttackClustersChangeSet);
 
     Super::Deinitialize();
 }
 
 
+void UMBCG_NPCAmbushAvaisionSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    // all the attacks submitted since the last tick and the aggregated hits of the finished windows are clustered as one batch
+    TArray<FClusterEntryRegistration> Registrations;
+    FSubmittedAttack SubmittedAttack;
+    for (int32 AttackIdx = 0; AttackIdx < MaxSubmittedAttacksPerTick && SubmittedAttacks.Dequeue(SubmittedAttack); ++AttackIdx)
+    {
+        AddAttackRegistrations(SubmittedAttack.InstigatorLocation, SubmittedAttack.InstigatorDirection, SubmittedAttack.AttackRegistrationType,  //
+            SubmittedAttack.VictimLocation, SubmittedAttack.VictimDirection, 1 /* Weight */, FindClusteringContextOrDefault(SubmittedAttack.Context), Registrations);
+    }
+
+    TArray<FAggregatedAttack> AggregatedAttacks;
+    DamageAggregator.Flush(GetWorld()->GetTimeSeconds(), AggregatedAttacks);
+    for (const FAggregatedAttack& AggregatedAttack : AggregatedAttacks)
+    {
+        AddAttackRegistrations(AggregatedAttack.InstigatorLocation, AggregatedAttack.InstigatorDirection, EAttackRegistrationType::InstigatorAndVictim,  //
+            AggregatedAttack.VictimLocation, FVector::ZeroVector, AggregatedAttack.Weight, FindClusteringContextOrDefault(AggregatedAttack.Context), Registrations);
+    }
+
+    if (Registrations.Num() == 0) return;
+
+    AttackClusteringSubsystem->RegisterNewClusterEntries(Registrations);
+}
+
+
+TStatId UMBCG_NPCAmbushAvaisionSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UMBCG_NPCAmbushAvaisionSubsystem, STATGROUP_Tickables);
+}
+
+
 void UMBCG_NPCAmbushAvaisionSubsystem::RegisterNewAttack(                   //
     const FVector& InstigatorLocation, const FVector& InstigatorDirection,  //
     const EAttackRegistrationType& AttackRegistrationType,                  //
-    const FVector& VictimLocation, const FVector& VictimDirection)
+    const FVector& VictimLocation, const FVector& VictimDirection,          //
+    FName Context)
+{
+    RegisterNewWeightedAttack(InstigatorLocation, InstigatorDirection, AttackRegistrationType, VictimLocation, VictimDirection, 1 /* Weight */, Context);
+}
+
+
+void UMBCG_NPCAmbushAvaisionSubsystem::RegisterNewWeightedAttack(           //
+    const FVector& InstigatorLocation, const FVector& InstigatorDirection,  //
+    const EAttackRegistrationType AttackRegistrationType,                   //
+    const FVector& VictimLocation, const FVector& VictimDirection,          //
+    int32 Weight,                                                           //
+    FName Context)
+{
+    TArray<FClusterEntryRegistration> Registrations;
+    AddAttackRegistrations(InstigatorLocation, InstigatorDirection, AttackRegistrationType, VictimLocation, VictimDirection, Weight, FindClusteringContextOrDefault(Context), Registrations);
+
+    // Cluster are independently grouped by EEntryType, so with InstigatorAndVictim both types are clustered concurrently
+    AttackClusteringSubsystem->RegisterNewClusterEntries(Registrations);
+}
+
+
+void UMBCG_NPCAmbushAvaisionSubsystem::RegisterNonLethalHit(FObjectKey InstigatorKey, const FVector& InstigatorLocation, const FVector& InstigatorDirection, const FVector& VictimLocation, float Damage,  //
+    FName Context)
+{
+    if (!bAggregateNonLethalHits) return;
+
+    DamageAggregator.AddHit(InstigatorKey, InstigatorLocation, InstigatorDirection, VictimLocation, Damage, GetWorld()->GetTimeSeconds(), Context);
+}
+
+
+void UMBCG_NPCAmbushAvaisionSubsystem::SetAggregateNonLethalHits(bool bNewAggregateNonLethalHits)
+{
+    bAggregateNonLethalHits = bNewAggregateNonLethalHits;
+    if (!bAggregateNonLethalHits)
+    {
+        DamageAggregator.Reset();
+    }
+}
+
+
+void UMBCG_NPCAmbushAvaisionSubsystem::SubmitAttack(                        //
+    const FVector& InstigatorLocation, const FVector& InstigatorDirection,  //
+    const EAttackRegistrationType AttackRegistrationType,                   //
+    const FVector& VictimLocation, const FVector& VictimDirection,          //
+    FName Context)
+{
+    // the context is resolved on the game thread since the clustering subsystem's contexts are game thread only
+    SubmittedAttacks.Enqueue({InstigatorLocation, InstigatorDirection, AttackRegistrationType, VictimLocation, VictimDirection, Context});
+}
+
+
+int32 UMBCG_NPCAmbushAvaisionSubsystem::FindClusteringContextOrDefault(FName Context) const
 {
-    if (AttackRegistrationType == EAttackRegistrationType::OnlyInstigator)
+    const int32 ContextIdx = AttackClusteringSubsystem->FindClusteringContext(Context);
+    if (ContextIdx == INDEX_NONE)
     {
-        AttackClusteringSubsystem->RegisterNewClusterEntry(InstigatorLocation, InstigatorDirection, EEntryType::Instigator);
+        UE_LOGFMT(LogUMBCG_NPCAmbushAvaisionSubsystem, Warning, "FindClusteringContextOrDefault(): Unknown clustering context {0}, the attack is registered in the default context.", Context);
+        return 0;
     }
-    if (AttackRegistrationType == EAttackRegistrationType::OnlyVictim)
+    return ContextIdx;
+}
+
+
+void UMBCG_NPCAmbushAvaisionSubsystem::AddAttackRegistrations(              //
+    const FVector& InstigatorLocation, const FVector& InstigatorDirection,  //
+    const EAttackRegistrationType AttackRegistrationType,                   //
+    const FVector& VictimLocation, const FVector& VictimDirection,          //
+    int32 Weight,                                                           //
+    int32 ContextIdx,                                                       //
+    TArray<FClusterEntryRegistration>& Registrations /* Target */)
+{
+    if (AttackRecorder)
     {
-        AttackClusteringSubsystem->RegisterNewClusterEntry(VictimLocation, VictimDirection, EEntryType::Victim);
+        FAttackRecord AttackRecord;
+        AttackRecord.FrameNumber = static_cast<uint32>(GFrameCounter);
+        AttackRecord.AttackRegistrationType = AttackRegistrationType;
+        AttackRecord.InstigatorLocation = InstigatorLocation;
+        AttackRecord.InstigatorDirection = InstigatorDirection;
+        AttackRecord.VictimLocation = VictimLocation;
+        AttackRecord.VictimDirection = VictimDirection;
+        AttackRecord.Weight = Weight;
+        const TArray<FName>& ClusteringContexts = AttackClusteringSubsystem->GetClusteringContexts();
+        AttackRecord.Context = ClusteringContexts.IsValidIndex(ContextIdx) ? ClusteringContexts[ContextIdx] : NAME_None;
+        AttackRecorder->Record(AttackRecord);
     }
-    if (AttackRegistrationType == EAttackRegistrationType::InstigatorAndVictim)
+
+    if (AttackRegistrationType == EAttackRegistrationType::OnlyInstigator || AttackRegistrationType == EAttackRegistrationType::InstigatorAndVictim)
+    {
+        FClusterEntryRegistration& InstigatorRegistration = Registrations.AddDefaulted_GetRef();
+        InstigatorRegistration.EntryLocation = InstigatorLocation;
+        InstigatorRegistration.EntryDirection = InstigatorDirection;
+        InstigatorRegistration.EntryType = EEntryType::Instigator;
+        InstigatorRegistration.Weight = Weight;
+        InstigatorRegistration.ContextIdx = ContextIdx;
+    }
+    if (AttackRegistrationType == EAttackRegistrationType::OnlyVictim || AttackRegistrationType == EAttackRegistrationType::InstigatorAndVictim)
     {
-        // Cluster are independently grouped by EEntryType
-        AttackClusteringSubsystem->RegisterNewClusterEntry(InstigatorLocation, InstigatorDirection, EEntryType::Instigator);
-        AttackClusteringSubsystem->RegisterNewClusterEntry(VictimLocation, VictimDirection, EEntryType::Victim);
+        FClusterEntryRegistration& VictimRegistration = Registrations.AddDefaulted_GetRef();
+        VictimRegistration.EntryLocation = VictimLocation;
+        VictimRegistration.EntryDirection = VictimDirection;
+        VictimRegistration.EntryType = EEntryType::Victim;
+        VictimRegistration.Weight = Weight;
+        VictimRegistration.ContextIdx = ContextIdx;
     }
 }
 
 
+APawn* UMBCG_NPCAmbushAvaisionSubsystem::GetAssociatedPawn(UObject* Object)
+{
+    if (APawn* Pawn = Cast<APawn>(Object))
+    {
+        return Pawn;
+    }
+
+    // Instigator as a APlayerState is a default method used in Lyra
+    if (const APlayerState* PlayerState = Cast<APlayerState>(Object))
+    {
+        return PlayerState->GetPawn();
+    }
+
+    if (const AController* Controller = Cast<AController>(Object))
+    {
+        return Controller->GetPawn();
+    }
+
+    return nullptr;
+}
+
+
+bool UMBCG_NPCAmbushAvaisionSubsystem::IsControlledByAI(const APawn* Pawn)
+{
+    if (!Pawn) return false;
+
+    const AController* Controller = Pawn->GetController();
+    return Controller && Controller->IsA(AAIController::StaticClass());
+}
+
+
+FName UMBCG_NPCAmbushAvaisionSubsystem::GetTeamClusteringContext(int32 TeamId)
+{
+    return FName(*FString::Printf(TEXT("Team%d"), TeamId));
+}
+
+
+FName UMBCG_NPCAmbushAvaisionSubsystem::GetVictimClusteringContext(const APawn* VictimPawn) const
+{
+    if (!bRouteDeathsByTeam) return NAME_None;
+
+    const ULyraTeamSubsystem* TeamSubsystem = GetWorld()->GetSubsystem<ULyraTeamSubsystem>();
+    const int32 TeamId = TeamSubsystem ? TeamSubsystem->FindTeamFromObject(VictimPawn) : INDEX_NONE;
+    if (TeamId == INDEX_NONE) return NAME_None;
+
+    // teams without their own context share the default one
+    const FName TeamContext = GetTeamClusteringContext(TeamId);
+    return AttackClusteringSubsystem->FindClusteringContext(TeamContext) != INDEX_NONE ? TeamContext : NAME_None;
+}
+
+
+void UMBCG_NPCAmbushAvaisionSubsystem::OnEliminationMessage(FGameplayTag Channel, const FLyraVerbMessage& Message)
+{
+    // Target is the eliminated pawn's player state
+    APawn* VictimPawn = GetAssociatedPawn(Message.Target);
+    if (!IsControlledByAI(VictimPawn)) return;
+
+    const FName Context = GetVictimClusteringContext(VictimPawn);
+
+    const APawn* InstigatorPawn = GetAssociatedPawn(Message.Instigator);
+    if (!InstigatorPawn)
+    {
+        // e.g. falling out of the world
+        SubmitAttack(FVector::ZeroVector, FVector::ZeroVector, EAttackRegistrationType::OnlyVictim, VictimPawn->GetActorLocation(), FVector::ZeroVector, Context);
+        return;
+    }
+
+    SubmitAttack(                                      //
+        InstigatorPawn->GetActorLocation(),            //
+        InstigatorPawn->GetViewRotation().Vector(),    //
+        EAttackRegistrationType::InstigatorAndVictim,  //
+        VictimPawn->GetActorLocation(),                //
+        FVector::ZeroVector,                           //
+        Context);
+}
+
+
+void UMBCG_NPCAmbushAvaisionSubsystem::OnDamageMessage(FGameplayTag Channel, const FLyraVerbMessage& Message)
+{
+    APawn* VictimPawn = GetAssociatedPawn(Message.Target);
+    if (!IsControlledByAI(VictimPawn)) return;
+
+    // the message is broadcast before the damage is applied, lethal hits are registered from elimination messages
+    const ULyraHealthComponent* HealthComponent = ULyraHealthComponent::FindHealthComponent(VictimPawn);
+    if (!HealthComponent || HealthComponent->GetHealth() - Message.Magnitude <= 0.f) return;
+
+    const APawn* InstigatorPawn = GetAssociatedPawn(Message.Instigator);
+    if (!InstigatorPawn) return;
+
+    // hits are routed like deaths (see SetRouteDeathsByTeam()), so one team's suppressive fire doesn't mark danger for another team
+    RegisterNonLethalHit(InstigatorPawn, InstigatorPawn->GetActorLocation(), InstigatorPawn->GetViewRotation().Vector(), VictimPawn->GetActorLocation(), Message.Magnitude,  //
+        GetVictimClusteringContext(VictimPawn));
+}
+
+
+void UMBCG_NPCAmbushAvaisionSubsystem::StartAttackRecording(const FString& FilePath)
+{
+    // the previous recording is finished first
+    StopAttackRecording();
+
+    AttackRecorder = MakePimpl<FAttackRecorder>(FilePath);
+    if (!AttackRecorder->IsRecording())
+    {
+        AttackRecorder.Reset();
+        return;
+    }
+
+    UE_LOGFMT(LogUMBCG_NPCAmbushAvaisionSubsystem, Display, "StartAttackRecording(): Recording attacks to {0}.", FilePath);
+}
+
+
+void UMBCG_NPCAmbushAvaisionSubsystem::StopAttackRecording()
+{
+    // the recorder flushes the rest of records on destruction
+    AttackRecorder.Reset();
+}
+
+
 void UMBCG_NPCAmbushAvaisionSubsystem::GetDeathPlacementsFromAttackClusters(const TArray<FAttackCluster>& AttackClusters, TArray<FDeathPlacement>& DeathPlacementsFromClusters /* Target */)
 {
     DeathPlacementsFromClusters.Empty();
@@ -69,58 +353,84 @@ void UMBCG_NPCAmbushAvaisionSubsystem::GetDeathPlacementsFromAttackClusters(cons
 
     for (int32 idx = 0; idx < AttackClusters.Num(); ++idx)
     {
-        FDeathPlacement DeathPlacement;
-        const FAttackCluster& Cluster = AttackClusters[idx];
-        if (Cluster.ClusterID >= 0 && Cluster.EntryType == EEntryType::Victim)
-        {
-            DeathPlacement.DeathPlacementID = Cluster.ClusterID;
-            DeathPlacement.DeathQuantity = Cluster.EntryIDs.Num();
-            DeathPlacement.Location = Cluster.CentroidLocation;
-            DeathPlacement.IsValid = Cluster.IsValid;
-        }
-        // by default DeathPlacement is invalid
-        DeathPlacementsFromClusters[idx] = DeathPlacement;
+        DeathPlacementsFromClusters[idx] = GetDeathPlacementFromAttackCluster(AttackClusters[idx]);
+    }
+}
+
+
+FDeathPlacement UMBCG_NPCAmbushAvaisionSubsystem::GetDeathPlacementFromAttackCluster(const FAttackCluster& Cluster)
+{
+    // by default DeathPlacement is invalid
+    FDeathPlacement DeathPlacement;
+    if (Cluster.ClusterID >= 0 && Cluster.EntryType == EEntryType::Victim)
+    {
+        DeathPlacement.DeathPlacementID = Cluster.ClusterID;
+        DeathPlacement.DeathQuantity = Cluster.Weight;
+        DeathPlacement.Location = Cluster.CentroidLocation;
+        DeathPlacement.IsValid = Cluster.IsValid;
     }
+    return DeathPlacement;
 }
 
 
 void UMBCG_NPCAmbushAvaisionSubsystem::ProcessAttackClustersChanged(bool bAllClustersChanged /* = true*/, const TArray<int32>& ChangedClustersIDs /* = {}*/)
 {
-    // re-write NavSubsysytem's DeathPlacements with data from AttackClusters
-    const TArray<FAttackCluster>& AttackClusters = AttackClusteringSubsystem->GetClusters();
-    TArray<FDeathPlacement> DeathPlacementsFromClusters;
-    GetDeathPlacementsFromAttackClusters(AttackClusters, DeathPlacementsFromClusters);
-    NavSubsystem->SetDeathPlacements(DeathPlacementsFromClusters);
+    // only Victims' clusters represent places of death
+    const TArray<FAttackCluster>& AttackClusters = AttackClusteringSubsystem->GetContextClusters(EEntryType::Victim, NavClusteringContext);
 
     // Let NavSubsystem deal with the updated DeathPlacements
     if (bAllClustersChanged)
     {
-        // apply all death placements
+        // re-write NavSubsysytem's DeathPlacements with data from AttackClusters and apply all of them
+        TArray<FDeathPlacement> DeathPlacementsFromClusters;
+        GetDeathPlacementsFromAttackClusters(AttackClusters, DeathPlacementsFromClusters);
+        NavSubsystem->SetDeathPlacements(DeathPlacementsFromClusters);
         NavSubsystem->ApplyDeathPlacements();
     }
     else
     {
-        // apply only the death placements for the specified clusters
+        // update and apply only the death placements for the specified clusters
+        for (const int32 ClusterID : ChangedClustersIDs)
+        {
+            if (AttackClusters.IsValidIndex(ClusterID))
+            {
+                NavSubsystem->SetDeathPlacement(GetDeathPlacementFromAttackCluster(AttackClusters[ClusterID]));
+            }
+        }
         NavSubsystem->ApplyDeathPlacements(false /* bProcessAll */, ChangedClustersIDs);
     }
 }
 
 
+void UMBCG_NPCAmbushAvaisionSubsystem::SetNavClusteringContext(FName NewNavClusteringContext)
+{
+    if (NewNavClusteringContext == NavClusteringContext) return;
+
+    if (AttackClusteringSubsystem->FindClusteringContext(NewNavClusteringContext) == INDEX_NONE)
+    {
+        UE_LOGFMT(LogUMBCG_NPCAmbushAvaisionSubsystem, Warning, "SetNavClusteringContext(): Unknown clustering context {0}, it must be set in the clustering subsystem first.", NewNavClusteringContext);
+        return;
+    }
+
+    // the death placements of the previous context are replaced by the new context's ones
+    NavClusteringContext = NewNavClusteringContext;
+    ProcessAttackClustersChanged(true /* bAllClustersChanged */, {} /* ChangedClustersIDs */);
+}
+
+
 void UMBCG_NPCAmbushAvaisionSubsystem::OnAttackClustersChanged()
 {
     ProcessAttackClustersChanged(true /* bAllClustersChanged */, {} /* ChangedClustersIDs */);
 }
 
 
-void UMBCG_NPCAmbushAvaisionSubsystem::OnSomeAttackClustersChanged(const TArray<int32>& ChangedClustersIDsPayload)
+void UMBCG_NPCAmbushAvaisionSubsystem::OnAttackClustersChangeSet(const FAttackClustersChangeSet& ChangeSet)
 {
-    // input check
-    if (ChangedClustersIDsPayload.Num() == 0)
-    {
-        UE_LOGFMT(LogUMBCG_NPCAmbushAvaisionSubsystem, Warning, "OnSomeAttackClustersChanged(): Unexpected: ChangedClustersIDsPayload is empty.");
-    }
+    // Cluster IDs are unique only within EntryType and clustering context, and only Victims' clusters of one context correspond to DeathPlacements:
+    // no nav work for instigator-only changes or changes of other contexts
+    if (ChangeSet.Context != NavClusteringContext || !ChangeSet.HasChanges(EEntryType::Victim)) return;
 
-    ProcessAttackClustersChanged(false /* bAllClustersChanged */, ChangedClustersIDsPayload /* ChangedClustersIDs */);
+    ProcessAttackClustersChanged(false /* bAllClustersChanged */, ChangeSet.GetPayload(EEntryType::Victim) /* ChangedClustersIDs */);
 }
 
 #if 0
@@ -4,10 +4,18 @@
 
 #include "CoreMinimal.h"
 #include "Subsystems/WorldSubsystem.h"
+#include "Templates/PimplPtr.h"
+#include "Containers/Queue.h"
+#include "GameFramework/GameplayMessageSubsystem.h"
 #include "MBCG/AI/Subsystems/MBCG_AttackClusteringSubsystem.h"
 #include "MBCG/AI/Subsystems/MBCG_NavSubsystem.h"
+#include "MBCG/AI/Data/MBCG_DamageAggregator.h"
 #include "MBCG_NPCAmbushAvaisionSubsystem.generated.h"
 
+
+class FAttackRecorder;
+struct FLyraVerbMessage;
+
 /**
  * This is a managing hub for subsystems that allow NPC to avoid ambush.
  * Other subsystems that are called from this subsystem:
@@ -43,7 +51,7 @@ enum class EAttackRegistrationType : uint8
 
 
 UCLASS()
-class LYRAGAME_API UMBCG_NPCAmbushAvaisionSubsystem : public UWorldSubsystem
+class LYRAGAME_API UMBCG_NPCAmbushAvaisionSubsystem : public UTickableWorldSubsystem
 {
     GENERATED_BODY()
 
@@ -51,12 +59,19 @@ public:
 
     virtual void Initialize(FSubsystemCollectionBase& Collection) override;
     virtual void PostInitialize() override;
+    virtual void OnWorldBeginPlay(UWorld& InWorld) override;
     virtual void Deinitialize() override;
 
+    //~FTickableGameObject interface
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+    //~End of FTickableGameObject interface
+
 public:
 
     // Create one or more cluster entires (but no more than one entry of each EntryType), place them into a cluster of the corresponding type, adjust clusters if needed.
     // VictimDirection is not used for now.
+    // Context is the clustering context of the entries (see UMBCG_AttackClusteringSubsystem::SetClusteringContexts()), unknown contexts fall back to the default one.
     // This function calls functionality from MBCG_NPCAmbushAvaisionSubsystem.
     UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
     void RegisterNewAttack(                                                                               //
@@ -64,7 +79,143 @@ public:
         const FVector& InstigatorDirection = FVector::ZeroVector,                                         //
         const EAttackRegistrationType& AttackRegistrationType = EAttackRegistrationType::OnlyInstigator,  //
         const FVector& VictimLocation = FVector::ZeroVector,                                              //
-        const FVector& VictimDirection = FVector::ZeroVector);
+        const FVector& VictimDirection = FVector::ZeroVector,                                             //
+        FName Context = NAME_None);
+
+    // RegisterNewAttack for an attack which represents Weight attacks (e.g. aggregated non-lethal hits or a replayed record)
+    void RegisterNewWeightedAttack(                                           //
+        const FVector& InstigatorLocation, const FVector& InstigatorDirection,  //
+        const EAttackRegistrationType AttackRegistrationType,                 //
+        const FVector& VictimLocation, const FVector& VictimDirection,          //
+        int32 Weight,                                                         //
+        FName Context = NAME_None);
+
+    // Register a non-lethal hit of an AI-controlled pawn (e.g. suppressive fire). Game thread only.
+    // Hits are not clustered one by one: they are aggregated per instigator, victim's spatial cell and clustering context (see FDamageAggregator)
+    // and each aggregation window emits one weighted InstigatorAndVictim attack at the subsystem's tick.
+    // Damage messages (TAG_Lyra_Damage_Message) of AI-controlled pawns are registered automatically while listening to elimination messages,
+    // in the victim's clustering context like deaths (see SetRouteDeathsByTeam()).
+    // @param InstigatorKey Identifies the instigator (e.g. its pawn)
+    // @param Context Clustering context of the hit, unknown contexts fall back to the default one
+    void RegisterNonLethalHit(FObjectKey InstigatorKey, const FVector& InstigatorLocation, const FVector& InstigatorDirection, const FVector& VictimLocation, float Damage,  //
+        FName Context = NAME_None);
+
+    // Enable or disable aggregation of non-lethal hits. When disabled RegisterNonLethalHit() does nothing
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetAggregateNonLethalHits(bool bNewAggregateNonLethalHits);
+
+    // Parameters of non-lethal hits aggregation
+    FDamageAggregator& GetDamageAggregator() { return DamageAggregator; }
+
+    // Thread-safe version of RegisterNewAttack for async damage and physics callbacks and other worker-side systems.
+    // The attack is pushed into a lock-free multi-producer queue (producers never block) and is registered on the game thread
+    // at the next tick of the subsystem, together with all the other submitted attacks, as one batch.
+    void SubmitAttack(                                                                                    //
+        const FVector& InstigatorLocation,                                                                //
+        const FVector& InstigatorDirection = FVector::ZeroVector,                                         //
+        const EAttackRegistrationType AttackRegistrationType = EAttackRegistrationType::OnlyInstigator,   //
+        const FVector& VictimLocation = FVector::ZeroVector,                                              //
+        const FVector& VictimDirection = FVector::ZeroVector,                                             //
+        FName Context = NAME_None);
+
+    // Listen to Lyra's elimination messages ("Lyra.Elimination.Message") and register deaths of AI-controlled pawns centrally.
+    // Enabled by default: UMBCG_NPCAmbushAvaisionComponent is then optional and doesn't bind to its owner's health component.
+    // This function is supposed to be run before the world begins play.
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetListenToEliminationMessages(bool bNewListenToEliminationMessages) { bListenToEliminationMessages = bNewListenToEliminationMessages; }
+
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    bool IsListeningToEliminationMessages() const { return EliminationListenerHandle.IsValid(); }
+
+    // Register deaths from elimination messages in the clustering context of the victim's team (see GetTeamClusteringContext()) if such a context is set,
+    // so that e.g. NPCs of team A avoid team A's killzones queried with that context. Otherwise deaths go to the default context
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetRouteDeathsByTeam(bool bNewRouteDeathsByTeam) { bRouteDeathsByTeam = bNewRouteDeathsByTeam; }
+
+    // Name of the clustering context of the Lyra team, e.g. Team1
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    static FName GetTeamClusteringContext(int32 TeamId);
+
+    // Set the clustering context whose Victims' clusters are turned into nav modifiers (the default context by default) and re-apply all of them.
+    // The navmesh is shared by all NPCs, so other contexts are served by the clustering subsystem's queries and EQS with their Context
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void SetNavClusteringContext(FName NewNavClusteringContext);
+
+    // Resolve the pawn behind an object of a damage event (e.g. instigator), which may be a pawn, a player state (default in Lyra) or a controller. Returns nullptr if there is none
+    static APawn* GetAssociatedPawn(UObject* Object);
+
+    // Returns True if Pawn is controlled by AI
+    static bool IsControlledByAI(const APawn* Pawn);
+
+    // Set maximum number of submitted attacks registered per tick, the rest waits for the next ticks
+    void SetMaxSubmittedAttacksPerTick(int32 NewMaxSubmittedAttacksPerTick) { MaxSubmittedAttacksPerTick = FMath::Max(1, NewMaxSubmittedAttacksPerTick); }
+
+    // Start recording all attacks passed to RegisterNewAttack into the binary file (see FAttackRecorder), e.g. to reproduce a hitch with the MBCG_AttackReplay commandlet.
+    // Recording of game worlds also starts automatically with the command line parameter -MBCGRecordAttacks=<Directory>.
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void StartAttackRecording(const FString& FilePath);
+
+    // Stop recording attacks and flush the recording to disk
+    UFUNCTION(BlueprintCallable, Category = "NPC Ambush Avaision Subsystem")
+    void StopAttackRecording();
+
+private:
+
+    // Records attacks while recording is started
+    TPimplPtr<FAttackRecorder> AttackRecorder;
+
+    // Attack submitted with SubmitAttack() from any thread
+    struct FSubmittedAttack
+    {
+        FVector InstigatorLocation;
+        FVector InstigatorDirection;
+        EAttackRegistrationType AttackRegistrationType;
+        FVector VictimLocation;
+        FVector VictimDirection;
+        FName Context;
+    };
+
+    // Multi-producer single-consumer queue of submitted attacks, drained on the game thread in Tick()
+    TQueue<FSubmittedAttack, EQueueMode::Mpsc> SubmittedAttacks;
+
+    int32 MaxSubmittedAttacksPerTick = 256;
+
+    bool bListenToEliminationMessages = true;
+
+    bool bRouteDeathsByTeam = false;
+
+    // Clustering context driving the navmesh
+    FName NavClusteringContext = NAME_None;
+
+    FGameplayMessageListenerHandle EliminationListenerHandle;
+
+    FGameplayMessageListenerHandle DamageListenerHandle;
+
+    // Accumulates non-lethal hits into weighted attacks
+    FDamageAggregator DamageAggregator;
+
+    bool bAggregateNonLethalHits = true;
+
+    // Registers non-lethal hits of AI-controlled pawns
+    void OnDamageMessage(FGameplayTag Channel, const FLyraVerbMessage& Message);
+
+    // Submits an attack for the eliminated AI-controlled pawn, deaths of the same frame are registered as one batch
+    void OnEliminationMessage(FGameplayTag Channel, const FLyraVerbMessage& Message);
+
+    // Clustering context of the victim's team if deaths are routed by team and the team has its context, NAME_None otherwise
+    FName GetVictimClusteringContext(const APawn* VictimPawn) const;
+
+    // Index of the clustering context, the default context's one (with a warning) if there is no such context
+    int32 FindClusteringContextOrDefault(FName Context) const;
+
+    // Add cluster entry registrations of one attack (and record it if recording is started)
+    void AddAttackRegistrations(                                                              //
+        const FVector& InstigatorLocation, const FVector& InstigatorDirection,                //
+        const EAttackRegistrationType AttackRegistrationType,                                 //
+        const FVector& VictimLocation, const FVector& VictimDirection,                        //
+        int32 Weight,                                                                         //
+        int32 ContextIdx,                                                                     //
+        TArray<FClusterEntryRegistration>& Registrations /* Target */);
 
 private:
 
@@ -77,19 +228,22 @@ private:
     // callback function when it's supposed that all clusters changed
     UFUNCTION()
     void OnAttackClustersChanged();
-    // callback function when it's supposed that specified clusters changed
-    // @param ChangedClustersIDsPayload IDs of the clusters which were changed
+    // callback function when a registration batch changed some clusters
+    // @param ChangeSet Changed clusters of all EntryTypes of a clustering context. Only Victims' clusters of NavClusteringContext matter for the navmesh, so other changes are ignored
     UFUNCTION()
-    void OnSomeAttackClustersChanged(const TArray<int32>& ChangedClustersIDsPayload);
+    void OnAttackClustersChangeSet(const FAttackClustersChangeSet& ChangeSet);
     // Calls MBCG_NavSubsystem's function to re-spawn NavModifiers after attack clusters were changed
     // @param bAllClustersChanged True if all clusters were changed, Flase if specified clusters were changed
     // @param ChangedClustersIDs IDs of changed clusters (bAllClustersChanged should be True to consider this parameter)
     void ProcessAttackClustersChanged(bool bAllClustersChanged /* = true*/, const TArray<int32>& ChangedClustersIDs /* = {}*/);
 
     // Clear and fill in DeathPlacementsFromClusters by copying relevant data from AttackClusters to adapt the data (DeathPlacementsFromClusters) for using in NavSubsystem.
-    // Only Victims' clusters's data is copied.
+    // Only Victims' clusters's data is copied, so AttackClusters is supposed to be the Victims' clustering partition.
     // Correspondence with AttackClusters by index is maintained, as well as DeathPlacement.DeathPlacementID == Cluster.ClusterID.
     // @param AttackClusters Source array
     // @param DeathPlacementsFromClusters Target array (emptied first)
     void GetDeathPlacementsFromAttackClusters(const TArray<FAttackCluster>& AttackClusters, TArray<FDeathPlacement>& DeathPlacementsFromClusters /* Target */);
+
+    // Adapt a single Victims' cluster to a DeathPlacement (invalid for other clusters)
+    static FDeathPlacement GetDeathPlacementFromAttackCluster(const FAttackCluster& Cluster);
 };
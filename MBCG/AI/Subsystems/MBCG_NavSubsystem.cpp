@@ -1,6 +1,13 @@
 // Copyright DevRespawn.com (MBCG). All Rights Reserved.
 
 #include "MBCG/AI/Subsystems/MBCG_NavSubsystem.h"
+#include "MBCG/AI/Data/MBCG_DeathHeatmapDataAsset.h"
+#include "MBCG/AI/Settings/MBCG_NavDeveloperSettings.h"
+#include "MBCG/AI/Telemetry/MBCG_ClusteringTelemetry.h"
+#include "MBCG/AI/Volumes/MBCG_DeathPlacesNavModifier.h"
+#include "MBCG/AI/Components/MBCG_DeathPlacesNavModifierComponent.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/PackageName.h"
 #include "Logging/StructuredLog.h"
 
 
@@ -20,9 +27,274 @@ void UMBCG_NavSubsystem::PostInitialize()
 }
 
 
+void UMBCG_NavSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+    Super::OnWorldBeginPlay(InWorld);
+
+    if (!InWorld.IsGameWorld()) return;
+
+    // the map's settings override the defaults. The representation of death places is chosen before anything is applied
+    if (const FMBCG_MapNavSettings* MapNavSettings = UMBCG_NavDeveloperSettings::Get()->FindMapSettings(GetCurrentMapName()))
+    {
+        if (MapNavSettings->NavModifierVolumePoolSize > 0)
+        {
+            DeathNavModifierVolumePoolSize = MapNavSettings->NavModifierVolumePoolSize;
+        }
+        bUseDeathPlacesNavModifier |= MapNavSettings->bUseDeathPlacesNavModifier;
+    }
+
+    // NPCs start the match already aware of historical killzones
+    const UMBCG_DeathHeatmapDataAsset* DeathHeatmap = LoadDeathHeatmapForCurrentMap();
+    if (DeathHeatmap)
+    {
+        ApplyDeathHeatmap(DeathHeatmap);
+    }
+
+    // live death placements activate pooled volumes instead of spawning actors mid-match
+    if (bUseDeathPlacesNavModifier) return;
+    PrewarmDeathNavModifierVolumes(DeathNavModifierVolumePoolSize);
+}
+
+
 void UMBCG_NavSubsystem::Deinitialize()
 {
     Super::Deinitialize();
+
+    // the actors are destroyed with the world
+    DormantDeathNavModifierVolumes.Empty();
+    DeathPlacesNavModifier = nullptr;
+    AppliedDeathHeatmap = nullptr;
+    PendingDeathPlacementIDs.Empty();
+    OldestPendingDeathPlacementTime = -1.;
+}
+
+
+void UMBCG_NavSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    // changes are accumulated for DeathPlacementsFlushInterval since the oldest of them, so several kills in a row rebuild the same tiles once
+    if (OldestPendingDeathPlacementTime >= 0. && GetWorld()->GetTimeSeconds() - OldestPendingDeathPlacementTime >= DeathPlacementsFlushInterval)
+    {
+        FlushDeathPlacements();
+    }
+}
+
+
+TStatId UMBCG_NavSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UMBCG_NavSubsystem, STATGROUP_Tickables);
+}
+
+
+void UMBCG_NavSubsystem::SetDeathPlacementsFlushInterval(float NewDeathPlacementsFlushInterval)
+{
+    DeathPlacementsFlushInterval = FMath::Max(0.f, NewDeathPlacementsFlushInterval);
+
+    if (DeathPlacementsFlushInterval == 0.f)
+    {
+        FlushDeathPlacements();
+    }
+}
+
+
+void UMBCG_NavSubsystem::FlushDeathPlacements()
+{
+    OldestPendingDeathPlacementTime = -1.;
+    if (PendingDeathPlacementIDs.Num() == 0) return;
+
+    // each death placement is applied once with its latest state, whatever happened to it during the batch
+    TArray<int32> DeathPlacementsIDsToProcess = PendingDeathPlacementIDs.Array();
+    PendingDeathPlacementIDs.Reset();
+    DeathPlacementsIDsToProcess.Sort();
+
+    DestroyRespawnNavModifierVolumeByDeathPlacements(DeathPlacementsIDsToProcess);
+}
+
+
+void UMBCG_NavSubsystem::SetDeathNavModifierVolumePoolSize(int32 NewDeathNavModifierVolumePoolSize)
+{
+    DeathNavModifierVolumePoolSize = FMath::Max(0, NewDeathNavModifierVolumePoolSize);
+
+    // no volumes are used with the single nav modifier
+    const UWorld* World = GetWorld();
+    if (World && World->IsGameWorld() && World->HasBegunPlay() && !bUseDeathPlacesNavModifier)
+    {
+        PrewarmDeathNavModifierVolumes(DeathNavModifierVolumePoolSize);
+    }
+}
+
+
+void UMBCG_NavSubsystem::SetUseDeathPlacesNavModifier(bool bNewUseDeathPlacesNavModifier)
+{
+    if (bNewUseDeathPlacesNavModifier == bUseDeathPlacesNavModifier) return;
+
+    // pending changes go to the current representation first, then all applied death places are migrated to the new one
+    FlushDeathPlacements();
+
+    if (bNewUseDeathPlacesNavModifier)
+    {
+        DestroyNavModifierVolumes(DeathNavModifierVolumes);
+        DestroyNavModifierVolumes(HistoricalDeathNavModifierVolumes);
+        HistoricalDeathNavModifierVolumes.Reset();
+
+        // volumes are not needed any more
+        for (AMBCG_DeathPlaceNavModifierVolume* NavModifierVolume : DormantDeathNavModifierVolumes)
+        {
+            if (IsValid(NavModifierVolume))
+            {
+                NavModifierVolume->Destroy();
+            }
+        }
+        DormantDeathNavModifierVolumes.Empty();
+    }
+    else
+    {
+        // unregistering the component dirties the navigable bounds once
+        if (IsValid(DeathPlacesNavModifier))
+        {
+            DeathPlacesNavModifier->Destroy();
+        }
+        DeathPlacesNavModifier = nullptr;
+        NumHistoricalDeathPlaces = 0;
+    }
+
+    bUseDeathPlacesNavModifier = bNewUseDeathPlacesNavModifier;
+
+    const UWorld* World = GetWorld();
+    if (!bUseDeathPlacesNavModifier && World && World->IsGameWorld() && World->HasBegunPlay())
+    {
+        PrewarmDeathNavModifierVolumes(DeathNavModifierVolumePoolSize);
+    }
+
+    if (AppliedDeathHeatmap)
+    {
+        ApplyDeathHeatmap(AppliedDeathHeatmap);
+    }
+
+    TArray<int32> AppliedDeathPlacementIDs;
+    for (int32 DeathPlacementID = 0; DeathPlacementID < DeathPlacements.Num(); ++DeathPlacementID)
+    {
+        if (DeathPlacements[DeathPlacementID].IsValid)
+        {
+            AppliedDeathPlacementIDs.Add(DeathPlacementID);
+        }
+    }
+    if (AppliedDeathPlacementIDs.Num() > 0)
+    {
+        DestroyRespawnNavModifierVolumeByDeathPlacements(AppliedDeathPlacementIDs);
+    }
+
+    UE_LOGFMT(LogUMBCG_NavSubsystem, Display, "SetUseDeathPlacesNavModifier(): {0} death places migrated to {1}.",  //
+        AppliedDeathPlacementIDs.Num(), bUseDeathPlacesNavModifier ? TEXT("the single nav modifier") : TEXT("volumes"));
+}
+
+
+UMBCG_DeathPlacesNavModifierComponent* UMBCG_NavSubsystem::GetDeathPlacesNavModifierComponent()
+{
+    if (!IsValid(DeathPlacesNavModifier))
+    {
+        UWorld* World = GetWorld();
+        if (!World) return nullptr;
+
+        FActorSpawnParameters SpawnParameters;
+        SpawnParameters.ObjectFlags |= RF_Transient;
+        DeathPlacesNavModifier = World->SpawnActor<AMBCG_DeathPlacesNavModifier>(AMBCG_DeathPlacesNavModifier::StaticClass(), FTransform::Identity, SpawnParameters);
+        if (!DeathPlacesNavModifier)
+        {
+            UE_LOGFMT(LogUMBCG_NavSubsystem, Error, "Failed to spawn AMBCG_DeathPlacesNavModifier");
+            return nullptr;
+        }
+    }
+
+    return DeathPlacesNavModifier->GetDeathPlacesNavModifierComponent();
+}
+
+
+void UMBCG_NavSubsystem::ApplyDeathPlacementsToNavModifier(const TArray<int32>& SpecifiedDeathPlacementsIDs)
+{
+    UMBCG_DeathPlacesNavModifierComponent* DeathPlacesNavModifierComponent = GetDeathPlacesNavModifierComponent();
+    if (!DeathPlacesNavModifierComponent) return;
+
+    const FVector DeathPlaceExtent = GetDeathNavModifierVolumeExtent();
+    for (const int32 DeathPlacementID : SpecifiedDeathPlacementsIDs)
+    {
+        if (DeathPlacementID < 0) continue;
+
+        // DeathPlacements ID == corrrespnding array index
+        const FDeathPlacement* DeathPlacement = DeathPlacements.IsValidIndex(DeathPlacementID) ? &DeathPlacements[DeathPlacementID] : nullptr;
+        if (DeathPlacement && DeathPlacement->IsValid && DeathPlacement->DeathQuantity > 0)
+        {
+            // a sub-voxel move keeps the applied box, so only a tier change (if any) is pushed
+            FBox AppliedBox(ForceInit);
+            TSubclassOf<UNavArea> AppliedAreaClass;
+            const bool bApplied = DeathPlacesNavModifierComponent->GetDeathPlace(DeathPlacementID, AppliedBox, AppliedAreaClass);
+            const FBox DeathPlaceBox = bApplied && AppliedBox.GetExtent().Equals(DeathPlaceExtent) && IsDeathPlaceMoveNegligible(AppliedBox.GetCenter(), DeathPlacement->Location)
+                ? AppliedBox
+                : FBox::BuildAABB(DeathPlacement->Location, DeathPlaceExtent);
+
+            DeathPlacesNavModifierComponent->SetDeathPlace(DeathPlacementID, DeathPlaceBox, GetNavAreaObstacleTierClass(DeathPlacement->DeathQuantity));
+        }
+        else
+        {
+            DeathPlacesNavModifierComponent->RemoveDeathPlace(DeathPlacementID);
+        }
+    }
+
+    DeathPlacesNavModifierComponent->FlushDeathPlaces();
+}
+
+
+void UMBCG_NavSubsystem::PrewarmDeathNavModifierVolumes(int32 PoolSize)
+{
+    const uint64 StartCycles = FPlatformTime::Cycles64();
+    const int32 NumSpawned = FMath::Max(0, PoolSize - DormantDeathNavModifierVolumes.Num());
+    for (int32 idx = 0; idx < NumSpawned; ++idx)
+    {
+        AMBCG_DeathPlaceNavModifierVolume* NavModifierVolume = SpawnDormantDeathPlaceNavModifierVolume();
+        if (!NavModifierVolume) break;
+
+        DormantDeathNavModifierVolumes.Add(NavModifierVolume);
+    }
+
+    if (NumSpawned > 0)
+    {
+        UE_LOGFMT(LogUMBCG_NavSubsystem, Display, "PrewarmDeathNavModifierVolumes(): {0} dormant volumes spawned in {1} ms.",  //
+            NumSpawned, FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+    }
+}
+
+
+AMBCG_DeathPlaceNavModifierVolume* UMBCG_NavSubsystem::SpawnDormantDeathPlaceNavModifierVolume()
+{
+    UWorld* World = GetWorld();
+    if (!World) return nullptr;
+
+    const FTransform VolumeTransform = FTransform::Identity;
+    AMBCG_DeathPlaceNavModifierVolume* NavModifierVolume = World->SpawnActorDeferred<AMBCG_DeathPlaceNavModifierVolume>(AMBCG_DeathPlaceNavModifierVolume::StaticClass(), VolumeTransform);
+    if (!NavModifierVolume)
+    {
+        UE_LOGFMT(LogUMBCG_NavSubsystem, Error, "Failed to spawn AMBCG_DeathPlaceNavModifierVolume");
+        return nullptr;
+    }
+
+    // Assign default NavArea class
+    NavModifierVolume->SetAreaClass(UNavArea_Obstacle::StaticClass());
+
+    // dormant before its components are registered, so it never enters the navigation octree until activated
+    NavModifierVolume->DeactivateDeathPlace();
+
+    NavModifierVolume->FinishSpawning(VolumeTransform);
+
+    return NavModifierVolume;
+}
+
+
+FVector UMBCG_NavSubsystem::GetDeathNavModifierVolumeExtent() const
+{
+    // height should be enough to let the volume reach the ground since the death place location is generated at the killed pawn location which is above the ground
+    const float VolumeHeight = 100.f;
+    return FVector(DeathNavModifierVolumeHalfSize - AgentRadius, DeathNavModifierVolumeHalfSize - AgentRadius, VolumeHeight);
 }
 
 
@@ -60,7 +332,18 @@ void UMBCG_NavSubsystem::DestroySingleNavModifierVolume(TArray<ANavModifierVolum
 {
     if (IsValid(VolumesToDestroy[idx]))
     {
-        VolumesToDestroy[idx]->Destroy();
+        FClusteringTelemetry::Record(EClusteringTelemetryEvent::NavVolumeDestroyed, EEntryType::MAX, idx, -1, VolumesToDestroy[idx]->GetActorLocation());
+
+        // death place volumes go back to the pool, which is much cheaper than destroying and spawning actors
+        if (AMBCG_DeathPlaceNavModifierVolume* DeathPlaceVolume = Cast<AMBCG_DeathPlaceNavModifierVolume>(VolumesToDestroy[idx]))
+        {
+            DeathPlaceVolume->DeactivateDeathPlace();
+            DormantDeathNavModifierVolumes.Add(DeathPlaceVolume);
+        }
+        else
+        {
+            VolumesToDestroy[idx]->Destroy();
+        }
         VolumesToDestroy[idx] = nullptr;
 
         // debug
@@ -96,17 +379,7 @@ AMBCG_DeathPlaceNavModifierVolume* UMBCG_NavSubsystem::SpawnDeathPlaceNavModifie
     UWorld* World = GetWorld();
     if (!World || DeathPlacement.DeathQuantity <= 0) return nullptr;
 
-    const FTransform VolumeTransform(FRotator::ZeroRotator, DeathPlacement.Location);
-    AMBCG_DeathPlaceNavModifierVolume* NavModifierVolume = World->SpawnActorDeferred<AMBCG_DeathPlaceNavModifierVolume>(AMBCG_DeathPlaceNavModifierVolume::StaticClass(), VolumeTransform);
-
-    if (!NavModifierVolume)
-    {
-        UE_LOGFMT(LogUMBCG_NavSubsystem, Error, "Failed to spawn AMBCG_DeathPlaceNavModifierVolume");
-        return nullptr;
-    }
-
-    // Assign default NavArea class
-    NavModifierVolume->SetAreaClass(UNavArea_Obstacle::StaticClass());
+    const uint64 StartCycles = FClusteringTelemetry::IsEnabled() ? FPlatformTime::Cycles64() : 0;
 
     // Assign Area Class Override with NavArea_Obstacle's subclasses depending on how many deaths this area corresponds to.
     // Each NavArea_Obstacle's subclass (NavArea_Obstacle_TierXX_MBCG) already has DefaultCost specified.
@@ -116,14 +389,35 @@ AMBCG_DeathPlaceNavModifierVolume* UMBCG_NavSubsystem::SpawnDeathPlaceNavModifie
         UE_LOGFMT(LogUMBCG_NavSubsystem, Error, "SpawnDeathPlaceNavModifierVolume(): TSubclassOf<UNavArea> AreaClass is not defined.");
         return nullptr;
     }
-    UShapeComponent* ShapeComponent = NavModifierVolume->GetBoxComponent();
-    if (!ShapeComponent)
+
+    // a dormant volume from the pool is activated in place, a new one is spawned only if the pool is empty
+    AMBCG_DeathPlaceNavModifierVolume* NavModifierVolume = nullptr;
+    while (!NavModifierVolume && DormantDeathNavModifierVolumes.Num() > 0)
+    {
+        NavModifierVolume = DormantDeathNavModifierVolumes.Pop();
+        if (!IsValid(NavModifierVolume))
+        {
+            NavModifierVolume = nullptr;
+        }
+    }
+    if (!NavModifierVolume)
+    {
+        NavModifierVolume = SpawnDormantDeathPlaceNavModifierVolume();
+    }
+    if (!NavModifierVolume)
     {
-        UE_LOGFMT(LogUMBCG_NavSubsystem, Error, "SpawnDeathPlaceNavModifierVolume(): ShapeComponent is not valid.");
         return nullptr;
     }
+
+    if (!NavModifierVolume->GetBoxComponent())
+    {
+        UE_LOGFMT(LogUMBCG_NavSubsystem, Error, "SpawnDeathPlaceNavModifierVolume(): NavModifierVolume's BoxComponent is null.");
+        DormantDeathNavModifierVolumes.Add(NavModifierVolume);
+        return nullptr;
+    }
+    // Activation moves the volume in place, sets the box extent defining its bounds for a desired effect on NavMesh and the area class override.
     // FYI: e.g. AreaClassOverride == UNavArea_Obstacle_Tier01_MBCG::StaticClass()
-    ShapeComponent->SetAreaClassOverride(AreaClassOverride);  // getter: GetDesiredAreaClass()
+    NavModifierVolume->ActivateDeathPlace(DeathPlacement.Location, AreaClassOverride, GetDeathNavModifierVolumeExtent());  // getter: GetBoxComponent()->GetDesiredAreaClass()
 
 #if 0
     // COP: Each NavArea_Obstacle_TierXX_MBCG class already has DefaultCost specified, so there is no need to dynamically change their DefaultCost.
@@ -158,31 +452,12 @@ AMBCG_DeathPlaceNavModifierVolume* UMBCG_NavSubsystem::SpawnDeathPlaceNavModifie
     */
 #endif
 
-    // UBoxComponent to define the NavModifierVolume's bounds for a desired effect on NavMesh
-    UBoxComponent* BoxComponent = NavModifierVolume->GetBoxComponent();
-    if (BoxComponent)
+    if (FClusteringTelemetry::IsEnabled())
     {
-        // height should be enough to let the volume reach the ground since the death place location is generated at the killed pawn location which is above the ground
-        float VolumeHeight = 100.f;
-        BoxComponent->SetBoxExtent(FVector(DeathNavModifierVolumeHalfSize - AgentRadius, DeathNavModifierVolumeHalfSize - AgentRadius, VolumeHeight));
-
-#if 0
-        // COP: debug volume bounds
-        /*
-        FVector Min, Max;
-        NavModifierVolume->GetActorBounds(true, Min, Max, true);
-        UE_LOGFMT(LogUMBCG_NavSubsystem, Warning, "- SpawnDeathPlaceNavModifierVolume(): NavModifierVolume->GetActorBounds = {0}, {1}, DeathNavModifierVolumeHalfSize = {2}",  //
-            Min.ToString(), Max.ToString(), DeathNavModifierVolumeHalfSize);
-        */
-#endif
-    }
-    else
-    {
-        UE_LOGFMT(LogUMBCG_NavSubsystem, Error, "SpawnDeathPlaceNavModifierVolume(): NavModifierVolume's BoxComponent is null.");
+        const float DurationMs = static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+        FClusteringTelemetry::Record(EClusteringTelemetryEvent::NavVolumeSpawned, EEntryType::MAX, DeathPlacement.DeathPlacementID, DeathPlacement.DeathQuantity, DeathPlacement.Location, DurationMs);
     }
 
-    NavModifierVolume->FinishSpawning(VolumeTransform);
-
 #if 0
     // COP: debug and experiments, left just in case
     /*
@@ -207,6 +482,19 @@ AMBCG_DeathPlaceNavModifierVolume* UMBCG_NavSubsystem::SpawnDeathPlaceNavModifie
 }
 
 
+void UMBCG_NavSubsystem::SetDeathPlacement(const FDeathPlacement& InDeathPlacement)
+{
+    if (InDeathPlacement.DeathPlacementID < 0) return;
+
+    // DeathPlacements ID == corrrespnding array index
+    if (DeathPlacements.Num() <= InDeathPlacement.DeathPlacementID)
+    {
+        DeathPlacements.SetNum(InDeathPlacement.DeathPlacementID + 1);
+    }
+    DeathPlacements[InDeathPlacement.DeathPlacementID] = InDeathPlacement;
+}
+
+
 void UMBCG_NavSubsystem::DestroyRespawnNavModifierVolumeByDeathPlacements(const TArray<int32>& SpecifiedDeathPlacementsIDs)
 {
     UWorld* World = GetWorld();
@@ -220,6 +508,13 @@ void UMBCG_NavSubsystem::DestroyRespawnNavModifierVolumeByDeathPlacements(const
         UE_LOGFMT(LogUMBCG_NavSubsystem, Warning, "DestroyRespawnNavModifierVolumeByDeathPlacements(): Unexpected: SpecifiedDeathPlacementsIDs is empty.");
     }
 
+    // all death places are represented by the single component instead of volumes
+    if (bUseDeathPlacesNavModifier)
+    {
+        ApplyDeathPlacementsToNavModifier(SpecifiedDeathPlacementsIDs);
+        return;
+    }
+
     // for safe writing elements to the array in DeathPlacements's range
     if (DeathNavModifierVolumes.Num() < DeathPlacements.Num())
     {
@@ -227,13 +522,24 @@ void UMBCG_NavSubsystem::DestroyRespawnNavModifierVolumeByDeathPlacements(const
     }
 
 
+    // the common change (a cluster gained a death) re-tiers and slightly moves the volume, so it's updated in place instead of being re-spawned
+    TArray<int32> DeathPlacementsIDsToRespawn;
+    DeathPlacementsIDsToRespawn.Reserve(SpecifiedDeathPlacementsIDs.Num());
+    for (const int32 DeathPlacementID : SpecifiedDeathPlacementsIDs)
+    {
+        if (!UpdateDeathPlaceNavModifierVolumeInPlace(DeathPlacementID))
+        {
+            DeathPlacementsIDsToRespawn.Add(DeathPlacementID);
+        }
+    }
+
     // destroy the nav modifier volumes
-    for (int32 idx = 0; idx < SpecifiedDeathPlacementsIDs.Num(); ++idx)
+    for (const int32 DeathPlacementID : DeathPlacementsIDsToRespawn)
     {
-        if (SpecifiedDeathPlacementsIDs[idx] >= 0)
+        if (DeathNavModifierVolumes.IsValidIndex(DeathPlacementID))
         {
             // DeathNavModifierVolumes are in accordance with DeathPlacements and clusters by array index
-            DestroySingleNavModifierVolume(DeathNavModifierVolumes, idx);
+            DestroySingleNavModifierVolume(DeathNavModifierVolumes, DeathPlacementID);
         }
     }
 
@@ -244,9 +550,10 @@ void UMBCG_NavSubsystem::DestroyRespawnNavModifierVolumeByDeathPlacements(const
     }
 
     // Spawn NavModifierVolumes according to specified DeathPlacements and remember the spawned volumes in DeathNavModifierVolumes
-    for (const int32 DeathPlacementID : SpecifiedDeathPlacementsIDs)
+    for (const int32 DeathPlacementID : DeathPlacementsIDsToRespawn)
     {
-        if (DeathPlacementID == -1) continue;
+        // batched IDs may outlive a shrunk DeathPlacements
+        if (!DeathPlacements.IsValidIndex(DeathPlacementID)) continue;
 
         // DeathPlacements ID == corrrespnding array index
         const FDeathPlacement& DeathPlacement = DeathPlacements[DeathPlacementID];
@@ -282,6 +589,139 @@ void UMBCG_NavSubsystem::DestroyRespawnNavModifierVolumeByDeathPlacements(const
 }
 
 
+bool UMBCG_NavSubsystem::IsDeathPlaceMoveNegligible(const FVector& AppliedLocation, const FVector& NewLocation) const
+{
+    return FVector::DistSquared(AppliedLocation, NewLocation) < FMath::Square(DeathPlaceMinMoveDistance);
+}
+
+
+bool UMBCG_NavSubsystem::UpdateDeathPlaceNavModifierVolumeInPlace(int32 DeathPlacementID)
+{
+    if (!DeathPlacements.IsValidIndex(DeathPlacementID) || !DeathNavModifierVolumes.IsValidIndex(DeathPlacementID)) return false;
+
+    const FDeathPlacement& DeathPlacement = DeathPlacements[DeathPlacementID];
+    if (!DeathPlacement.IsValid || DeathPlacement.DeathQuantity <= 0) return false;
+
+    AMBCG_DeathPlaceNavModifierVolume* NavModifierVolume = Cast<AMBCG_DeathPlaceNavModifierVolume>(DeathNavModifierVolumes[DeathPlacementID]);
+    if (!IsValid(NavModifierVolume) || !NavModifierVolume->IsDeathPlaceActive() || !NavModifierVolume->GetBoxComponent()) return false;
+
+    // a changed extent (e.g. a new DeathNavModifierVolumeHalfSize) needs the full activation
+    if (!NavModifierVolume->GetBoxComponent()->GetUnscaledBoxExtent().Equals(GetDeathNavModifierVolumeExtent())) return false;
+
+    const TSubclassOf<UNavArea> AreaClassOverride = GetNavAreaObstacleTierClass(DeathPlacement.DeathQuantity);
+    const bool bTierChanged = NavModifierVolume->GetDeathPlaceAreaClass() != AreaClassOverride;
+    const bool bMoved = !IsDeathPlaceMoveNegligible(NavModifierVolume->GetActorLocation(), DeathPlacement.Location);
+
+    if (bTierChanged && bMoved)
+    {
+        NavModifierVolume->ActivateDeathPlace(DeathPlacement.Location, AreaClassOverride, GetDeathNavModifierVolumeExtent());
+    }
+    else if (bTierChanged)
+    {
+        NavModifierVolume->SetDeathPlaceAreaClass(AreaClassOverride);
+    }
+    else if (bMoved)
+    {
+        NavModifierVolume->SetDeathPlaceLocation(DeathPlacement.Location);
+    }
+    // else: the same tier and a sub-voxel move don't change the NavMesh, nothing to do
+
+    return true;
+}
+
+
+FString UMBCG_NavSubsystem::GetCurrentMapName() const
+{
+    const UWorld* World = GetWorld();
+    return World ? UWorld::RemovePIEPrefix(FPackageName::GetShortName(World->GetOutermost()->GetName())) : FString();
+}
+
+
+const UMBCG_DeathHeatmapDataAsset* UMBCG_NavSubsystem::LoadDeathHeatmapForCurrentMap() const
+{
+    const FString MapName = GetCurrentMapName();
+    if (MapName.IsEmpty()) return nullptr;
+
+    const FSoftObjectPath DeathHeatmapPath = UMBCG_DeathHeatmapDataAsset::GetAssetPathForMap(MapName);
+
+    // most maps have no heatmap, that's not an error
+    if (!FPackageName::DoesPackageExist(DeathHeatmapPath.GetLongPackageName())) return nullptr;
+
+    const UMBCG_DeathHeatmapDataAsset* DeathHeatmap = Cast<UMBCG_DeathHeatmapDataAsset>(DeathHeatmapPath.TryLoad());
+    if (!DeathHeatmap)
+    {
+        UE_LOGFMT(LogUMBCG_NavSubsystem, Warning, "LoadDeathHeatmapForCurrentMap(): {0} is not a death heatmap.", DeathHeatmapPath.ToString());
+    }
+
+    return DeathHeatmap;
+}
+
+
+void UMBCG_NavSubsystem::ApplyDeathHeatmap(const UMBCG_DeathHeatmapDataAsset* DeathHeatmap)
+{
+    AppliedDeathHeatmap = DeathHeatmap;
+
+    DestroyNavModifierVolumes(HistoricalDeathNavModifierVolumes);
+    HistoricalDeathNavModifierVolumes.Reset();
+
+    if (!DeathHeatmap)
+    {
+        UE_LOGFMT(LogUMBCG_NavSubsystem, Warning, "ApplyDeathHeatmap(): DeathHeatmap is not valid.");
+    }
+
+    if (bUseDeathPlacesNavModifier)
+    {
+        ApplyDeathHeatmapToNavModifier(DeathHeatmap);
+        return;
+    }
+
+    if (!DeathHeatmap) return;
+
+    HistoricalDeathNavModifierVolumes.Reserve(DeathHeatmap->DeathPlacements.Num());
+    for (const FDeathPlacement& DeathPlacement : DeathHeatmap->DeathPlacements)
+    {
+        if (!DeathPlacement.IsValid) continue;
+
+        if (AMBCG_DeathPlaceNavModifierVolume* NavModifierVolume = SpawnDeathPlaceNavModifierVolume(DeathPlacement))
+        {
+            HistoricalDeathNavModifierVolumes.Add(NavModifierVolume);
+        }
+    }
+
+    UE_LOGFMT(LogUMBCG_NavSubsystem, Display, "ApplyDeathHeatmap(): {0} historical death places applied from {1}.", HistoricalDeathNavModifierVolumes.Num(), DeathHeatmap->GetName());
+}
+
+
+void UMBCG_NavSubsystem::ApplyDeathHeatmapToNavModifier(const UMBCG_DeathHeatmapDataAsset* DeathHeatmap)
+{
+    UMBCG_DeathPlacesNavModifierComponent* DeathPlacesNavModifierComponent = GetDeathPlacesNavModifierComponent();
+    if (!DeathPlacesNavModifierComponent) return;
+
+    for (int32 idx = 0; idx < NumHistoricalDeathPlaces; ++idx)
+    {
+        DeathPlacesNavModifierComponent->RemoveDeathPlace(HistoricalDeathPlaceIDOffset + idx);
+    }
+    NumHistoricalDeathPlaces = 0;
+
+    if (DeathHeatmap)
+    {
+        const FVector DeathPlaceExtent = GetDeathNavModifierVolumeExtent();
+        for (const FDeathPlacement& DeathPlacement : DeathHeatmap->DeathPlacements)
+        {
+            if (!DeathPlacement.IsValid || DeathPlacement.DeathQuantity <= 0) continue;
+
+            DeathPlacesNavModifierComponent->SetDeathPlace(HistoricalDeathPlaceIDOffset + NumHistoricalDeathPlaces, FBox::BuildAABB(DeathPlacement.Location, DeathPlaceExtent),  //
+                GetNavAreaObstacleTierClass(DeathPlacement.DeathQuantity));
+            ++NumHistoricalDeathPlaces;
+        }
+
+        UE_LOGFMT(LogUMBCG_NavSubsystem, Display, "ApplyDeathHeatmap(): {0} historical death places applied from {1}.", NumHistoricalDeathPlaces, DeathHeatmap->GetName());
+    }
+
+    DeathPlacesNavModifierComponent->FlushDeathPlaces();
+}
+
+
 void UMBCG_NavSubsystem::ApplyDeathPlacements(bool bProcessAll, const TArray<int32>& SpecifiedDeathPlacementsIDs)
 {
     // input check
@@ -305,7 +745,17 @@ void UMBCG_NavSubsystem::ApplyDeathPlacements(bool bProcessAll, const TArray<int
         DeathPlacementsIDsToProcess = SpecifiedDeathPlacementsIDs;
     }
 
-    DestroyRespawnNavModifierVolumeByDeathPlacements(DeathPlacementsIDsToProcess);
+    if (DeathPlacementsFlushInterval == 0.f)
+    {
+        DestroyRespawnNavModifierVolumeByDeathPlacements(DeathPlacementsIDsToProcess);
+        return;
+    }
+
+    PendingDeathPlacementIDs.Append(DeathPlacementsIDsToProcess);
+    if (OldestPendingDeathPlacementTime < 0. && PendingDeathPlacementIDs.Num() > 0)
+    {
+        OldestPendingDeathPlacementTime = GetWorld()->GetTimeSeconds();
+    }
 }
 
 
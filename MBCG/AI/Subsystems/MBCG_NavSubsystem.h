@@ -24,6 +24,11 @@
 #include "MBCG_NavSubsystem.generated.h"
 
 
+class UMBCG_DeathHeatmapDataAsset;
+class AMBCG_DeathPlacesNavModifier;
+class UMBCG_DeathPlacesNavModifierComponent;
+
+
 /**
  * This subsystem can be used separately for managing Navigation for NPC (best way to go, places to avoid etc) or in conjunction with MBCG_NPCAmbushAvaisionSubsystem.
  * 
@@ -41,7 +46,7 @@ struct FDeathPlacement
     UPROPERTY(BlueprintReadOnly)
     int32 DeathPlacementID = -1;
 
-    // How many deaths have taken place in this place (equals FAttackCluster.EntryIDs.Num())
+    // How many deaths have taken place in this place (equals FAttackCluster.Weight)
     UPROPERTY(BlueprintReadOnly)
     int32 DeathQuantity = 0;
 
@@ -83,7 +88,7 @@ static TSubclassOf<UNavArea> GetNavAreaObstacleTierClass(int32 Tier)
 
 
 UCLASS()
-class LYRAGAME_API UMBCG_NavSubsystem : public UWorldSubsystem
+class LYRAGAME_API UMBCG_NavSubsystem : public UTickableWorldSubsystem
 {
     GENERATED_BODY()
 
@@ -91,8 +96,14 @@ public:
 
     virtual void Initialize(FSubsystemCollectionBase& Collection) override;
     virtual void PostInitialize() override;
+    virtual void OnWorldBeginPlay(UWorld& InWorld) override;
     virtual void Deinitialize() override;
 
+    //~FTickableGameObject interface
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+    //~End of FTickableGameObject interface
+
 public:
 
     // Get all Death Places
@@ -100,14 +111,63 @@ public:
     const TArray<ANavModifierVolume*>& GetDeathNavModifierVolumes() const { return DeathNavModifierVolumes; }
 
     // Apply changes in navigation subsystem according to DeathPlacements (e.g. destroy and re-spawn corresponding NavModifierVolumes).
+    // The changes are batched and pushed to navigation by the next flush (see SetDeathPlacementsFlushInterval()), unless the flush interval is 0.
     // @param bProcessAll True: process all Death Placements. False: process only the Death Placements with specified IDs.
     // @param SpecifiedDeathPlacementsIDs IDs of Death Placements to process. bProcessAll must be False to consider it.
     void ApplyDeathPlacements(bool bProcessAll = true, const TArray<int32>& SpecifiedDeathPlacementsIDs = {});
 
     void SetDeathPlacements(const TArray<FDeathPlacement>& InDeathPlacements) { DeathPlacements = InDeathPlacements; }
 
+    // Set a single DeathPlacement at the index of its DeathPlacementID, growing DeathPlacements with invalid placements if needed
+    void SetDeathPlacement(const FDeathPlacement& InDeathPlacement);
+
     void SetDeathNavModifierVolumeHalfSize(float Radius) { DeathNavModifierVolumeHalfSize = Radius; }
 
+    // Spawn NavModifierVolumes for historical death placements baked offline (replaces the previously applied heatmap, if any).
+    // Historical placements are kept apart from DeathPlacements, so they don't interfere with live attack clusters.
+    // The heatmap of the current map (see UMBCG_DeathHeatmapDataAsset::GetAssetPathForMap()) is applied automatically at world start.
+    UFUNCTION(BlueprintCallable, Category = "NPC NavSystem")
+    void ApplyDeathHeatmap(const UMBCG_DeathHeatmapDataAsset* DeathHeatmap);
+
+    // Get NavModifierVolumes of the applied heatmap
+    const TArray<ANavModifierVolume*>& GetHistoricalDeathNavModifierVolumes() const { return HistoricalDeathNavModifierVolumes; }
+
+    // Set the number of dormant death place volumes spawned at world begin play, so that death placements activate pooled volumes instead of spawning actors.
+    // The map's settings may override it (see UMBCG_NavDeveloperSettings). The pool grows on demand anyway.
+    // This function is supposed to be run before the world begins play, afterwards it tops up the pool immediately (unless the single nav modifier is used).
+    UFUNCTION(BlueprintCallable, Category = "NPC NavSystem")
+    void SetDeathNavModifierVolumePoolSize(int32 NewDeathNavModifierVolumePoolSize);
+
+    // Number of dormant volumes in the pool
+    int32 GetNumDormantDeathNavModifierVolumes() const { return DormantDeathNavModifierVolumes.Num(); }
+
+    // Set how often death placement changes are pushed to navigation. Changes applied within the interval are accumulated and collapsed:
+    // a death placement changed several times (e.g. spawned then destroyed, or moved twice) is pushed once with its latest state.
+    // 0 pushes every change immediately (and flushes the pending ones).
+    UFUNCTION(BlueprintCallable, Category = "NPC NavSystem")
+    void SetDeathPlacementsFlushInterval(float NewDeathPlacementsFlushInterval);
+
+    // Push the pending death placement changes to navigation now
+    UFUNCTION(BlueprintCallable, Category = "NPC NavSystem")
+    void FlushDeathPlacements();
+
+    // Number of death placements changed since the previous flush
+    int32 GetNumPendingDeathPlacements() const { return PendingDeathPlacementIDs.Num(); }
+
+    // Set the distance a death placement must move by to move its death place on the NavMesh. Smaller moves don't change rasterized NavMesh
+    // (the default is the default Recast cell size), so they are skipped. Moves are measured from the applied location, so small moves add up.
+    UFUNCTION(BlueprintCallable, Category = "NPC NavSystem")
+    void SetDeathPlaceMinMoveDistance(float NewDeathPlaceMinMoveDistance) { DeathPlaceMinMoveDistance = FMath::Max(0.f, NewDeathPlaceMinMoveDistance); }
+
+    // Represent all death places (live and historical ones) by a single navigation-relevant component instead of a volume actor per death place,
+    // so that the actor count stays constant and changes dirty only the changed boxes (see UMBCG_DeathPlacesNavModifierComponent).
+    // Death places applied already (e.g. the heatmap applied at world begin play) are migrated to the new representation, and the volume pool is freed when switching to the component.
+    // The map's settings may enable it before anything is applied (see UMBCG_NavDeveloperSettings).
+    UFUNCTION(BlueprintCallable, Category = "NPC NavSystem")
+    void SetUseDeathPlacesNavModifier(bool bNewUseDeathPlacesNavModifier);
+
+    bool IsUsingDeathPlacesNavModifier() const { return bUseDeathPlacesNavModifier; }
+
     // For Debug only
     UFUNCTION(BlueprintCallable, Category = "NPC NavSystem|Debug")
     void DestroyAllDeathNavModifierVolumes_DEBUG() { DestroyNavModifierVolumes(DeathNavModifierVolumes); }
@@ -125,28 +185,105 @@ private:
     // Nav modifer volumes that represent death places. Works in accordance with DeathPlacements (accordance by array index)
     TArray<ANavModifierVolume*> DeathNavModifierVolumes;
 
+    // Nav modifer volumes that represent historical death places of the applied heatmap
+    TArray<ANavModifierVolume*> HistoricalDeathNavModifierVolumes;
+
+    // Heatmap applied by the last ApplyDeathHeatmap(), if any. Kept to re-apply it when death places are migrated (see SetUseDeathPlacesNavModifier())
+    UPROPERTY()
+    TObjectPtr<const UMBCG_DeathHeatmapDataAsset> AppliedDeathHeatmap;
+
+    // Short name of the current map without the PIE prefix (e.g. L_Expanse), empty if there is no world
+    FString GetCurrentMapName() const;
+
+    // Load the heatmap asset baked for the current map, nullptr if there is none
+    const UMBCG_DeathHeatmapDataAsset* LoadDeathHeatmapForCurrentMap() const;
+
     // radius for round-shape NavModifierVolume (or dimension for square-shape volume)
     float DeathNavModifierVolumeHalfSize = 50.f;
 
+    // Box extent of death place volumes
+    FVector GetDeathNavModifierVolumeExtent() const;
+
     // Spawns custom NavModifierVolume with custom area Cost according to the specified death placement's data.
+    // A dormant volume from the pool is activated if there is one, a new actor is spawned otherwise.
     // The more deaths are in the input placement, the bigger Cost the spawned NavModifierVolume will have
     // Returns nullptr and does not spawn anything if DeathPlacement.DeathQuantity <= 0
     AMBCG_DeathPlaceNavModifierVolume* SpawnDeathPlaceNavModifierVolume(const FDeathPlacement& DeathPlacement);
 
+    // Pool of death place volumes
+    // .. Dormant volumes ready to be activated for a death placement
+    UPROPERTY()
+    TArray<TObjectPtr<AMBCG_DeathPlaceNavModifierVolume>> DormantDeathNavModifierVolumes;
+
+    // .. Number of volumes prewarmed at world begin play
+    int32 DeathNavModifierVolumePoolSize = 32;
+
+    // Spawn dormant volumes until the pool holds PoolSize of them
+    void PrewarmDeathNavModifierVolumes(int32 PoolSize);
+
+    // Spawn a volume which doesn't affect navigation until it is activated
+    AMBCG_DeathPlaceNavModifierVolume* SpawnDormantDeathPlaceNavModifierVolume();
+
+    // In-place updates of death places
+    // .. Min distance of a move to be applied (see SetDeathPlaceMinMoveDistance())
+    float DeathPlaceMinMoveDistance = 19.f;
+
+    // .. Whether moving an applied death place from AppliedLocation to NewLocation wouldn't change the NavMesh
+    bool IsDeathPlaceMoveNegligible(const FVector& AppliedLocation, const FVector& NewLocation) const;
+
+    // .. Apply the minimal change to the active volume of the death placement: swap its area class if the tier changed, move it if the placement moved.
+    // Returns false if the volume can't be updated in place (there is none, the placement is not valid any more etc.) and should be destroyed and re-spawned
+    bool UpdateDeathPlaceNavModifierVolumeInPlace(int32 DeathPlacementID);
+
+    // Batching of death placement changes
+    // .. IDs of the death placements changed since the previous flush
+    TSet<int32> PendingDeathPlacementIDs;
+
+    // .. World time of the oldest pending change, negative if nothing is pending
+    double OldestPendingDeathPlacementTime = -1.;
+
+    // .. Interval of flushes in seconds, 0 pushes every change immediately
+    float DeathPlacementsFlushInterval = 0.25f;
+
+    // Single navigation-relevant representation of all death places
+    // .. Actor owning the component, spawned on demand
+    UPROPERTY()
+    TObjectPtr<AMBCG_DeathPlacesNavModifier> DeathPlacesNavModifier;
+
+    // .. Whether it's used instead of volumes
+    bool bUseDeathPlacesNavModifier = false;
+
+    // .. IDs of historical death places start from this offset, so they don't collide with DeathPlacementIDs
+    static constexpr int32 HistoricalDeathPlaceIDOffset = 1 << 30;
+
+    // .. Number of historical death places of the applied heatmap
+    int32 NumHistoricalDeathPlaces = 0;
+
+    // .. Get the component, spawning its actor if needed. Returns nullptr if spawning failed
+    UMBCG_DeathPlacesNavModifierComponent* GetDeathPlacesNavModifierComponent();
+
+    // .. Set or remove the death places of the specified Death Placements IDs and push the changes to navigation
+    void ApplyDeathPlacementsToNavModifier(const TArray<int32>& SpecifiedDeathPlacementsIDs);
+
+    // .. Replace the historical death places with the ones of DeathHeatmap (removes them if DeathHeatmap is nullptr) and push the changes to navigation
+    void ApplyDeathHeatmapToNavModifier(const UMBCG_DeathHeatmapDataAsset* DeathHeatmap);
+
+
     // Calculate DefaultCost for NavAreaObstacle depending on number of deaths in the placement
     // NOT USED because each NavArea_Obstacle_TierXX_MBCG class already has DefaultCost specified, so there is no need to dynamically change their DefaultCost.
     // @param DeathQuantity  Number of deaths in the placement
     float CalculateNavAreaObstacleCost(int32 DeathQuantity) const;
 
-    // destroy NavModifierVolume actors and set nullptr to corresponding elements in VolumesToDestroy array
+    // destroy NavModifierVolume actors (death place volumes are returned to the pool instead) and set nullptr to corresponding elements in VolumesToDestroy array
     // @param NavModifierVolumes Array of NavModifierVolumes to destroy
     void DestroyNavModifierVolumes(TArray<ANavModifierVolume*>& VolumesToDestroy);
-    // destroy a single NavModifierVolume actor and set nullptr to corresponding element in VolumesToDestroy array
+    // destroy a single NavModifierVolume actor (a death place volume is deactivated and returned to the pool instead) and set nullptr to corresponding element in VolumesToDestroy array
     // @param NavModifierVolumes Array of NavModifierVolumes
     // @param idx Index in the NavModifierVolumes array elements of which should be destroyed
     void DestroySingleNavModifierVolume(TArray<ANavModifierVolume*>& VolumesToDestroy, int32 idx);
 
     // Destroys and re-spawns NavModifierVolumes listed in DeathNavModifierVolumes for the specified Death Placements IDs.
+    // Volumes of the death placements which are still valid are updated in place instead (see UpdateDeathPlaceNavModifierVolumeInPlace()).
     // Note: DeathPlacements must be already up-to-date because this function relies on its data.
     // Note: NavMesh must be not static (e.g. it should be "Dynamic Modifiers Only") in order to apply the added NavModifierVolumes automatically.
     // @param SpecifiedDeathPlacementsIDs Process only the NavModifierVolumes which are represented by this parameter.
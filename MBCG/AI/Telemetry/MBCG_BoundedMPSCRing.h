@@ -0,0 +1,94 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/**
+ * Bounded lock-free ring buffer for many producers and a single consumer.
+ * Producers never block: TryEnqueue() fails when the ring is full, so the caller decides whether to drop the element.
+ * Each cell carries a sequence number which tells whether the cell is free for the producer of the current lap or filled for the consumer.
+ */
+template <typename ElementType>
+class TMBCG_BoundedMPSCRing
+{
+public:
+
+    // @param InCapacity Rounded up to a power of two
+    explicit TMBCG_BoundedMPSCRing(uint32 InCapacity)
+    {
+        const uint32 Capacity = FMath::RoundUpToPowerOfTwo(FMath::Max(InCapacity, 2u));
+        Mask = Capacity - 1;
+        Cells = MakeUnique<FCell[]>(Capacity);
+        for (uint32 CellIdx = 0; CellIdx < Capacity; ++CellIdx)
+        {
+            Cells[CellIdx].Sequence.store(CellIdx, std::memory_order_relaxed);
+        }
+    }
+
+    uint32 GetCapacity() const { return Mask + 1; }
+
+    // Any thread. Returns false if the ring is full
+    bool TryEnqueue(const ElementType& Element)
+    {
+        uint32 Position = EnqueuePosition.load(std::memory_order_relaxed);
+        FCell* Cell = nullptr;
+        for (;;)
+        {
+            Cell = &Cells[Position & Mask];
+            const uint32 Sequence = Cell->Sequence.load(std::memory_order_acquire);
+            const int32 Difference = static_cast<int32>(Sequence - Position);
+            if (Difference == 0)
+            {
+                // the cell is free in this lap, claim it
+                if (EnqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed)) break;
+            }
+            else if (Difference < 0)
+            {
+                // the consumer hasn't freed the cell yet
+                return false;
+            }
+            else
+            {
+                // another producer claimed the cell
+                Position = EnqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        Cell->Element = Element;
+        Cell->Sequence.store(Position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only. Returns false if the ring is empty
+    bool TryDequeue(ElementType& OutElement)
+    {
+        FCell& Cell = Cells[DequeuePosition & Mask];
+        const uint32 Sequence = Cell.Sequence.load(std::memory_order_acquire);
+        if (static_cast<int32>(Sequence - (DequeuePosition + 1)) < 0) return false;
+
+        OutElement = Cell.Element;
+        // free the cell for the producers of the next lap
+        Cell.Sequence.store(DequeuePosition + Mask + 1, std::memory_order_release);
+        ++DequeuePosition;
+        return true;
+    }
+
+private:
+
+    struct FCell
+    {
+        std::atomic<uint32> Sequence{0};
+        ElementType Element;
+    };
+
+    TUniquePtr<FCell[]> Cells;
+
+    uint32 Mask = 0;
+
+    // producers and the consumer work on different cache lines
+    alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> EnqueuePosition{0};
+
+    alignas(PLATFORM_CACHE_LINE_SIZE) uint32 DequeuePosition = 0;
+};
@@ -0,0 +1,245 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Telemetry/MBCG_ClusteringTelemetry.h"
+#include "MBCG/AI/Telemetry/MBCG_BoundedMPSCRing.h"
+#include "HAL/FileManager.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/CommandLine.h"
+#include "Misc/CoreDelegates.h"
+#include "Logging/StructuredLog.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogFClusteringTelemetry, All, All);
+
+
+namespace MBCG_ClusteringTelemetry
+{
+    // Number of events the ring buffer holds before new events are dropped
+    static constexpr uint32 RingCapacity = 1 << 16;
+
+    // How long the writer sleeps when the ring buffer is empty
+    static constexpr uint32 WriterIdleWaitMs = 50;
+
+    static const TCHAR* GetEventName(EClusteringTelemetryEvent Event)
+    {
+        switch (Event)
+        {
+            case EClusteringTelemetryEvent::ClusterCreated: return TEXT("ClusterCreated");
+            case EClusteringTelemetryEvent::ClustersMerged: return TEXT("ClustersMerged");
+            case EClusteringTelemetryEvent::EntryExpelled: return TEXT("EntryExpelled");
+            case EClusteringTelemetryEvent::RegistrationBatch: return TEXT("RegistrationBatch");
+            case EClusteringTelemetryEvent::AdjustmentBudgetExhausted: return TEXT("AdjustmentBudgetExhausted");
+            case EClusteringTelemetryEvent::NavVolumeSpawned: return TEXT("NavVolumeSpawned");
+            case EClusteringTelemetryEvent::NavVolumeDestroyed: return TEXT("NavVolumeDestroyed");
+            default: return TEXT("Unknown");
+        }
+    }
+
+    static const TCHAR* GetEntryTypeName(EEntryType EntryType)
+    {
+        switch (EntryType)
+        {
+            case EEntryType::Instigator: return TEXT("Instigator");
+            case EEntryType::Victim: return TEXT("Victim");
+            default: return TEXT("");
+        }
+    }
+}  // namespace MBCG_ClusteringTelemetry
+
+
+class FClusteringTelemetryRing : public TMBCG_BoundedMPSCRing<FClusteringTelemetryEvent>
+{
+public:
+
+    using TMBCG_BoundedMPSCRing<FClusteringTelemetryEvent>::TMBCG_BoundedMPSCRing;
+};
+
+
+// The only consumer of the ring: drains it into the CSV file on its own thread
+class FClusteringTelemetry::FWriter : public FRunnable
+{
+public:
+
+    FWriter(FClusteringTelemetryRing& InRing, TUniquePtr<FArchive>&& InFileWriter)
+        : Ring(InRing)
+        , FileWriter(MoveTemp(InFileWriter))
+    {
+        WakeEvent = FPlatformProcess::GetSynchEventFromPool();
+        WriteLine(TEXT("TimeSeconds,Frame,Event,EntryType,ID,OtherID,X,Y,Z,DurationMs"));
+        Thread.Reset(FRunnableThread::Create(this, TEXT("MBCG_ClusteringTelemetryWriter"), 0, TPri_BelowNormal));
+    }
+
+    virtual ~FWriter() override
+    {
+        bStopRequested = true;
+        WakeEvent->Trigger();
+        Thread->WaitForCompletion();
+        Thread.Reset();
+        FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+
+        FileWriter->Close();
+    }
+
+    //~FRunnable interface
+    virtual uint32 Run() override
+    {
+        while (!bStopRequested)
+        {
+            if (!Drain())
+            {
+                WakeEvent->Wait(MBCG_ClusteringTelemetry::WriterIdleWaitMs);
+            }
+        }
+
+        // events queued before Stop() are not lost
+        Drain();
+        return 0;
+    }
+    //~End of FRunnable interface
+
+private:
+
+    FClusteringTelemetryRing& Ring;
+
+    TUniquePtr<FArchive> FileWriter;
+
+    TUniquePtr<FRunnableThread> Thread;
+
+    FEvent* WakeEvent = nullptr;
+
+    std::atomic<bool> bStopRequested{false};
+
+    // Write all queued events. Returns false if there were none
+    bool Drain()
+    {
+        using namespace MBCG_ClusteringTelemetry;
+
+        bool bWritten = false;
+        FClusteringTelemetryEvent Event;
+        while (Ring.TryDequeue(Event))
+        {
+            WriteLine(*FString::Printf(TEXT("%.6f,%llu,%s,%s,%d,%d,%.1f,%.1f,%.1f,%.4f"),  //
+                Event.TimeSeconds, Event.FrameNumber, GetEventName(Event.Event), GetEntryTypeName(Event.EntryType), Event.ID, Event.OtherID,
+                Event.Location.X, Event.Location.Y, Event.Location.Z, Event.DurationMs));
+            bWritten = true;
+        }
+
+        if (bWritten)
+        {
+            FileWriter->Flush();
+        }
+        return bWritten;
+    }
+
+    void WriteLine(const TCHAR* Line)
+    {
+        const FTCHARToUTF8 Utf8Line(Line);
+        FileWriter->Serialize(const_cast<ANSICHAR*>(Utf8Line.Get()), Utf8Line.Length());
+        FileWriter->Serialize(const_cast<ANSICHAR*>("\n"), 1);
+    }
+};
+
+
+std::atomic<bool> FClusteringTelemetry::bEnabled{false};
+
+
+FClusteringTelemetry& FClusteringTelemetry::Get()
+{
+    static FClusteringTelemetry Instance;
+    return Instance;
+}
+
+
+FClusteringTelemetry::~FClusteringTelemetry()
+{
+    Stop();
+}
+
+
+void FClusteringTelemetry::Record(EClusteringTelemetryEvent Event, EEntryType EntryType, int32 ID, int32 OtherID, const FVector& Location, float DurationMs)
+{
+    if (!IsEnabled()) return;
+
+    FClusteringTelemetryEvent TelemetryEvent;
+    TelemetryEvent.TimeSeconds = FPlatformTime::Seconds();
+    TelemetryEvent.FrameNumber = GFrameCounter;
+    TelemetryEvent.Event = Event;
+    TelemetryEvent.EntryType = EntryType;
+    TelemetryEvent.ID = ID;
+    TelemetryEvent.OtherID = OtherID;
+    TelemetryEvent.Location = FVector3f(Location);
+    TelemetryEvent.DurationMs = DurationMs;
+
+    FClusteringTelemetry& Telemetry = Get();
+    if (!Telemetry.Ring->TryEnqueue(TelemetryEvent))
+    {
+        Telemetry.DroppedEventCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+void FClusteringTelemetry::StartFromCommandLine()
+{
+    if (bCommandLineChecked) return;
+    bCommandLineChecked = true;
+
+    FString FilePath;
+    if (FParse::Value(FCommandLine::Get(), TEXT("MBCGTelemetry="), FilePath))
+    {
+        Start(FilePath);
+    }
+}
+
+
+bool FClusteringTelemetry::Start(const FString& FilePath)
+{
+    check(IsInGameThread());
+
+    if (Writer)
+    {
+        UE_LOGFMT(LogFClusteringTelemetry, Warning, "Start(): Telemetry is already started.");
+        return false;
+    }
+
+    TUniquePtr<FArchive> FileWriter(IFileManager::Get().CreateFileWriter(*FilePath));
+    if (!FileWriter)
+    {
+        UE_LOGFMT(LogFClusteringTelemetry, Error, "Start(): Failed to create the telemetry file {0}.", FilePath);
+        return false;
+    }
+
+    if (!Ring)
+    {
+        Ring = MakeUnique<FClusteringTelemetryRing>(MBCG_ClusteringTelemetry::RingCapacity);
+    }
+
+    Writer = MakeUnique<FWriter>(*Ring, MoveTemp(FileWriter));
+    EnginePreExitHandle = FCoreDelegates::OnEnginePreExit.AddRaw(this, &FClusteringTelemetry::Stop);
+    // release: producers which see the flag also see the ring created above (see IsEnabled())
+    bEnabled.store(true, std::memory_order_release);
+
+    UE_LOGFMT(LogFClusteringTelemetry, Display, "Start(): Writing clustering telemetry to {0}.", FilePath);
+    return true;
+}
+
+
+void FClusteringTelemetry::Stop()
+{
+    if (!Writer) return;
+
+    bEnabled.store(false, std::memory_order_relaxed);
+    FCoreDelegates::OnEnginePreExit.Remove(EnginePreExitHandle);
+
+    // joins the writer thread after it has written the rest of the events
+    Writer.Reset();
+
+    const uint64 DroppedEvents = GetDroppedEventCount();
+    if (DroppedEvents > 0)
+    {
+        UE_LOGFMT(LogFClusteringTelemetry, Warning, "Stop(): {0} telemetry events were dropped because the ring buffer was full.", DroppedEvents);
+    }
+}
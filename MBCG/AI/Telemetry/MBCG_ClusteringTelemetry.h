@@ -0,0 +1,88 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MBCG/AI/Subsystems/MBCG_AttackClusteringSubsystem.h"  // for EEntryType
+#include <atomic>
+
+/**
+ * Process-wide telemetry stream of clustering and navigation events for production analytics.
+ * Events are pushed from any thread into a lock-free ring buffer and written to a CSV file by a background thread, so there is no file I/O on the game thread.
+ * When the ring is full new events are dropped (and counted) rather than blocking the producer.
+ *
+ * Telemetry is disabled by default and is started with the command line parameter -MBCGTelemetry=<FilePath> or with Start().
+ */
+
+
+enum class EClusteringTelemetryEvent : uint8
+{
+    ClusterCreated,     // ID = ClusterID, Location = centroid
+    ClustersMerged,     // ID = master ClusterID, OtherID = moved ClusterID, Location = master's centroid
+    EntryExpelled,      // ID = ClusterID, OtherID = EntryID, Location = entry location
+    RegistrationBatch,  // ID = number of registrations, OtherID = maximum adjustment steps of a registration, DurationMs = clustering time
+    AdjustmentBudgetExhausted,  // ID = adjustment step budget, OtherID = number of expelled entries waiting to be placed. The registration keeps its current assignment
+    NavVolumeSpawned,   // ID = DeathPlacementID, OtherID = DeathQuantity, Location = volume location, DurationMs = spawning (or activation of a pooled volume) time
+    NavVolumeDestroyed  // ID = volume index, Location = volume location. Pooled volumes are deactivated instead of destroyed
+};
+
+
+struct FClusteringTelemetryEvent
+{
+    double TimeSeconds = 0.0;
+    uint64 FrameNumber = 0;
+    EClusteringTelemetryEvent Event = EClusteringTelemetryEvent::ClusterCreated;
+    // EEntryType::MAX for events which are not related to a clustering partition
+    EEntryType EntryType = EEntryType::MAX;
+    int32 ID = -1;
+    int32 OtherID = -1;
+    FVector3f Location = FVector3f::ZeroVector;
+    float DurationMs = 0.f;
+};
+
+
+class LYRAGAME_API FClusteringTelemetry
+{
+public:
+
+    static FClusteringTelemetry& Get();
+
+    // Cheap check for call sites which need to prepare event data (e.g. measure timings).
+    // Acquire pairs with the release in Start(), so that a producer which sees telemetry enabled also sees the ring
+    static bool IsEnabled() { return bEnabled.load(std::memory_order_acquire); }
+
+    // Push an event into the ring buffer. Any thread, lock-free, does nothing if telemetry is disabled
+    static void Record(EClusteringTelemetryEvent Event, EEntryType EntryType, int32 ID, int32 OtherID = -1, const FVector& Location = FVector::ZeroVector, float DurationMs = 0.f);
+
+    // Start telemetry if -MBCGTelemetry=<FilePath> is specified on the command line. Does nothing if telemetry is already started
+    void StartFromCommandLine();
+
+    // Open the file and start the writer thread. Returns false if the file can't be created or telemetry is already started. Game thread only
+    bool Start(const FString& FilePath);
+
+    // Stop the writer thread after writing all queued events. Game thread only
+    void Stop();
+
+    // Number of events dropped because the ring buffer was full
+    uint64 GetDroppedEventCount() const { return DroppedEventCount.load(std::memory_order_relaxed); }
+
+private:
+
+    FClusteringTelemetry() = default;
+    ~FClusteringTelemetry();
+
+    class FWriter;
+
+    static std::atomic<bool> bEnabled;
+
+    std::atomic<uint64> DroppedEventCount{0};
+
+    // Lives as long as the process, so that late producers never touch a freed ring after Stop()
+    TUniquePtr<class FClusteringTelemetryRing> Ring;
+
+    TUniquePtr<FWriter> Writer;
+
+    bool bCommandLineChecked = false;
+
+    FDelegateHandle EnginePreExitHandle;
+};
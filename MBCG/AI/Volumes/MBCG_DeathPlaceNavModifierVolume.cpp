@@ -1,6 +1,7 @@
 // Copyright DevRespawn.com (MBCG). All Rights Reserved.
 
 #include "MBCG/AI/Volumes/MBCG_DeathPlaceNavModifierVolume.h"
+#include "AI/NavigationSystemBase.h"
 #include "Logging/StructuredLog.h"
 
 
@@ -33,3 +34,53 @@ AMBCG_DeathPlaceNavModifierVolume::AMBCG_DeathPlaceNavModifierVolume(const FObje
         UE_LOGFMT(LogAMBCG_DeathPlaceNavModifierVolume, Error, "Failed to create UBoxComponent for NavModifierVolume");
     }
 }
+
+
+void AMBCG_DeathPlaceNavModifierVolume::ActivateDeathPlace(const FVector& Location, TSubclassOf<UNavArea> AreaClassOverride, const FVector& BoxExtent)
+{
+    if (!BoxComponent) return;
+
+    BoxComponent->SetBoxExtent(BoxExtent, false /* bUpdateOverlaps */);
+    BoxComponent->SetAreaClassOverride(AreaClassOverride);
+    SetActorLocation(Location, false /* bSweep */, nullptr, ETeleportType::TeleportPhysics);
+
+    if (!bDeathPlaceActive)
+    {
+        // registers the component in the navigation octree with the new bounds and area
+        BoxComponent->SetCanEverAffectNavigation(true);
+        bDeathPlaceActive = true;
+    }
+    else
+    {
+        // re-tiered or moved in place
+        FNavigationSystem::UpdateComponentData(*BoxComponent);
+    }
+}
+
+
+void AMBCG_DeathPlaceNavModifierVolume::DeactivateDeathPlace()
+{
+    if (!BoxComponent || !bDeathPlaceActive) return;
+
+    // unregisters the component from the navigation octree, which dirties the area it covered
+    BoxComponent->SetCanEverAffectNavigation(false);
+    bDeathPlaceActive = false;
+}
+
+
+void AMBCG_DeathPlaceNavModifierVolume::SetDeathPlaceAreaClass(TSubclassOf<UNavArea> AreaClassOverride)
+{
+    if (!BoxComponent || !bDeathPlaceActive) return;
+
+    BoxComponent->SetAreaClassOverride(AreaClassOverride);
+    FNavigationSystem::UpdateComponentData(*BoxComponent);
+}
+
+
+void AMBCG_DeathPlaceNavModifierVolume::SetDeathPlaceLocation(const FVector& Location)
+{
+    if (!BoxComponent || !bDeathPlaceActive) return;
+
+    // the transform update refreshes the component's navigation data by itself
+    SetActorLocation(Location, false /* bSweep */, nullptr, ETeleportType::TeleportPhysics);
+}
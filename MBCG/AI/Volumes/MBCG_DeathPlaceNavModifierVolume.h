@@ -8,7 +8,8 @@
 #include "MBCG_DeathPlaceNavModifierVolume.generated.h"
 
 /**
- * This is a ANavModifierVolume for spawning in runtime as Death placements
+ * This is a ANavModifierVolume for spawning in runtime as Death placements.
+ * Volumes are pooled by MBCG_NavSubsystem: a dormant volume doesn't affect navigation and is activated in place for another death placement instead of spawning a new actor.
  */
 UCLASS(Blueprintable, BlueprintType)
 class LYRAGAME_API AMBCG_DeathPlaceNavModifierVolume : public ANavModifierVolume
@@ -23,8 +24,28 @@ public:
     // Returns BrushComponent subobject
     UBoxComponent* GetBoxComponent() const { return BoxComponent; }
 
+    // Pooling
+    // .. Move the volume to the death place and make it affect navigation with the area class and extent
+    void ActivateDeathPlace(const FVector& Location, TSubclassOf<UNavArea> AreaClassOverride, const FVector& BoxExtent);
+
+    // .. Stop affecting navigation, the actor is kept for reuse
+    void DeactivateDeathPlace();
+
+    bool IsDeathPlaceActive() const { return bDeathPlaceActive; }
+
+    // In-place updates of an active volume
+    // .. Swap the area class override only
+    void SetDeathPlaceAreaClass(TSubclassOf<UNavArea> AreaClassOverride);
+
+    // .. Move the volume only
+    void SetDeathPlaceLocation(const FVector& Location);
+
+    TSubclassOf<UNavArea> GetDeathPlaceAreaClass() const { return BoxComponent ? BoxComponent->GetDesiredAreaClass() : nullptr; }
+
 private:
 
+    bool bDeathPlaceActive = true;
+
     UPROPERTY(Category = Collision, VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
     TObjectPtr<class UBoxComponent> BoxComponent;
 };
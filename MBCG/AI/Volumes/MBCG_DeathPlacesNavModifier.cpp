@@ -0,0 +1,11 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#include "MBCG/AI/Volumes/MBCG_DeathPlacesNavModifier.h"
+#include "MBCG/AI/Components/MBCG_DeathPlacesNavModifierComponent.h"
+
+
+AMBCG_DeathPlacesNavModifier::AMBCG_DeathPlacesNavModifier(const FObjectInitializer& ObjectInitializer)
+    : Super(ObjectInitializer)
+{
+    DeathPlacesNavModifierComponent = CreateDefaultSubobject<UMBCG_DeathPlacesNavModifierComponent>(TEXT("DeathPlacesNavModifier"));
+}
@@ -0,0 +1,31 @@
+// Copyright DevRespawn.com (MBCG). All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "MBCG_DeathPlacesNavModifier.generated.h"
+
+
+class UMBCG_DeathPlacesNavModifierComponent;
+
+
+/**
+ * World-level actor spawned by MBCG_NavSubsystem to own UMBCG_DeathPlacesNavModifierComponent, which represents all death places on the NavMesh.
+ */
+UCLASS(NotBlueprintable, Transient)
+class LYRAGAME_API AMBCG_DeathPlacesNavModifier : public AInfo
+{
+    GENERATED_BODY()
+
+public:
+
+    AMBCG_DeathPlacesNavModifier(const FObjectInitializer& ObjectInitializer);
+
+    UMBCG_DeathPlacesNavModifierComponent* GetDeathPlacesNavModifierComponent() const { return DeathPlacesNavModifierComponent; }
+
+private:
+
+    UPROPERTY(VisibleAnywhere, meta = (AllowPrivateAccess = "true"))
+    TObjectPtr<UMBCG_DeathPlacesNavModifierComponent> DeathPlacesNavModifierComponent;
+};